@@ -0,0 +1,224 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "testarena.h"
+#include "arena_p.h"
+#include "calendargenerator.h"
+#include "event.h"
+#include "icalformat.h"
+#include "memorycalendar.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTest>
+#include <QTimeZone>
+
+#include <cstring>
+
+QTEST_MAIN(ArenaTest)
+
+using namespace KCalCore;
+
+void ArenaTest::testAllocate()
+{
+    const int chunks = Arena::liveChunks();
+
+    // Without an arena, memory comes from the heap
+    QVERIFY(!Arena::current());
+    void *heap = Arena::allocate(16);
+    QVERIFY(heap);
+    QCOMPARE(Arena::liveChunks(), chunks);
+    Arena::deallocate(heap);
+
+    QVector<void *> pointers;
+    {
+        Arena arena(1024);
+        Arena::Scope scope(&arena);
+        QCOMPARE(Arena::current(), &arena);
+
+        // Nested scopes restore the outer arena
+        {
+            Arena::Scope heapScope(nullptr);
+            QVERIFY(!Arena::current());
+        }
+        QCOMPARE(Arena::current(), &arena);
+
+        for (int i = 0; i < 100; ++i) {
+            void *pointer = Arena::allocate(24);
+            QVERIFY(pointer);
+            QCOMPARE(reinterpret_cast<quintptr>(pointer) % alignof(double), quintptr(0));
+            memset(pointer, i, 24);
+            pointers.append(pointer);
+        }
+        // 100 objects of 32 bytes do not fit a chunk of 1024 bytes
+        QVERIFY(Arena::liveChunks() > chunks + 1);
+
+        // Objects too large for the chunks come from the heap
+        const int before = Arena::liveChunks();
+        void *large = Arena::allocate(512);
+        QCOMPARE(Arena::liveChunks(), before);
+        Arena::deallocate(large);
+    }
+    QVERIFY(!Arena::current());
+
+    // The chunks are freed with their last object
+    QVERIFY(Arena::liveChunks() > chunks);
+    for (void *pointer : qAsConst(pointers)) {
+        Arena::deallocate(pointer);
+    }
+    QCOMPARE(Arena::liveChunks(), chunks);
+}
+
+void ArenaTest::testOutliveArena()
+{
+    const int chunks = Arena::liveChunks();
+
+    Event::Ptr event;
+    {
+        MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+        calendar->setArenaAllocation(true);
+        QVERIFY(calendar->arenaAllocation());
+
+        const QString data = QStringLiteral(
+            "BEGIN:VCALENDAR\n"
+            "PRODID:-//K Desktop Environment//NONSGML KOrganizer 4.3//EN\n"
+            "VERSION:2.0\n"
+            "BEGIN:VEVENT\n"
+            "DTSTAMP:20170101T120000Z\n"
+            "CREATED:20170101T120000Z\n"
+            "UID:arena\n"
+            "SUMMARY:Arena\n"
+            "ORGANIZER;CN=Organizer:MAILTO:organizer@example.com\n"
+            "ATTENDEE;CN=Attendee:MAILTO:attendee@example.com\n"
+            "DTSTART:20170102T090000Z\n"
+            "DTEND:20170102T100000Z\n"
+            "RRULE:FREQ=WEEKLY;COUNT=10\n"
+            "BEGIN:VALARM\n"
+            "ACTION:DISPLAY\n"
+            "TRIGGER:-PT15M\n"
+            "DESCRIPTION:Arena\n"
+            "END:VALARM\n"
+            "END:VEVENT\n"
+            "END:VCALENDAR\n");
+        QVERIFY(ICalFormat().fromString(calendar, data));
+        QVERIFY(Arena::liveChunks() > chunks);
+
+        event = calendar->event(QStringLiteral("arena"));
+        QVERIFY(event);
+    }
+
+    // The event keeps its chunk alive after the calendar is gone
+    QVERIFY(Arena::liveChunks() > chunks);
+    QCOMPARE(event->summary(), QStringLiteral("Arena"));
+    QCOMPARE(event->organizer()->email(), QStringLiteral("organizer@example.com"));
+    QCOMPARE(event->attendeeCount(), 1);
+    QCOMPARE(event->recurrence()->duration(), 10);
+    QCOMPARE(event->alarms().count(), 1);
+
+    // Copies may share data with the original, which stays valid
+    Event::Ptr copy(event->clone());
+    event.clear();
+    QCOMPARE(copy->summary(), QStringLiteral("Arena"));
+    QCOMPARE(copy->attendees().first()->email(), QStringLiteral("attendee@example.com"));
+    copy.clear();
+    QCOMPARE(Arena::liveChunks(), chunks);
+}
+
+// Returns the iCalendar data of a generated calendar of @p count incidences
+static QString generateCalendar(int count)
+{
+    CalendarGenerator::Settings settings;
+    settings.count = count;
+    return ICalFormat().toString(CalendarGenerator(settings).generate());
+}
+
+void ArenaTest::testLoadCalendar()
+{
+    const QString data = generateCalendar(50);
+
+    MemoryCalendar::Ptr heap(new MemoryCalendar(QTimeZone::utc()));
+    QVERIFY(ICalFormat().fromString(heap, data));
+
+    const int chunks = Arena::liveChunks();
+    MemoryCalendar::Ptr arena(new MemoryCalendar(QTimeZone::utc()));
+    arena->setArenaAllocation(true);
+    QVERIFY(ICalFormat().fromString(arena, data));
+    QVERIFY(Arena::liveChunks() > chunks);
+
+    QCOMPARE(arena->rawIncidences().count(), heap->rawIncidences().count());
+    for (const Incidence::Ptr &incidence : heap->rawIncidences()) {
+        const Incidence::Ptr other = arena->instance(incidence->instanceIdentifier());
+        QVERIFY(other);
+        QCOMPARE(*other, *incidence);
+    }
+
+    arena->close();
+    arena->setArenaAllocation(false);
+    QVERIFY(!arena->arenaAllocation());
+    QCOMPARE(Arena::liveChunks(), chunks);
+}
+
+// Returns the resident set size of the process in KiB, or -1
+static qint64 residentSetSize()
+{
+#ifdef Q_OS_LINUX
+    QFile statm(QStringLiteral("/proc/self/statm"));
+    if (statm.open(QIODevice::ReadOnly)) {
+        const QList<QByteArray> fields = statm.readAll().split(' ');
+        if (fields.size() > 1) {
+            return fields.at(1).toLongLong() * 4;
+        }
+    }
+#endif
+    return -1;
+}
+
+void ArenaTest::benchmarkLoadAndClose_data()
+{
+    QTest::addColumn<bool>("arena");
+
+    QTest::newRow("heap") << false;
+    QTest::newRow("arena") << true;
+}
+
+void ArenaTest::benchmarkLoadAndClose()
+{
+    QFETCH(bool, arena);
+
+    const QString data = generateCalendar(5000);
+    const qint64 rssBefore = residentSetSize();
+
+    qint64 loadTime = 0;
+    qint64 closeTime = 0;
+    QBENCHMARK {
+        MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+        calendar->setArenaAllocation(arena);
+
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(ICalFormat().fromString(calendar, data));
+        loadTime += timer.restart();
+        calendar->close();
+        closeTime += timer.elapsed();
+    }
+
+    qDebug() << "load:" << loadTime << "ms, close:" << closeTime << "ms,"
+             << "RSS growth after load and close:" << residentSetSize() - rssBefore << "KiB";
+}
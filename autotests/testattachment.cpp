@@ -22,7 +22,13 @@
 #include "event.h"
 #include "attachment.h"
 
+#include "attachmentstore.h"
+#include "icalformat.h"
+#include "memorycalendar.h"
+
+#include <QTemporaryDir>
 #include <QTest>
+#include <QTimeZone>
 QTEST_MAIN(AttachmentTest)
 
 using namespace KCalCore;
@@ -110,3 +116,127 @@ void AttachmentTest::testWriteToTempFile()
     delete event; // file is deleted in DTOR
     QVERIFY(!QFile::exists(filePath));
 }
+
+void AttachmentTest::testStore()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    AttachmentStore store(dir.path() + QLatin1String("/store"));
+    QCOMPARE(store.directory(), dir.path() + QLatin1String("/store"));
+    QCOMPARE(store.threshold(), qint64(64 * 1024));
+
+    const QByteArray data(100000, 'x');
+    const QByteArray key = store.store(data);
+    QVERIFY(!key.isEmpty());
+    QVERIFY(store.contains(key));
+    QCOMPARE(store.size(key), qint64(data.size()));
+    // Equal payloads are stored once
+    QCOMPARE(store.store(data), key);
+    QVERIFY(store.store(QByteArray("other")) != key);
+
+    QScopedPointer<QIODevice> device(store.open(key));
+    QVERIFY(device);
+    QCOMPARE(device->readAll(), data);
+
+    QVERIFY(!store.contains("../../etc/passwd"));
+    QVERIFY(!store.open("../../etc/passwd"));
+    QCOMPARE(store.size(QByteArray()), qint64(-1));
+
+    QVERIFY(store.remove(key));
+    QVERIFY(!store.contains(key));
+    QVERIFY(!store.open(key));
+}
+
+void AttachmentTest::testMoveToStore()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    AttachmentStore::Ptr store(new AttachmentStore(dir.path()));
+
+    Attachment uri(QStringLiteral("http://www.kde.org"));
+    QVERIFY(!uri.moveToStore(store));
+    QVERIFY(!uri.openDecodedData());
+
+    QByteArray data(200000, '\0');
+    for (int i = 0; i < data.size(); ++i) {
+        data[i] = char(i * 7);
+    }
+    Attachment::Ptr attachment(new Attachment(data.toBase64(), QStringLiteral("application/pdf")));
+    QCOMPARE(attachment->size(), uint(data.size()));
+    QScopedPointer<QIODevice> inMemory(attachment->openDecodedData());
+    QCOMPARE(inMemory->readAll(), data);
+
+    QVERIFY(attachment->moveToStore(store));
+    QCOMPARE(attachment->store(), store);
+    QCOMPARE(attachment->size(), uint(data.size()));
+    QVERIFY(attachment->isBinary());
+    QCOMPARE(attachment->decodedData(), data);
+    QCOMPARE(attachment->data(), data.toBase64());
+    QScopedPointer<QIODevice> stored(attachment->openDecodedData());
+    QCOMPARE(stored->readAll(), data);
+
+    Attachment copy(*attachment);
+    QCOMPARE(copy.store(), store);
+    QVERIFY(copy == *attachment);
+
+    QByteArray array;
+    QDataStream out(&array, QIODevice::WriteOnly);
+    out << attachment;
+    Attachment::Ptr deserialized(new Attachment(QStringLiteral("foo")));
+    QDataStream in(&array, QIODevice::ReadOnly);
+    in >> deserialized;
+    QVERIFY(!deserialized->store());
+    QVERIFY(*deserialized == *attachment);
+
+    Event event;
+    const QString filePath = event.writeAttachmentToTempFile(attachment);
+    QFile file(filePath);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    QCOMPARE(file.readAll(), data);
+
+    // New data is kept in memory again
+    attachment->setDecodedData("foo");
+    QVERIFY(!attachment->store());
+    QCOMPARE(attachment->decodedData(), QByteArray("foo"));
+    QCOMPARE(copy.decodedData(), data);
+}
+
+void AttachmentTest::testReadIntoStore()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    AttachmentStore::Ptr store(new AttachmentStore(dir.path()));
+    store->setThreshold(1000);
+
+    const QByteArray large(5000, 'l');
+    const QByteArray small(10, 's');
+    MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+    Event::Ptr event(new Event);
+    event->setUid(QStringLiteral("attachments"));
+    event->setDtStart(QDateTime(QDate(2017, 1, 1), QTime(10, 0), Qt::UTC));
+    event->addAttachment(Attachment::Ptr(new Attachment(large.toBase64(), QStringLiteral("text/plain"))));
+    event->addAttachment(Attachment::Ptr(new Attachment(small.toBase64(), QStringLiteral("text/plain"))));
+    calendar->addEvent(event);
+
+    ICalFormat format;
+    const QString serialized = format.toString(calendar);
+
+    format.setAttachmentStore(store);
+    QCOMPARE(format.attachmentStore(), store);
+    MemoryCalendar::Ptr loaded(new MemoryCalendar(QTimeZone::utc()));
+    QVERIFY(format.fromString(loaded, serialized));
+
+    const Attachment::List attachments = loaded->event(QStringLiteral("attachments"))->attachments();
+    QCOMPARE(attachments.count(), 2);
+    QCOMPARE(attachments.at(0)->store(), store);
+    QCOMPARE(attachments.at(0)->size(), uint(large.size()));
+    QCOMPARE(attachments.at(0)->decodedData(), large);
+    QCOMPARE(attachments.at(0)->mimeType(), QStringLiteral("text/plain"));
+    QVERIFY(!attachments.at(1)->store());
+    QCOMPARE(attachments.at(1)->decodedData(), small);
+
+    // Writing reads the payload back from the store
+    MemoryCalendar::Ptr reloaded(new MemoryCalendar(QTimeZone::utc()));
+    QVERIFY(ICalFormat().fromString(reloaded, format.toString(loaded)));
+    QCOMPARE(reloaded->event(QStringLiteral("attachments"))->attachments().at(0)->decodedData(), large);
+}
@@ -31,6 +31,9 @@ private Q_SLOTS:
     void testSerializer_data();
     void testSerializer();
     void testWriteToTempFile();
+    void testStore();
+    void testMoveToStore();
+    void testReadIntoStore();
 };
 
 #endif
@@ -135,4 +135,125 @@ void CalendarObserverTest::testDelete()
     arguments = spy3.takeFirst();
     QCOMPARE(arguments.at(0).value<KCalCore::Incidence::Ptr>(), static_cast<KCalCore::Incidence::Ptr>(event1));
 }
+
+void CalendarObserverTest::testBatch()
+{
+    qRegisterMetaType<KCalCore::Incidence::Ptr>();
+    qRegisterMetaType<const Calendar *>();
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    SimpleObserver ob(cal.data());
+    QSignalSpy addedSpy(&ob, &SimpleObserver::incidenceAdded);
+    QSignalSpy changedSpy(&ob, &SimpleObserver::incidenceChanged);
+    QSignalSpy aboutToBeDeletedSpy(&ob, &SimpleObserver::incidenceAboutToBeDeleted);
+    QSignalSpy deletedSpy(&ob, &SimpleObserver::incidenceDeleted);
+    QSignalSpy deletedDeprecatedSpy(&ob, &SimpleObserver::incidenceDeletedDeprecated);
+    cal->registerObserver(&ob);
+
+    Event::Ptr event1(new Event());
+    event1->setUid(QStringLiteral("1"));
+    Event::Ptr event2(new Event());
+    event2->setUid(QStringLiteral("2"));
+    Event::Ptr event3(new Event());
+    event3->setUid(QStringLiteral("3"));
+    Event::Ptr event4(new Event());
+    event4->setUid(QStringLiteral("4"));
+    cal->addEvent(event1);
+    cal->addEvent(event4);
+    addedSpy.clear();
+
+    cal->startBatchAdding();
+    cal->addEvent(event2);
+    cal->addEvent(event3);
+    event1->setDescription(QStringLiteral("desc"));
+    event2->setDescription(QStringLiteral("desc"));
+    event4->setDescription(QStringLiteral("desc"));
+    event4->setSummary(QStringLiteral("summary"));
+    cal->deleteEvent(event3);
+    cal->deleteEvent(event1);
+
+    QCOMPARE(addedSpy.count(), 0);
+    QCOMPARE(changedSpy.count(), 0);
+    QCOMPARE(deletedSpy.count(), 0);
+    QCOMPARE(deletedDeprecatedSpy.count(), 0);
+    // Only the incidence the observer already knows about
+    QCOMPARE(aboutToBeDeletedSpy.count(), 1);
+    QCOMPARE(aboutToBeDeletedSpy.at(0).at(0).value<KCalCore::Incidence::Ptr>(), static_cast<KCalCore::Incidence::Ptr>(event1));
+
+    cal->endBatchAdding();
+    QCOMPARE(addedSpy.count(), 1);
+    QCOMPARE(addedSpy.at(0).at(0).value<KCalCore::Incidence::Ptr>(), static_cast<KCalCore::Incidence::Ptr>(event2));
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(changedSpy.at(0).at(0).value<KCalCore::Incidence::Ptr>(), static_cast<KCalCore::Incidence::Ptr>(event4));
+    QCOMPARE(deletedSpy.count(), 1);
+    QCOMPARE(deletedSpy.at(0).at(0).value<KCalCore::Incidence::Ptr>(), static_cast<KCalCore::Incidence::Ptr>(event1));
+    QCOMPARE(deletedDeprecatedSpy.count(), 1);
+    QCOMPARE(aboutToBeDeletedSpy.count(), 1);
+
+    // Nothing is delivered twice
+    cal->startBatchAdding();
+    cal->endBatchAdding();
+    QCOMPARE(addedSpy.count(), 1);
+    QCOMPARE(changedSpy.count(), 1);
+    QCOMPARE(deletedSpy.count(), 1);
+}
+
+class BulkObserver : public Calendar::CalendarObserver, public Calendar::CalendarBatchObserver
+{
+public:
+    void calendarIncidenceAdded(const KCalCore::Incidence::Ptr &) override {
+        ++mSingleCalls;
+    }
+    void calendarIncidenceChanged(const KCalCore::Incidence::Ptr &) override {
+        ++mSingleCalls;
+    }
+    void calendarIncidencesChanged(const Incidence::List &added,
+                                   const Incidence::List &changed,
+                                   const Incidence::List &deleted,
+                                   const Calendar *calendar) override {
+        ++mBulkCalls;
+        mAdded = added;
+        mChanged = changed;
+        mDeleted = deleted;
+        mCalendar = calendar;
+    }
+
+    int mSingleCalls = 0;
+    int mBulkCalls = 0;
+    Incidence::List mAdded, mChanged, mDeleted;
+    const Calendar *mCalendar = nullptr;
+};
+
+void CalendarObserverTest::testBatchBulk()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    BulkObserver ob;
+    cal->registerObserver(&ob);
+
+    Event::Ptr existing(new Event());
+    existing->setUid(QStringLiteral("existing"));
+    cal->addEvent(existing);
+    QCOMPARE(ob.mSingleCalls, 1);
+
+    cal->startBatchAdding();
+    Incidence::List events;
+    for (int i = 0; i < 100; ++i) {
+        Event::Ptr event(new Event());
+        event->setUid(QString::number(i));
+        cal->addEvent(event);
+        event->setSummary(QStringLiteral("summary"));
+        events << event;
+    }
+    existing->setSummary(QStringLiteral("summary"));
+    existing->setDescription(QStringLiteral("desc"));
+    QCOMPARE(ob.mBulkCalls, 0);
+    cal->endBatchAdding();
+
+    QCOMPARE(ob.mSingleCalls, 1);
+    QCOMPARE(ob.mBulkCalls, 1);
+    QCOMPARE(ob.mAdded, events);
+    QCOMPARE(ob.mChanged, Incidence::List() << existing);
+    QVERIFY(ob.mDeleted.isEmpty());
+    QCOMPARE(ob.mCalendar, static_cast<const Calendar *>(cal.data()));
+}
+
 #include "testcalendarobserver.moc"
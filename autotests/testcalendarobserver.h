@@ -31,6 +31,8 @@ private Q_SLOTS:
     void testAdd();
     void testChange();
     void testDelete();
+    void testBatch();
+    void testBatchBulk();
 };
 
 #endif
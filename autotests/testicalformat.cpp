@@ -27,6 +27,7 @@
 
 #include <QDebug>
 #include <QTest>
+#include <QThread>
 #include <QTimeZone>
 
 QTEST_MAIN(ICalFormatTest)
@@ -150,3 +151,176 @@ void ICalFormatTest::testCuType()
     QVERIFY(attendee2->name() == attendee->name());
     QVERIFY(attendee2->email() == attendee->email());
 }
+
+void ICalFormatTest::testDuplicateUids()
+{
+    // New incidences are inserted in bulk, duplicates must still be
+    // resolved by revision
+    const QString serializedCalendar = QLatin1String(
+        "BEGIN:VCALENDAR\nPRODID:-//K Desktop Environment//NONSGML libkcal 3.2//EN\nVERSION:2.0\n"
+        "BEGIN:VEVENT\nUID:first\nSEQUENCE:1\nDTSTART:20170101T100000Z\nSUMMARY:old\nEND:VEVENT\n"
+        "BEGIN:VEVENT\nUID:second\nDTSTART:20170102T100000Z\nSUMMARY:second\nEND:VEVENT\n"
+        "BEGIN:VEVENT\nUID:first\nSEQUENCE:2\nDTSTART:20170101T100000Z\nSUMMARY:new\nEND:VEVENT\n"
+        "BEGIN:VEVENT\nUID:first\nSEQUENCE:0\nDTSTART:20170101T100000Z\nSUMMARY:older\nEND:VEVENT\n"
+        "BEGIN:VTODO\nUID:todo\nSUMMARY:todo\nEND:VTODO\n"
+        "END:VCALENDAR\n");
+
+    MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+    ICalFormat format;
+    QVERIFY(format.fromString(calendar, serializedCalendar));
+
+    QCOMPARE(calendar->rawEvents().count(), 2);
+    QCOMPARE(calendar->event(QStringLiteral("first"))->summary(), QStringLiteral("new"));
+    QCOMPARE(calendar->event(QStringLiteral("second"))->summary(), QStringLiteral("second"));
+    QCOMPARE(calendar->rawTodos().count(), 1);
+    QVERIFY(calendar->todo(QStringLiteral("todo")));
+}
+
+void ICalFormatTest::testLazyDecoding()
+{
+    const QString serializedCalendar = QString::fromUtf8(
+        "BEGIN:VCALENDAR\nPRODID:-//K Desktop Environment//NONSGML libkcal 3.2//EN\nVERSION:2.0\n"
+        "BEGIN:VEVENT\nUID:lazy\nDTSTART:20170101T100000Z\nSUMMARY:Lazy\n"
+        "DESCRIPTION:Übung\\nzweite Zeile\n"
+        "COMMENT:erster Kommentar\nCOMMENT:zweiter Kommentar\n"
+        "X-FOO:ä\nX-FOO:ö\n"
+        "X-KDE-APP-KEY:wert\n"
+        "END:VEVENT\n"
+        "BEGIN:VEVENT\nUID:plain\nDTSTART:20170102T100000Z\nSUMMARY:Plain\nEND:VEVENT\n"
+        "END:VCALENDAR\n");
+
+    MemoryCalendar::Ptr eagerCalendar(new MemoryCalendar(QTimeZone::utc()));
+    ICalFormat eager;
+    QVERIFY(!eager.lazyDecoding());
+    QVERIFY(eager.fromString(eagerCalendar, serializedCalendar));
+
+    MemoryCalendar::Ptr lazyCalendar(new MemoryCalendar(QTimeZone::utc()));
+    ICalFormat lazy;
+    lazy.setLazyDecoding(true);
+    QVERIFY(lazy.lazyDecoding());
+    QVERIFY(lazy.fromString(lazyCalendar, serializedCalendar));
+
+    const Event::Ptr event = lazyCalendar->event(QStringLiteral("lazy"));
+    QVERIFY(event);
+    QVERIFY(event->dirtyFields().isEmpty());
+    QCOMPARE(event->description(), QString::fromUtf8("Übung\nzweite Zeile"));
+    QVERIFY(!event->descriptionIsRich());
+    QCOMPARE(event->comments(), QStringList() << QString::fromUtf8("erster Kommentar")
+                                              << QString::fromUtf8("zweiter Kommentar"));
+    QCOMPARE(event->nonKDECustomProperty("X-FOO"), QString::fromUtf8("ä,ö"));
+    QCOMPARE(event->customProperty("APP", "KEY"), QStringLiteral("wert"));
+    QCOMPARE(event->customProperties().count(), 2);
+
+    for (const Event::Ptr &eagerEvent : eagerCalendar->rawEvents()) {
+        const Event::Ptr other = lazyCalendar->event(eagerEvent->uid());
+        QVERIFY(other);
+        QCOMPARE(*other, *eagerEvent);
+        QCOMPARE(other->comments(), eagerEvent->comments());
+    }
+
+    // Writing back decodes what was not accessed yet
+    MemoryCalendar::Ptr untouched(new MemoryCalendar(QTimeZone::utc()));
+    QVERIFY(lazy.fromString(untouched, serializedCalendar));
+    MemoryCalendar::Ptr written(new MemoryCalendar(QTimeZone::utc()));
+    QVERIFY(eager.fromString(written, lazy.toString(untouched)));
+    const Event::Ptr writtenEvent = written->event(QStringLiteral("lazy"));
+    QVERIFY(writtenEvent);
+    QCOMPARE(writtenEvent->description(), event->description());
+    QCOMPARE(writtenEvent->comments(), event->comments());
+    QCOMPARE(writtenEvent->customProperties(), event->customProperties());
+
+    // Changes replace the undecoded values
+    const Event::Ptr changed = untouched->event(QStringLiteral("lazy"));
+    changed->setDescription(QStringLiteral("changed"));
+    changed->addComment(QStringLiteral("third"));
+    changed->setNonKDECustomProperty("X-FOO", QStringLiteral("bar"));
+    QCOMPARE(changed->description(), QStringLiteral("changed"));
+    QCOMPARE(changed->comments().count(), 3);
+    QCOMPARE(changed->comments().last(), QStringLiteral("third"));
+    QCOMPARE(changed->nonKDECustomProperty("X-FOO"), QStringLiteral("bar"));
+}
+
+// Reads the lazily decoded values of all events, counting unexpected ones
+class LazyReader : public QThread
+{
+public:
+    explicit LazyReader(const Event::List &events) : mEvents(events) {}
+
+    void run() override
+    {
+        for (const Event::Ptr &event : qAsConst(mEvents)) {
+            const QString expected = event->summary();
+            if (event->description() != expected
+                    || event->comments() != QStringList(expected)
+                    || event->nonKDECustomProperty("X-FOO") != expected) {
+                ++mErrors;
+            }
+        }
+    }
+
+    const Event::List mEvents;
+    int mErrors = 0;
+};
+
+void ICalFormatTest::testLazyDecodingConcurrent()
+{
+    QString serializedCalendar = QStringLiteral(
+        "BEGIN:VCALENDAR\nPRODID:-//K Desktop Environment//NONSGML libkcal 3.2//EN\nVERSION:2.0\n");
+    for (int i = 0; i < 500; ++i) {
+        const QString value = QString::fromUtf8("Wert ä %1").arg(i);
+        serializedCalendar += QStringLiteral("BEGIN:VEVENT\nUID:event%1\nDTSTART:20170101T100000Z\n").arg(i)
+                              + QLatin1String("SUMMARY:") + value + QLatin1String("\nDESCRIPTION:") + value
+                              + QLatin1String("\nCOMMENT:") + value + QLatin1String("\nX-FOO:") + value
+                              + QLatin1String("\nEND:VEVENT\n");
+    }
+    serializedCalendar += QLatin1String("END:VCALENDAR\n");
+
+    MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+    ICalFormat format;
+    format.setLazyDecoding(true);
+    QVERIFY(format.fromString(calendar, serializedCalendar));
+    const Event::List events = calendar->rawEvents();
+    QCOMPARE(events.count(), 500);
+
+    // All readers decode the same events at the same time
+    QList<LazyReader *> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers << new LazyReader(events);
+    }
+    for (LazyReader *reader : qAsConst(readers)) {
+        reader->start();
+    }
+    for (LazyReader *reader : qAsConst(readers)) {
+        QVERIFY(reader->wait());
+        QCOMPARE(reader->mErrors, 0);
+    }
+    qDeleteAll(readers);
+}
+
+void ICalFormatTest::testDuplicateRecurrenceIds()
+{
+    // Recurrence ids are the same point in time, written in different
+    // time zones
+    const QString serializedCalendar = QLatin1String(
+        "BEGIN:VCALENDAR\nPRODID:-//K Desktop Environment//NONSGML libkcal 3.2//EN\nVERSION:2.0\n"
+        "BEGIN:VTIMEZONE\nTZID:Europe/Berlin\n"
+        "BEGIN:STANDARD\nDTSTART:19701025T030000\nTZOFFSETFROM:+0200\nTZOFFSETTO:+0100\n"
+        "RRULE:FREQ=YEARLY;BYMONTH=10;BYDAY=-1SU\nEND:STANDARD\n"
+        "BEGIN:DAYLIGHT\nDTSTART:19700329T020000\nTZOFFSETFROM:+0100\nTZOFFSETTO:+0200\n"
+        "RRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=-1SU\nEND:DAYLIGHT\n"
+        "END:VTIMEZONE\n"
+        "BEGIN:VEVENT\nUID:recurring\nDTSTART:20170101T100000Z\nRRULE:FREQ=WEEKLY\nSUMMARY:main\nEND:VEVENT\n"
+        "BEGIN:VEVENT\nUID:recurring\nSEQUENCE:1\nRECURRENCE-ID:20170108T100000Z\n"
+        "DTSTART:20170108T120000Z\nSUMMARY:old\nEND:VEVENT\n"
+        "BEGIN:VEVENT\nUID:recurring\nSEQUENCE:2\nRECURRENCE-ID;TZID=Europe/Berlin:20170108T110000\n"
+        "DTSTART:20170108T130000Z\nSUMMARY:new\nEND:VEVENT\n"
+        "END:VCALENDAR\n");
+
+    MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+    ICalFormat format;
+    QVERIFY(format.fromString(calendar, serializedCalendar));
+
+    QCOMPARE(calendar->rawEvents().count(), 2);
+    const QDateTime recurrenceId(QDate(2017, 1, 8), QTime(10, 0), Qt::UTC);
+    QCOMPARE(calendar->event(QStringLiteral("recurring"), recurrenceId)->summary(), QStringLiteral("new"));
+}
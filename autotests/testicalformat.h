@@ -32,6 +32,10 @@ private Q_SLOTS:
     void testCharsets();
     void testVolatileProperties();
     void testCuType();
+    void testDuplicateUids();
+    void testDuplicateRecurrenceIds();
+    void testLazyDecoding();
+    void testLazyDecodingConcurrent();
 };
 
 #endif
@@ -22,6 +22,7 @@
 #include "event.h"
 #include "utils.h"
 
+#include <QDataStream>
 #include <QTest>
 
 QTEST_MAIN(IncidenceTest)
@@ -282,3 +283,99 @@ void IncidenceTest::testRecurrenceYearlyMonth()
     r->setYearlyMonth(QList<int>() << 3 << 1);
     QCOMPARE(inc.dirtyFields(), QSet<IncidenceBase::Field>() << IncidenceBase::FieldRecurrence);
 }
+
+void IncidenceTest::testDirtyFields()
+{
+    Event inc;
+    QVERIFY(inc.dirtyFields().empty());
+
+    const QSet<IncidenceBase::Field> fields = QSet<IncidenceBase::Field>()
+            << IncidenceBase::FieldDtStart << IncidenceBase::FieldUid << IncidenceBase::FieldUrl;
+    inc.setDirtyFields(fields);
+    QCOMPARE(inc.dirtyFields(), fields);
+
+    inc.setFieldDirty(IncidenceBase::FieldComment);
+    QCOMPARE(inc.dirtyFields(), QSet<IncidenceBase::Field>(fields) << IncidenceBase::FieldComment);
+
+    inc.resetDirtyFields();
+    QVERIFY(inc.dirtyFields().empty());
+
+    Event other;
+    static_cast<IncidenceBase &>(other) = inc;
+    QCOMPARE(other.dirtyFields(), QSet<IncidenceBase::Field>() << IncidenceBase::FieldUnknown);
+}
+
+void IncidenceTest::testRarelyUsedProperties()
+{
+    Event::Ptr inc(new Event);
+    QVERIFY(inc->comments().isEmpty());
+    QVERIFY(inc->contacts().isEmpty());
+    QVERIFY(inc->url().isEmpty());
+    QVERIFY(inc->resources().isEmpty());
+    QVERIFY(!inc->hasGeo());
+    QCOMPARE(inc->geoLatitude(), float(INVALID_LATLON));
+    QCOMPARE(inc->geoLongitude(), float(INVALID_LATLON));
+    QCOMPARE(inc->relatedTo(), QString());
+    QCOMPARE(inc->schedulingID(), inc->uid());
+    QVERIFY(!inc->removeComment(QStringLiteral("none")));
+    QVERIFY(inc->dirtyFields().empty());
+
+    inc->addComment(QStringLiteral("comment"));
+    inc->addContact(QStringLiteral("contact"));
+    inc->setUrl(QUrl(QStringLiteral("http://example.com")));
+    inc->setResources(QStringList() << QStringLiteral("projector"));
+    inc->setCustomStatus(QStringLiteral("custom"));
+    inc->setSchedulingID(QStringLiteral("scheduling"));
+    inc->setRelatedTo(QStringLiteral("parent"));
+    inc->setHasGeo(true);
+    inc->setGeoLatitude(48.5f);
+    inc->setGeoLongitude(9.0f);
+
+    auto verify = [](const Event::Ptr &event) {
+        QCOMPARE(event->comments(), QStringList() << QStringLiteral("comment"));
+        QCOMPARE(event->contacts(), QStringList() << QStringLiteral("contact"));
+        QCOMPARE(event->url(), QUrl(QStringLiteral("http://example.com")));
+        QCOMPARE(event->resources(), QStringList() << QStringLiteral("projector"));
+        QCOMPARE(event->customStatus(), QStringLiteral("custom"));
+        QCOMPARE(event->relatedTo(), QStringLiteral("parent"));
+        QVERIFY(event->hasGeo());
+        QCOMPARE(event->geoLatitude(), 48.5f);
+        QCOMPARE(event->geoLongitude(), 9.0f);
+    };
+    verify(inc);
+    QCOMPARE(inc->schedulingID(), QStringLiteral("scheduling"));
+
+    Event::Ptr copy(inc->clone());
+    verify(copy);
+    QCOMPARE(copy->schedulingID(), QStringLiteral("scheduling"));
+    QVERIFY(*copy == *inc);
+
+    // Assignment keeps the scheduling id
+    Event::Ptr assigned(new Event);
+    static_cast<IncidenceBase &>(*assigned) = *inc;
+    verify(assigned);
+    QCOMPARE(assigned->schedulingID(), assigned->uid());
+
+    QByteArray data;
+    {
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out << IncidenceBase::Ptr(inc);
+    }
+    Event::Ptr deserialized(new Event);
+    {
+        QDataStream in(data);
+        in >> IncidenceBase::Ptr(deserialized);
+    }
+    verify(deserialized);
+    QCOMPARE(deserialized->schedulingID(), QStringLiteral("scheduling"));
+    QVERIFY(*deserialized == *inc);
+
+    QVERIFY(inc->removeComment(QStringLiteral("comment")));
+    QVERIFY(inc->comments().isEmpty());
+    inc->clearContacts();
+    QVERIFY(inc->contacts().isEmpty());
+    inc->setStatus(Incidence::StatusConfirmed);
+    QCOMPARE(inc->customStatus(), QString());
+    QCOMPARE(copy->comments(), QStringList() << QStringLiteral("comment"));
+    QCOMPARE(copy->customStatus(), QStringLiteral("custom"));
+}
@@ -41,6 +41,9 @@ private Q_SLOTS:
     void testRecurrenceMonthlyDate();
     void testRecurrenceYearlyDay();
     void testRecurrenceYearlyMonth();
+
+    void testDirtyFields();
+    void testRarelyUsedProperties();
 };
 
 #endif
@@ -0,0 +1,132 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "testinstrumentation.h"
+#include "event.h"
+#include "icalformat.h"
+#include "instrumentation.h"
+#include "memorycalendar.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTest>
+#include <QTimeZone>
+
+QTEST_MAIN(InstrumentationTest)
+
+using namespace KCalCore;
+
+// Loads and saves a calendar with a recurring event
+static void loadAndSave()
+{
+    MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+    Event::Ptr event(new Event);
+    event->setDtStart(QDateTime(QDate(2018, 3, 1), QTime(10, 0), QTimeZone("Europe/Berlin")));
+    event->setDtEnd(event->dtStart().addSecs(3600));
+    event->recurrence()->setDaily(1);
+    event->recurrence()->setDuration(10);
+    calendar->addEvent(event);
+
+    ICalFormat format;
+    MemoryCalendar::Ptr loaded(new MemoryCalendar(QTimeZone::utc()));
+    QVERIFY(format.fromString(loaded, format.toString(calendar)));
+    const Event::Ptr loadedEvent = loaded->event(event->uid());
+    QVERIFY(loadedEvent);
+    QVERIFY(loadedEvent->recursOn(QDate(2018, 3, 5), QTimeZone::utc()));
+    QCOMPARE(loadedEvent->recurrence()->timesInInterval(event->dtStart(), event->dtStart().addDays(30)).count(), 10);
+}
+
+void InstrumentationTest::testNames()
+{
+    QCOMPARE(Instrumentation::counterName(Instrumentation::RecurrenceCacheHits), QStringLiteral("RecurrenceCacheHits"));
+    QCOMPARE(Instrumentation::timerName(Instrumentation::LoadTimer), QStringLiteral("LoadTimer"));
+    QVERIFY(Instrumentation::counterName(Instrumentation::CounterCount).isEmpty());
+    QVERIFY(Instrumentation::timerName(Instrumentation::TimerCount).isEmpty());
+}
+
+void InstrumentationTest::testCounters()
+{
+    Instrumentation::reset();
+    Instrumentation::Snapshot snapshot = Instrumentation::snapshot();
+    QCOMPARE(snapshot.counters.size(), int(Instrumentation::CounterCount));
+    QCOMPARE(snapshot.timerCalls.size(), int(Instrumentation::TimerCount));
+    QCOMPARE(snapshot.timerNanoseconds.size(), int(Instrumentation::TimerCount));
+    for (quint64 counter : qAsConst(snapshot.counters)) {
+        QCOMPARE(counter, quint64(0));
+    }
+
+    loadAndSave();
+
+    snapshot = Instrumentation::snapshot();
+    if (!Instrumentation::isEnabled()) {
+        // The counters stay zero without instrumentation
+        for (quint64 counter : qAsConst(snapshot.counters)) {
+            QCOMPARE(counter, quint64(0));
+        }
+        return;
+    }
+    QVERIFY(snapshot.counters[Instrumentation::RecurrenceExpansions] > 0);
+    QVERIFY(snapshot.counters[Instrumentation::RecurrenceCacheMisses] > 0);
+    QVERIFY(snapshot.counters[Instrumentation::DateTimeConversions] > 0);
+    QCOMPARE(snapshot.timerCalls[Instrumentation::LoadTimer], quint64(1));
+    QCOMPARE(snapshot.timerCalls[Instrumentation::SaveTimer], quint64(1));
+    QCOMPARE(snapshot.timerCalls[Instrumentation::PopulateTimer], quint64(1));
+    QVERIFY(snapshot.timerCalls[Instrumentation::TimesInIntervalTimer] > 0);
+    QVERIFY(snapshot.timerCalls[Instrumentation::RecursOnTimer] > 0);
+
+    Instrumentation::reset();
+    snapshot = Instrumentation::snapshot();
+    QCOMPARE(snapshot.counters[Instrumentation::RecurrenceExpansions], quint64(0));
+    QCOMPARE(snapshot.timerCalls[Instrumentation::LoadTimer], quint64(0));
+}
+
+void InstrumentationTest::testTrace()
+{
+    Instrumentation::reset();
+    QVERIFY(!Instrumentation::tracingEnabled());
+    Instrumentation::setTracingEnabled(true);
+    loadAndSave();
+    Instrumentation::setTracingEnabled(false);
+
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(Instrumentation::traceJson(), &error);
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    const QJsonArray events = document.object().value(QStringLiteral("traceEvents")).toArray();
+    if (!Instrumentation::isEnabled()) {
+        QVERIFY(events.isEmpty());
+        return;
+    }
+
+    QStringList names;
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        QCOMPARE(event.value(QStringLiteral("ph")).toString(), QStringLiteral("X"));
+        QVERIFY(event.value(QStringLiteral("dur")).toDouble() >= 0);
+        names.append(event.value(QStringLiteral("name")).toString());
+    }
+    QVERIFY(names.contains(QStringLiteral("LoadTimer")));
+    QVERIFY(names.contains(QStringLiteral("SaveTimer")));
+
+    // Events are only recorded while tracing
+    Instrumentation::reset();
+    loadAndSave();
+    QVERIFY(QJsonDocument::fromJson(Instrumentation::traceJson()).object()
+            .value(QStringLiteral("traceEvents")).toArray().isEmpty());
+}
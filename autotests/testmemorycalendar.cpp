@@ -21,10 +21,12 @@
 
 #include "testmemorycalendar.h"
 #include "filestorage.h"
+#include "icalformat.h"
 #include "memorycalendar.h"
 #include "utils.h"
 
 #include <QDebug>
+#include <QSet>
 
 #include <QTest>
 #include <QTimeZone>
@@ -273,3 +275,434 @@ void MemoryCalendarTest::testChangeRecurId()
     QVERIFY(exception->summary() == QLatin1String("exception"));
     QVERIFY(main->summary() == event1->summary());
 }
+
+void MemoryCalendarTest::testSchedulingIdLookup()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+
+    Event::Ptr event = Event::Ptr(new Event());
+    event->setUid(QStringLiteral("event"));
+    event->setDtStart(QDateTime(QDate(2017, 3, 1), QTime(10, 0), Qt::UTC));
+    Todo::Ptr todo = Todo::Ptr(new Todo());
+    todo->setUid(QStringLiteral("todo"));
+    todo->setSchedulingID(QStringLiteral("sid"));
+
+    QVERIFY(cal->addEvent(event));
+    QVERIFY(cal->addTodo(todo));
+
+    // Without a schedulingID the uid is used
+    QCOMPARE(cal->incidenceFromSchedulingID(QStringLiteral("event")), event.staticCast<Incidence>());
+    QCOMPARE(cal->incidenceFromSchedulingID(QStringLiteral("sid")), todo.staticCast<Incidence>());
+    QVERIFY(!cal->incidenceFromSchedulingID(QStringLiteral("todo")));
+
+    // Changes are picked up
+    event->setSchedulingID(QStringLiteral("sid"));
+    QVERIFY(!cal->incidenceFromSchedulingID(QStringLiteral("event")));
+    Incidence::List incidences = cal->incidencesFromSchedulingID(QStringLiteral("sid"));
+    QCOMPARE(incidences.count(), 2);
+    QVERIFY(incidences.contains(event));
+    QVERIFY(incidences.contains(todo));
+
+    // Several matches are in the order they got the schedulingID
+    QCOMPARE(incidences, Incidence::List() << todo << event);
+    QCOMPARE(cal->incidenceFromSchedulingID(QStringLiteral("sid")), todo.staticCast<Incidence>());
+
+    // Adding an incidence twice doesn't add it twice to the index
+    QVERIFY(cal->addTodo(todo));
+    QCOMPARE(cal->incidencesFromSchedulingID(QStringLiteral("sid")).count(), 2);
+
+    QVERIFY(cal->deleteTodo(todo));
+    QCOMPARE(cal->incidencesFromSchedulingID(QStringLiteral("sid")), Incidence::List() << event);
+    QCOMPARE(cal->incidenceFromSchedulingID(QStringLiteral("sid")), event.staticCast<Incidence>());
+
+    cal->close();
+    QVERIFY(cal->incidencesFromSchedulingID(QStringLiteral("sid")).isEmpty());
+    QVERIFY(!cal->incidenceFromSchedulingID(QStringLiteral("sid")));
+}
+
+void MemoryCalendarTest::testCategories()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    QVERIFY(cal->categories().isEmpty());
+
+    Event::Ptr event = Event::Ptr(new Event());
+    event->setDtStart(QDateTime(QDate(2017, 3, 1), QTime(10, 0), Qt::UTC));
+    event->setCategories(QStringList() << QStringLiteral("work") << QStringLiteral("meeting"));
+    Todo::Ptr todo = Todo::Ptr(new Todo());
+    todo->setCategories(QStringLiteral("work, home"));
+
+    QVERIFY(cal->addEvent(event));
+    QVERIFY(cal->addTodo(todo));
+
+    // Categories are sorted
+    QCOMPARE(cal->categories(), QStringList() << QStringLiteral("home") << QStringLiteral("meeting")
+                                << QStringLiteral("work"));
+    QCOMPARE(cal->incidencesWithCategory(QStringLiteral("work")).count(), 2);
+    QCOMPARE(cal->incidencesWithCategory(QStringLiteral("home")), Incidence::List() << todo);
+    QVERIFY(cal->incidencesWithCategory(QStringLiteral("holiday")).isEmpty());
+
+    // Changes are picked up, unused categories disappear
+    event->setCategories(QStringList() << QStringLiteral("holiday"));
+    QCOMPARE(cal->categories(), QStringList() << QStringLiteral("holiday") << QStringLiteral("home")
+                                << QStringLiteral("work"));
+    QCOMPARE(cal->incidencesWithCategory(QStringLiteral("work")), Incidence::List() << todo);
+    QCOMPARE(cal->incidencesWithCategory(QStringLiteral("holiday")), Incidence::List() << event);
+
+    QVERIFY(cal->deleteTodo(todo));
+    QCOMPARE(cal->categories(), QStringList() << QStringLiteral("holiday"));
+    QVERIFY(cal->incidencesWithCategory(QStringLiteral("work")).isEmpty());
+
+    cal->close();
+    QVERIFY(cal->categories().isEmpty());
+}
+
+void MemoryCalendarTest::testDuplicates()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    const QString notebook = QStringLiteral("notebook");
+    QVERIFY(cal->addNotebook(notebook, true));
+
+    const QDateTime dt(QDate(2017, 3, 1), QTime(10, 0), Qt::UTC);
+    Event::Ptr event1 = Event::Ptr(new Event());
+    event1->setDtStart(dt);
+    event1->setSummary(QStringLiteral("Meeting"));
+    Event::Ptr event2 = Event::Ptr(new Event());
+    event2->setDtStart(dt.toTimeZone(QTimeZone("Europe/Berlin")));
+    event2->setSummary(QStringLiteral("Meeting"));
+    Todo::Ptr todo1 = Todo::Ptr(new Todo());
+    todo1->setSummary(QStringLiteral("Meeting"));
+    Todo::Ptr todo2 = Todo::Ptr(new Todo());
+    todo2->setSummary(QStringLiteral("Meeting"));
+
+    QVERIFY(cal->addEvent(event1));
+    QVERIFY(cal->addEvent(event2));
+    QVERIFY(cal->addTodo(todo1));
+    QVERIFY(cal->addTodo(todo2));
+
+    // Only incidences associated to a notebook are considered
+    QVERIFY(cal->duplicates(event1).isEmpty());
+    QVERIFY(cal->setNotebook(event1, notebook));
+    QVERIFY(cal->setNotebook(event2, notebook));
+    QVERIFY(cal->setNotebook(todo1, notebook));
+    QVERIFY(cal->setNotebook(todo2, notebook));
+
+    // Start times are compared as points in time, invalid ones are all equal
+    Incidence::List duplicates = cal->duplicates(event1);
+    QCOMPARE(duplicates.count(), 2);
+    QVERIFY(duplicates.contains(event1));
+    QVERIFY(duplicates.contains(event2));
+    duplicates = cal->duplicates(todo1);
+    QCOMPARE(duplicates.count(), 2);
+    QVERIFY(duplicates.contains(todo1));
+    QVERIFY(duplicates.contains(todo2));
+
+    // Changes are picked up
+    event2->setSummary(QStringLiteral("Other meeting"));
+    QCOMPARE(cal->duplicates(event1), Incidence::List() << event1);
+    todo2->setDtStart(dt);
+    QCOMPARE(cal->duplicates(todo1), Incidence::List() << todo1);
+
+    Event::Ptr candidate = Event::Ptr(new Event());
+    candidate->setDtStart(dt);
+    candidate->setSummary(QStringLiteral("Other meeting"));
+    QCOMPARE(cal->duplicates(candidate), Incidence::List() << event2);
+
+    // Setting the same notebook again doesn't list an incidence twice
+    QVERIFY(cal->setNotebook(event2, notebook));
+    QCOMPARE(cal->duplicates(candidate), Incidence::List() << event2);
+
+    cal->clearNotebookAssociations();
+    QVERIFY(cal->duplicates(event1).isEmpty());
+}
+
+void MemoryCalendarTest::testVisibility()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    const QString notebook = QStringLiteral("notebook");
+    QVERIFY(cal->addNotebook(notebook, false));
+
+    Event::Ptr event = Event::Ptr(new Event());
+    event->setDtStart(QDateTime(QDate(2017, 3, 1), QTime(10, 0), Qt::UTC));
+    QVERIFY(cal->addEvent(event));
+
+    // Incidences without a notebook are visible
+    QVERIFY(cal->isVisible(event));
+
+    QVERIFY(cal->setNotebook(event, notebook));
+    QVERIFY(!cal->isVisible(event));
+
+    QVERIFY(cal->updateNotebook(notebook, true));
+    QVERIFY(cal->isVisible(event));
+
+    QVERIFY(cal->deleteNotebook(notebook));
+    QVERIFY(cal->isVisible(event));
+
+    QVERIFY(cal->addNotebook(notebook, false));
+    QVERIFY(!cal->isVisible(event));
+    cal->clearNotebookAssociations();
+    QVERIFY(cal->isVisible(event));
+}
+
+class CountingObserver : public Calendar::CalendarObserver, public Calendar::CalendarBatchObserver
+{
+public:
+    void calendarIncidencesChanged(const Incidence::List &added,
+                                   const Incidence::List &changed,
+                                   const Incidence::List &deleted,
+                                   const Calendar *calendar) override
+    {
+        Q_UNUSED(changed);
+        Q_UNUSED(deleted);
+        Q_UNUSED(calendar);
+        ++mCalls;
+        mAdded += added.count();
+    }
+
+    int mCalls = 0;
+    int mAdded = 0;
+};
+
+void MemoryCalendarTest::testAddIncidences()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    CountingObserver observer;
+    cal->registerObserver(&observer);
+
+    const QDateTime start(QDate(2017, 1, 1), QTime(10, 0), Qt::UTC);
+    Incidence::List incidences;
+    for (int i = 0; i < 30; ++i) {
+        Incidence::Ptr incidence;
+        if (i % 3 == 0) {
+            incidence = Incidence::Ptr(new Todo());
+            incidence.staticCast<Todo>()->setDtDue(start.addDays(i));
+        } else if (i % 3 == 1) {
+            incidence = Incidence::Ptr(new Journal());
+        } else {
+            incidence = Incidence::Ptr(new Event());
+            incidence.staticCast<Event>()->setDtEnd(start.addDays(i).addSecs(3600));
+        }
+        incidence->setUid(QStringLiteral("uid%1").arg(i));
+        incidence->setDtStart(start.addDays(i));
+        incidences << incidence;
+    }
+    Event::Ptr exception(new Event());
+    exception->setUid(QStringLiteral("uid2"));
+    exception->setRecurrenceId(start.addDays(3));
+    exception->setDtStart(start.addDays(3));
+    exception->setDtEnd(start.addDays(3).addSecs(3600));
+    incidences << exception;
+
+    QVERIFY(cal->addIncidences(incidences));
+    QVERIFY(!cal->batchAdding());
+    QCOMPARE(observer.mCalls, 1);
+    QCOMPARE(observer.mAdded, incidences.count());
+
+    QCOMPARE(cal->rawTodos().count(), 10);
+    QCOMPARE(cal->rawJournals().count(), 10);
+    QCOMPARE(cal->rawEvents().count(), 11);
+    for (const Incidence::Ptr &incidence : qAsConst(incidences)) {
+        QCOMPARE(cal->incidence(incidence->uid(), incidence->recurrenceId()), incidence);
+        QCOMPARE(cal->instance(incidence->instanceIdentifier()), incidence);
+    }
+    QCOMPARE(cal->instances(incidences.at(2)), Incidence::List() << exception);
+    QCOMPARE(cal->rawEventsForDate(start.date().addDays(5)).count(), 1);
+    QCOMPARE(cal->rawJournalsForDate(start.date().addDays(4)).count(), 1);
+
+    // Changes made to the incidences are tracked
+    incidences.at(0)->setSummary(QStringLiteral("summary"));
+    QVERIFY(cal->isModified());
+    cal->unregisterObserver(&observer);
+}
+
+// Counts the incidences added through the per-type methods
+class CountingCalendar : public MemoryCalendar
+{
+public:
+    CountingCalendar() : MemoryCalendar(QTimeZone::utc()) {}
+
+    bool addEvent(const Event::Ptr &event) override
+    {
+        ++mAddedEvents;
+        return MemoryCalendar::addEvent(event);
+    }
+
+    int mAddedEvents = 0;
+};
+
+void MemoryCalendarTest::testAddIncidencesSubclass()
+{
+    // Subclasses see every incidence, also when they are added in bulk
+    QSharedPointer<CountingCalendar> cal(new CountingCalendar);
+    Incidence::List incidences;
+    for (int i = 0; i < 3; ++i) {
+        Event::Ptr event(new Event());
+        event->setUid(QStringLiteral("event%1").arg(i));
+        event->setDtStart(QDateTime(QDate(2017, 3, 1), QTime(10 + i, 0), Qt::UTC));
+        incidences << event;
+    }
+    incidences << Todo::Ptr(new Todo());
+
+    QVERIFY(cal->addIncidences(incidences));
+    QCOMPARE(cal->mAddedEvents, 3);
+    QCOMPARE(cal->rawEvents().count(), 3);
+    QCOMPARE(cal->rawTodos().count(), 1);
+
+    // Loading a file adds them in bulk too
+    const QString serializedCalendar = QLatin1String(
+        "BEGIN:VCALENDAR\nPRODID:-//K Desktop Environment//NONSGML libkcal 3.2//EN\nVERSION:2.0\n"
+        "BEGIN:VEVENT\nUID:first\nDTSTART:20170101T100000Z\nEND:VEVENT\n"
+        "BEGIN:VEVENT\nUID:second\nDTSTART:20170102T100000Z\nEND:VEVENT\n"
+        "END:VCALENDAR\n");
+    ICalFormat format;
+    QVERIFY(format.fromString(cal, serializedCalendar));
+    QCOMPARE(cal->mAddedEvents, 5);
+    QCOMPARE(cal->rawEvents().count(), 5);
+    cal->close();
+}
+
+void MemoryCalendarTest::benchmarkAddIncidences_data()
+{
+    QTest::addColumn<bool>("bulk");
+
+    QTest::newRow("addIncidence") << false;
+    QTest::newRow("addIncidences") << true;
+}
+
+void MemoryCalendarTest::benchmarkAddIncidences()
+{
+    QFETCH(bool, bulk);
+
+    const QDateTime start(QDate(2017, 1, 1), QTime(8, 0), Qt::UTC);
+    Incidence::List events;
+    events.reserve(100000);
+    for (int i = 0; i < 100000; ++i) {
+        Event::Ptr event(new Event());
+        event->setUid(QStringLiteral("event%1").arg(i));
+        event->setSummary(QStringLiteral("Event %1").arg(i));
+        event->setDtStart(start.addSecs(1800 * i));
+        event->setDtEnd(start.addSecs(1800 * i + 3600));
+        events << event;
+    }
+
+    QBENCHMARK_ONCE {
+        MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+        if (bulk) {
+            cal->addIncidences(events);
+        } else {
+            for (const Incidence::Ptr &event : qAsConst(events)) {
+                cal->addIncidence(event);
+            }
+        }
+        QCOMPARE(cal->rawEvents().count(), events.count());
+        cal->close();
+    }
+}
+
+void MemoryCalendarTest::testSharedAttendees()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    Event::List events;
+    for (int i = 0; i < 2; ++i) {
+        Event::Ptr event(new Event());
+        event->setUid(QStringLiteral("event%1").arg(i));
+        event->setOrganizer(Person::Ptr(new Person(QStringLiteral("Organizer"), QStringLiteral("organizer@example.com"))));
+        event->addAttendee(Attendee::Ptr(new Attendee(QStringLiteral("Attendee"), QStringLiteral("attendee@example.com"))));
+        Attendee::Ptr custom(new Attendee(QStringLiteral("Custom"), QStringLiteral("custom@example.com")));
+        custom->setCustomProperty("X-VALUE", QString::number(i));
+        event->addAttendee(custom);
+        cal->addEvent(event);
+        events << event;
+    }
+
+    const Event::Ptr first = events.at(0);
+    const Event::Ptr second = events.at(1);
+    QCOMPARE(first->organizer()->name().constData(), second->organizer()->name().constData());
+    const Attendee::Ptr firstAttendee = first->attendees().at(0);
+    const Attendee::Ptr secondAttendee = second->attendees().at(0);
+    QVERIFY(firstAttendee != secondAttendee);
+    QCOMPARE(firstAttendee->email().constData(), secondAttendee->email().constData());
+
+    // Attendees with different custom properties stay separate
+    QCOMPARE(first->attendees().at(1)->customProperties().nonKDECustomProperty("X-VALUE"), QStringLiteral("0"));
+    QCOMPARE(second->attendees().at(1)->customProperties().nonKDECustomProperty("X-VALUE"), QStringLiteral("1"));
+
+    // Modifying one copies the data
+    firstAttendee->setStatus(Attendee::Accepted);
+    QCOMPARE(firstAttendee->status(), Attendee::Accepted);
+    QCOMPARE(secondAttendee->status(), Attendee::None);
+    first->organizer()->setName(QStringLiteral("Other"));
+    QCOMPARE(second->organizer()->name(), QStringLiteral("Organizer"));
+
+    // A third incidence with an accepted attendee shares with the first one
+    Event::Ptr third(new Event());
+    third->setUid(QStringLiteral("event2"));
+    Attendee::Ptr accepted(new Attendee(QStringLiteral("Attendee"), QStringLiteral("attendee@example.com")));
+    accepted->setStatus(Attendee::Accepted);
+    third->addAttendee(accepted);
+    cal->addEvent(third);
+    QCOMPARE(third->attendees().at(0)->status(), Attendee::Accepted);
+    QCOMPARE(secondAttendee->status(), Attendee::None);
+
+    // The renamed organizer of the first one isn't shared under its old name
+    Event::Ptr fourth(new Event());
+    fourth->setUid(QStringLiteral("event3"));
+    fourth->setOrganizer(Person::Ptr(new Person(QStringLiteral("Organizer"), QStringLiteral("organizer@example.com"))));
+    cal->addEvent(fourth);
+    QCOMPARE(fourth->organizer()->name(), QStringLiteral("Organizer"));
+    QCOMPARE(first->organizer()->name(), QStringLiteral("Other"));
+}
+
+void MemoryCalendarTest::testSharedAttendeesMemory()
+{
+    // A team calendar: many meetings between a few hundred people. The uid
+    // of each attendee is a separate string, so the number of distinct uid
+    // data pointers is the number of separate attendee data blocks.
+    const int meetings = 20000;
+    const int people = 300;
+    Incidence::List events;
+    events.reserve(meetings);
+    const QDateTime start(QDate(2017, 1, 2), QTime(9, 0), Qt::UTC);
+    for (int i = 0; i < meetings; ++i) {
+        Event::Ptr event(new Event());
+        event->setUid(QStringLiteral("meeting%1").arg(i));
+        event->setDtStart(start.addSecs(1800 * i));
+        const int organizer = i % people;
+        event->setOrganizer(Person::Ptr(new Person(QStringLiteral("Person %1").arg(organizer),
+                                                   QStringLiteral("person%1@example.com").arg(organizer))));
+        for (int j = 1; j <= 5; ++j) {
+            const int person = (organizer + j * 37) % people;
+            Attendee::Ptr attendee(new Attendee(QStringLiteral("Person %1").arg(person),
+                                                QStringLiteral("person%1@example.com").arg(person),
+                                                false, j % 2 ? Attendee::Accepted : Attendee::NeedsAction));
+            attendee->setUid(QStringLiteral("uid%1").arg(person));
+            event->addAttendee(attendee);
+        }
+        events << event;
+    }
+
+    auto distinctData = [&events]() {
+        QSet<const QChar *> persons, attendees;
+        for (const Incidence::Ptr &incidence : qAsConst(events)) {
+            persons.insert(incidence->organizer()->name().constData());
+            const Attendee::List list = incidence->attendees();
+            for (const Attendee::Ptr &attendee : list) {
+                attendees.insert(attendee->uid().constData());
+            }
+        }
+        return qMakePair(persons.count(), attendees.count());
+    };
+
+    const QPair<int, int> separate = distinctData();
+    QCOMPARE(separate.first, meetings);
+    QCOMPARE(separate.second, meetings * 5);
+
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    QBENCHMARK_ONCE {
+        cal->addIncidences(events);
+    }
+    const QPair<int, int> shared = distinctData();
+    qDebug() << "organizer data blocks:" << separate.first << "->" << shared.first
+             << "attendee data blocks:" << separate.second << "->" << shared.second;
+    QCOMPARE(shared.first, people);
+    QVERIFY(shared.second <= 2 * people);
+}
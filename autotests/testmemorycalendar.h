@@ -34,6 +34,16 @@ private Q_SLOTS:
     void testRelationsCrash();
     void testRecurrenceExceptions();
     void testChangeRecurId();
+    void testSchedulingIdLookup();
+    void testCategories();
+    void testDuplicates();
+    void testVisibility();
+    void testAddIncidences();
+    void testAddIncidencesSubclass();
+    void benchmarkAddIncidences_data();
+    void benchmarkAddIncidences();
+    void testSharedAttendees();
+    void testSharedAttendeesMemory();
 };
 
 #endif
@@ -0,0 +1,367 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "testmemorycalendarsnapshot.h"
+#include "calendargenerator.h"
+#include "memorycalendar.h"
+
+#include <QAtomicInt>
+#include <QThread>
+#include <QTest>
+QTEST_MAIN(MemoryCalendarSnapshotTest)
+
+using namespace KCalCore;
+
+static const int s_batchSize = 10;
+
+// Returns the uid of the event @p i of the batch @p batch
+static QString batchUid(int batch, int i)
+{
+    return QStringLiteral("generated-%1-%2").arg(batch).arg(i);
+}
+
+/**
+  Adds a batch of s_batchSize generated events which all have the batch
+  number as summary, so readers can check that they never see a partial
+  batch.
+*/
+static void addBatch(const MemoryCalendar::Ptr &cal, int batch)
+{
+    CalendarGenerator::Settings settings;
+    settings.seed = batch;
+    settings.count = s_batchSize;
+    settings.todoWeight = 0;
+    settings.journalWeight = 0;
+    // One event per uid
+    settings.exceptionPercent = 0;
+    settings.bigDescriptionPercent = 0;
+    const Event::List events = CalendarGenerator(settings).generate()->rawEvents();
+    for (const Event::Ptr &event : events) {
+        Event::Ptr copy(event->clone());
+        copy->setSummary(QString::number(batch));
+        cal->addEvent(copy);
+    }
+}
+
+static void deleteBatch(const MemoryCalendar::Ptr &cal, int batch)
+{
+    for (int i = 0; i < s_batchSize; ++i) {
+        cal->deleteEvent(cal->event(batchUid(batch, i)));
+    }
+}
+
+class SnapshotReader : public QThread
+{
+public:
+    SnapshotReader(const MemoryCalendar::Ptr &cal, const QAtomicInt &stop, int maxQueries = -1)
+        : mCalendar(cal), mStop(stop), mMaxQueries(maxQueries)
+    {
+    }
+
+    int errors() const
+    {
+        return mErrors;
+    }
+
+    int queries() const
+    {
+        return mQueries;
+    }
+
+protected:
+    void run() override
+    {
+        while (mMaxQueries < 0 ? !mStop.load() : mQueries < mMaxQueries) {
+            const MemoryCalendar::Snapshot::Ptr snapshot = mCalendar->snapshot();
+            ++mQueries;
+
+            if (mQueries % 50 == 0) {
+                // Every event of the snapshot can be looked up, and batches are complete
+                const Event::List events = snapshot->rawEvents(EventSortStartDate, SortDirectionAscending);
+                QHash<QString, int> batchSizes;
+                for (const Event::Ptr &event : events) {
+                    ++batchSizes[event->summary()];
+                    if (snapshot->instance(event->instanceIdentifier()) != event) {
+                        ++mErrors;
+                    }
+                }
+                for (int size : qAsConst(batchSizes)) {
+                    if (size != s_batchSize) {
+                        ++mErrors;
+                    }
+                }
+            } else {
+                const QString uid = batchUid(mQueries % 100, mQueries % s_batchSize);
+                const Incidence::Ptr incidence = snapshot->incidence(uid);
+                if (incidence && (incidence->uid() != uid || snapshot->event(uid) != incidence)) {
+                    ++mErrors;
+                }
+            }
+        }
+    }
+
+private:
+    MemoryCalendar::Ptr mCalendar;
+    const QAtomicInt &mStop;
+    int mMaxQueries;
+    int mErrors = 0;
+    int mQueries = 0;
+};
+
+/**
+  Modifies a calendar in batches, keeping the last @p window batches and
+  publishing a snapshot after each batch.
+*/
+class SnapshotWriter
+{
+public:
+    SnapshotWriter(const MemoryCalendar::Ptr &cal, int window)
+        : mCalendar(cal), mWindow(window)
+    {
+    }
+
+    void step()
+    {
+        addBatch(mCalendar, mBatch++);
+        if (mBatch - mOldest > mWindow) {
+            deleteBatch(mCalendar, mOldest++);
+        }
+        mCalendar->publishSnapshot();
+    }
+
+    /**
+      Runs at least @p minSteps steps, then sets @p stop and keeps going
+      until all @p readers are finished.
+    */
+    void run(const QList<SnapshotReader *> &readers, QAtomicInt &stop, int minSteps)
+    {
+        for (int i = 0; i < minSteps; ++i) {
+            step();
+        }
+        stop.store(1);
+        for (SnapshotReader *reader : readers) {
+            while (!reader->wait(0)) {
+                step();
+            }
+        }
+    }
+
+private:
+    MemoryCalendar::Ptr mCalendar;
+    int mWindow;
+    int mBatch = 0;
+    int mOldest = 0;
+};
+
+void MemoryCalendarSnapshotTest::testSnapshot()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    MemoryCalendar::Snapshot::Ptr empty = cal->snapshot();
+    QVERIFY(empty);
+    QCOMPARE(empty->version(), quint64(0));
+    QVERIFY(empty->rawEvents().isEmpty());
+
+    addBatch(cal, 0);
+    Todo::Ptr todo(new Todo);
+    todo->setUid(QStringLiteral("todo"));
+    cal->addTodo(todo);
+
+    // Nothing is visible until published
+    QCOMPARE(cal->snapshot(), empty);
+    cal->publishSnapshot();
+    MemoryCalendar::Snapshot::Ptr first = cal->snapshot();
+    QCOMPARE(first->version(), quint64(1));
+    QCOMPARE(first->rawEvents().count(), s_batchSize);
+    QCOMPARE(first->rawTodos(), Todo::List() << todo);
+    QVERIFY(first->rawJournals().isEmpty());
+    QCOMPARE(first->rawIncidences().count(), s_batchSize + 1);
+    QCOMPARE(first->incidence(QStringLiteral("todo")), todo.staticCast<Incidence>());
+    QCOMPARE(first->todo(QStringLiteral("todo")), todo);
+    QVERIFY(!first->event(QStringLiteral("todo")));
+    QCOMPARE(first->event(batchUid(0, 1)), cal->event(batchUid(0, 1)));
+    QCOMPARE(first->instance(batchUid(0, 1)), cal->instance(batchUid(0, 1)));
+
+    // Published snapshots don't change
+    deleteBatch(cal, 0);
+    addBatch(cal, 1);
+    cal->deleteTodo(todo);
+    QCOMPARE(first->rawEvents().count(), s_batchSize);
+    QVERIFY(first->event(batchUid(0, 1)));
+    QVERIFY(!first->event(batchUid(1, 1)));
+    QCOMPARE(first->todo(QStringLiteral("todo")), todo);
+
+    cal->publishSnapshot();
+    MemoryCalendar::Snapshot::Ptr second = cal->snapshot();
+    QCOMPARE(second->version(), quint64(2));
+    QVERIFY(!second->event(batchUid(0, 1)));
+    QVERIFY(second->event(batchUid(1, 1)));
+    QVERIFY(second->rawTodos().isEmpty());
+
+    cal->close();
+    QCOMPARE(second->rawEvents().count(), s_batchSize);
+}
+
+void MemoryCalendarSnapshotTest::testConcurrentReaders_data()
+{
+    QTest::addColumn<int>("readerCount");
+
+    QTest::newRow("1 reader") << 1;
+    QTest::newRow("4 readers") << 4;
+    QTest::newRow("16 readers") << 16;
+}
+
+void MemoryCalendarSnapshotTest::testConcurrentReaders()
+{
+    QFETCH(int, readerCount);
+
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    QAtomicInt stop;
+    QList<SnapshotReader *> readers;
+    for (int i = 0; i < readerCount; ++i) {
+        readers.append(new SnapshotReader(cal, stop));
+        readers.last()->start();
+    }
+
+    SnapshotWriter writer(cal, 20);
+    writer.run(readers, stop, 200);
+
+    for (SnapshotReader *reader : qAsConst(readers)) {
+        QCOMPARE(reader->errors(), 0);
+        QVERIFY(reader->queries() > 0);
+    }
+    qDeleteAll(readers);
+}
+
+/**
+  Runs the const queries documented as safe for concurrent use on an
+  unmodified calendar, comparing their results with the expected ones.
+*/
+class QueryReader : public QThread
+{
+public:
+    QueryReader(const MemoryCalendar::Ptr &cal, const Event::List &events)
+        : mCalendar(cal), mEvents(events)
+    {
+    }
+
+    int errors() const
+    {
+        return mErrors;
+    }
+
+protected:
+    void run() override
+    {
+        const QString notebook = QStringLiteral("notebook");
+        for (int i = 0; i < 200; ++i) {
+            const Event::Ptr &event = mEvents.at(i % mEvents.count());
+            if (mCalendar->event(event->uid()) != event
+                    || mCalendar->incidence(event->uid()) != event
+                    || mCalendar->instance(event->instanceIdentifier()) != event
+                    || mCalendar->incidenceFromSchedulingID(event->uid()) != event
+                    || !mCalendar->incidencesWithCategory(event->categories().first()).contains(event)
+                    || mCalendar->notebook(event) != notebook
+                    || !mCalendar->isVisible(event)
+                    || !mCalendar->relations(event->uid()).isEmpty()
+                    || mCalendar->todo(event->uid())
+                    || mCalendar->journal(event->uid())) {
+                ++mErrors;
+            }
+            if (i % 20 == 0
+                    && (mCalendar->rawEvents(EventSortStartDate, SortDirectionAscending).count() != mEvents.count()
+                        || mCalendar->rawIncidences().count() != mEvents.count()
+                        || !mCalendar->rawTodos(TodoSortDueDate, SortDirectionAscending).isEmpty()
+                        || !mCalendar->rawJournals().isEmpty()
+                        || !mCalendar->deletedTodos().isEmpty()
+                        || mCalendar->incidences(notebook).count() != mEvents.count()
+                        || mCalendar->categories().count() != 10)) {
+                ++mErrors;
+            }
+        }
+    }
+
+private:
+    MemoryCalendar::Ptr mCalendar;
+    Event::List mEvents;
+    int mErrors = 0;
+};
+
+void MemoryCalendarSnapshotTest::testConcurrentQueries()
+{
+    // Only events, so that the queries for other types run on missing entries
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    const QString notebook = QStringLiteral("notebook");
+    QVERIFY(cal->addNotebook(notebook, true));
+    for (int batch = 0; batch < 10; ++batch) {
+        addBatch(cal, batch);
+    }
+    const Event::List events = cal->rawEvents();
+    for (const Event::Ptr &event : events) {
+        event->setCategories(event->summary());
+        QVERIFY(cal->setNotebook(event, notebook));
+    }
+
+    QList<QueryReader *> readers;
+    for (int i = 0; i < 8; ++i) {
+        readers.append(new QueryReader(cal, events));
+        readers.last()->start();
+    }
+    for (QueryReader *reader : qAsConst(readers)) {
+        reader->wait();
+        QCOMPARE(reader->errors(), 0);
+    }
+    qDeleteAll(readers);
+}
+
+void MemoryCalendarSnapshotTest::benchmarkReaders_data()
+{
+    QTest::addColumn<int>("readerCount");
+
+    for (int readerCount : {1, 2, 4, 8}) {
+        QTest::newRow(QByteArray::number(readerCount).constData()) << readerCount;
+    }
+}
+
+void MemoryCalendarSnapshotTest::benchmarkReaders()
+{
+    QFETCH(int, readerCount);
+
+    // The total number of queries is fixed, so the time taken measures
+    // the reader throughput while one writer keeps publishing
+    const int queries = 20000;
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    SnapshotWriter writer(cal, 100);
+    for (int i = 0; i < 100; ++i) {
+        writer.step();
+    }
+
+    QBENCHMARK {
+        QAtomicInt stop;
+        QList<SnapshotReader *> readers;
+        for (int i = 0; i < readerCount; ++i) {
+            readers.append(new SnapshotReader(cal, stop, queries / readerCount));
+            readers.last()->start();
+        }
+        writer.run(readers, stop, 0);
+        for (SnapshotReader *reader : qAsConst(readers)) {
+            QCOMPARE(reader->errors(), 0);
+        }
+        qDeleteAll(readers);
+    }
+}
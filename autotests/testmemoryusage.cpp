@@ -0,0 +1,130 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "testmemoryusage.h"
+#include "event.h"
+#include "memorycalendar.h"
+#include "memoryusage.h"
+
+#include <QTest>
+#include <QTimeZone>
+
+QTEST_MAIN(MemoryUsageTest)
+
+using namespace KCalCore;
+
+void MemoryUsageTest::testMemoryUsage()
+{
+    MemoryUsage usage;
+    QCOMPARE(usage.totalBytes(), qint64(0));
+
+    usage.addBytes(MemoryUsage::Strings, 10);
+    usage.addBytes(MemoryUsage::Alarms, 5);
+    QCOMPARE(usage.bytes(MemoryUsage::Strings), qint64(10));
+    QCOMPARE(usage.totalBytes(), qint64(15));
+
+    MemoryUsage other(usage);
+    other += usage;
+    QCOMPARE(other.bytes(MemoryUsage::Strings), qint64(20));
+    QCOMPARE(usage.bytes(MemoryUsage::Strings), qint64(10));
+
+    QCOMPARE(MemoryUsage::categoryName(MemoryUsage::Attachments), QStringLiteral("Attachments"));
+    QVERIFY(MemoryUsage::categoryName(MemoryUsage::CategoryCount).isEmpty());
+    QCOMPARE(usage.bytes(MemoryUsage::CategoryCount), qint64(0));
+}
+
+void MemoryUsageTest::testIncidence()
+{
+    Event::Ptr event(new Event);
+    event->setDtStart(QDateTime(QDate(2018, 1, 1), QTime(10, 0), Qt::UTC));
+    const MemoryUsage empty = event->memoryUsage();
+    QVERIFY(empty.bytes(MemoryUsage::IncidenceObjects) > 0);
+    QCOMPARE(empty.bytes(MemoryUsage::Persons), qint64(0));
+    QCOMPARE(empty.bytes(MemoryUsage::Alarms), qint64(0));
+    QCOMPARE(empty.bytes(MemoryUsage::Attachments), qint64(0));
+    QCOMPARE(empty.bytes(MemoryUsage::RecurrenceRules), qint64(0));
+
+    event->setDescription(QString(10000, QLatin1Char('x')));
+    event->addAttendee(Attendee::Ptr(new Attendee(QStringLiteral("Name"), QStringLiteral("name@example.com"))));
+    Alarm::Ptr alarm = event->newAlarm();
+    alarm->setDisplayAlarm(QStringLiteral("Reminder"));
+    event->addAttachment(Attachment::Ptr(new Attachment(QByteArray(100000, 'a'))));
+    event->recurrence()->setDaily(1);
+    event->recurrence()->setDuration(100);
+    event->recurrence()->timesInInterval(event->dtStart(), event->dtStart().addDays(200));
+
+    const MemoryUsage usage = event->memoryUsage();
+    QVERIFY(usage.bytes(MemoryUsage::Strings) >= empty.bytes(MemoryUsage::Strings) + 10000 * qint64(sizeof(QChar)));
+    QVERIFY(usage.bytes(MemoryUsage::Persons) > 0);
+    QVERIFY(usage.bytes(MemoryUsage::Alarms) > 0);
+    QVERIFY(usage.bytes(MemoryUsage::Attachments) >= 100000);
+    QVERIFY(usage.bytes(MemoryUsage::RecurrenceRules) > 0);
+    // The 100 occurrences are cached
+    QVERIFY(usage.bytes(MemoryUsage::RecurrenceCaches) >= 100 * qint64(sizeof(QDateTime)));
+    QCOMPARE(usage.bytes(MemoryUsage::CalendarIndexes), qint64(0));
+
+    qint64 total = 0;
+    for (int i = 0; i < MemoryUsage::CategoryCount; ++i) {
+        total += usage.bytes(MemoryUsage::Category(i));
+    }
+    QCOMPARE(usage.totalBytes(), total);
+}
+
+void MemoryUsageTest::testSharedData()
+{
+    const QString description(10000, QLatin1Char('x'));
+    Event::Ptr event1(new Event);
+    event1->setDescription(description);
+    Event::Ptr event2(new Event);
+    event2->setDescription(description);
+
+    MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+    calendar->addEvent(event1);
+    calendar->addEvent(event2);
+
+    // The implicitly shared description is counted once
+    const qint64 single = event1->memoryUsage().bytes(MemoryUsage::Strings);
+    QVERIFY(single >= 10000 * qint64(sizeof(QChar)));
+    QVERIFY(calendar->memoryUsage().bytes(MemoryUsage::Strings) < 2 * single);
+}
+
+void MemoryUsageTest::testCalendar()
+{
+    MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+    const MemoryUsage empty = calendar->memoryUsage();
+
+    Event::Ptr event(new Event);
+    event->setDtStart(QDateTime(QDate(2018, 1, 1), QTime(10, 0), Qt::UTC));
+    event->setCategories(QStringList() << QStringLiteral("Work"));
+    QVERIFY(calendar->addNotebook(QStringLiteral("notebook"), true));
+    QVERIFY(calendar->addEvent(event));
+    QVERIFY(calendar->setNotebook(event, QStringLiteral("notebook")));
+
+    const MemoryUsage usage = calendar->memoryUsage();
+    QVERIFY(usage.bytes(MemoryUsage::IncidenceObjects)
+            >= empty.bytes(MemoryUsage::IncidenceObjects) + event->memoryUsage().bytes(MemoryUsage::IncidenceObjects));
+    QVERIFY(usage.bytes(MemoryUsage::CalendarIndexes) > empty.bytes(MemoryUsage::CalendarIndexes));
+    QVERIFY(usage.bytes(MemoryUsage::CalendarMaps) > empty.bytes(MemoryUsage::CalendarMaps));
+
+    // Deleted incidences are still retained
+    QVERIFY(calendar->deleteEvent(event));
+    const MemoryUsage deleted = calendar->memoryUsage();
+    QVERIFY(deleted.bytes(MemoryUsage::IncidenceObjects)
+            >= empty.bytes(MemoryUsage::IncidenceObjects) + event->memoryUsage().bytes(MemoryUsage::IncidenceObjects));
+}
@@ -300,3 +300,56 @@ void TestOccurrenceIterator::testJournals()
     KCalCore::OccurrenceIterator rIt2(calendar, tomorrow, tomorrow.addDays(1));
     QVERIFY(!rIt2.hasNext());
 }
+
+void TestOccurrenceIterator::testParallelExpansion()
+{
+    KCalCore::MemoryCalendar calendar(QTimeZone::utc());
+    const QDateTime start(QDate(2013, 03, 10), QTime(10, 0, 0), Qt::UTC);
+
+    for (int i = 0; i < 200; ++i) {
+        KCalCore::Event::Ptr event(new KCalCore::Event());
+        event->setUid(QStringLiteral("event%1").arg(i));
+        event->setSummary(event->uid());
+        event->setDtStart(start.addSecs(3600 * i));
+        event->setDtEnd(start.addSecs(3600 * (i + 1)));
+        if (i % 4 != 0) {
+            event->recurrence()->setDaily(1 + i % 3);
+        }
+        calendar.addEvent(event);
+
+        if (i % 8 == 1) {
+            KCalCore::Event::Ptr exception(new KCalCore::Event());
+            exception->setUid(event->uid());
+            exception->setSummary(QStringLiteral("exception"));
+            exception->setRecurrenceId(event->dtStart().addDays(2 * (1 + i % 3)));
+            exception->setDtStart(exception->recurrenceId().addSecs(1800));
+            exception->setDtEnd(exception->recurrenceId().addSecs(3600));
+            calendar.addEvent(exception);
+        }
+
+        KCalCore::Todo::Ptr todo(new KCalCore::Todo());
+        todo->setUid(QStringLiteral("todo%1").arg(i));
+        todo->setDtStart(start.addSecs(1800 * i));
+        todo->setDtDue(start.addSecs(1800 * i + 3600));
+        if (i % 2) {
+            todo->recurrence()->setWeekly(1);
+        }
+        calendar.addTodo(todo);
+    }
+
+    const QDateTime end = start.addDays(60);
+    KCalCore::OccurrenceIterator serial(calendar, start, end, KCalCore::OccurrenceIterator::SerialExpansion);
+    KCalCore::OccurrenceIterator parallel(calendar, start, end, KCalCore::OccurrenceIterator::ParallelExpansion);
+    int occurrences = 0;
+    while (serial.hasNext()) {
+        QVERIFY(parallel.hasNext());
+        serial.next();
+        parallel.next();
+        QCOMPARE(parallel.incidence(), serial.incidence());
+        QCOMPARE(parallel.occurrenceStartDate(), serial.occurrenceStartDate());
+        QCOMPARE(parallel.recurrenceId(), serial.recurrenceId());
+        ++occurrences;
+    }
+    QVERIFY(!parallel.hasNext());
+    QVERIFY(occurrences > 400);
+}
@@ -30,6 +30,7 @@ private Q_SLOTS:
     void testWithExceptionThisAndFuture();
     void testSubDailyRecurrences();
     void testJournals();
+    void testParallelExpansion();
 };
 
 #endif // TESTOCCURRENCEITERATOR_H
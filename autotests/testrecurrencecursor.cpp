@@ -0,0 +1,145 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "testrecurrencecursor.h"
+#include "icalformat.h"
+#include "recurrence.h"
+
+#include <QBitArray>
+#include <QTest>
+#include <QTimeZone>
+
+QTEST_MAIN(RecurrenceCursorTest)
+
+using namespace KCalCore;
+
+void RecurrenceCursorTest::testRuleCursor_data()
+{
+    QTest::addColumn<QString>("rule");
+    QTest::addColumn<bool>("allDay");
+
+    QTest::newRow("daily") << QStringLiteral("FREQ=DAILY;INTERVAL=3") << false;
+    QTest::newRow("daily all-day") << QStringLiteral("FREQ=DAILY") << true;
+    QTest::newRow("weekly byday") << QStringLiteral("FREQ=WEEKLY;BYDAY=MO,WE,FR") << false;
+    QTest::newRow("monthly bysetpos") << QStringLiteral("FREQ=MONTHLY;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-1") << false;
+    QTest::newRow("yearly bymonthday") << QStringLiteral("FREQ=YEARLY;BYMONTH=2;BYMONTHDAY=29") << true;
+    QTest::newRow("monthly until") << QStringLiteral("FREQ=MONTHLY;BYMONTHDAY=31;UNTIL=20150101T000000Z") << false;
+    QTest::newRow("weekly count") << QStringLiteral("FREQ=WEEKLY;COUNT=30") << false;
+    QTest::newRow("hourly") << QStringLiteral("FREQ=HOURLY;INTERVAL=5") << false;
+    QTest::newRow("hourly byminute") << QStringLiteral("FREQ=HOURLY;BYMINUTE=0,20,40") << false;
+}
+
+void RecurrenceCursorTest::testRuleCursor()
+{
+    QFETCH(QString, rule);
+    QFETCH(bool, allDay);
+
+    RecurrenceRule recurrenceRule;
+    QVERIFY(ICalFormat().fromString(&recurrenceRule, rule));
+    const QTimeZone timeZone("Europe/Berlin");
+    recurrenceRule.setStartDt(QDateTime(QDate(2012, 1, 31), QTime(9, 30), timeZone));
+    recurrenceRule.setAllDay(allDay);
+
+    // Start before, within and after the interval of an occurrence
+    const QDateTime from(QDate(2012, 3, 10), QTime(12, 0), timeZone);
+    for (const QDateTime &start : {from.addYears(-1), from, from.addDays(200)}) {
+        RecurrenceRule::Cursor forward(&recurrenceRule, start);
+        QDateTime expected = start;
+        for (int i = 0; i < 100; ++i) {
+            expected = recurrenceRule.getNextDate(expected);
+            QCOMPARE(forward.next(), expected);
+            if (!expected.isValid()) {
+                break;
+            }
+        }
+
+        RecurrenceRule::Cursor backward(&recurrenceRule, start, RecurrenceRule::Cursor::Backward);
+        expected = start;
+        for (int i = 0; i < 100; ++i) {
+            expected = recurrenceRule.getPreviousDate(expected);
+            QCOMPARE(backward.next(), expected);
+            if (!expected.isValid()) {
+                break;
+            }
+        }
+    }
+}
+
+void RecurrenceCursorTest::testRecurrenceCursor()
+{
+    const QDateTime start(QDate(2013, 3, 10), QTime(10, 0), QTimeZone("Europe/Berlin"));
+    Recurrence recurrence;
+    recurrence.setStartDateTime(start, false);
+    QBitArray days(7);
+    days.setBit(0);
+    days.setBit(2);
+    days.setBit(4);
+    recurrence.setWeekly(1, days);
+    RecurrenceRule *rule = new RecurrenceRule();
+    QVERIFY(ICalFormat().fromString(rule, QStringLiteral("FREQ=MONTHLY;BYMONTHDAY=15,16")));
+    rule->setStartDt(start.addSecs(3600));
+    recurrence.addRRule(rule);
+    recurrence.addRDateTime(start.addDays(2).addSecs(600));
+    recurrence.addRDate(start.date().addDays(4));
+    recurrence.addExDate(start.date().addDays(8));
+    recurrence.addExDateTime(start.addDays(10));
+    RecurrenceRule *exRule = new RecurrenceRule();
+    QVERIFY(ICalFormat().fromString(exRule, QStringLiteral("FREQ=WEEKLY;INTERVAL=3;BYDAY=TU")));
+    exRule->setStartDt(start);
+    recurrence.addExRule(exRule);
+
+    for (const QDateTime &from : {start.addSecs(-1), start.addDays(5), start.addMonths(2)}) {
+        Recurrence::Cursor forward(&recurrence, from);
+        QDateTime expected = from;
+        for (int i = 0; i < 100; ++i) {
+            expected = recurrence.getNextDateTime(expected);
+            QVERIFY(expected.isValid());
+            QCOMPARE(forward.next(), expected);
+        }
+
+        Recurrence::Cursor backward(&recurrence, from, Recurrence::Cursor::Backward);
+        expected = from;
+        for (int i = 0; i < 100; ++i) {
+            expected = recurrence.getPreviousDateTime(expected);
+            QCOMPARE(backward.next(), expected);
+            if (!expected.isValid()) {
+                break;
+            }
+        }
+    }
+}
+
+void RecurrenceCursorTest::testExhausted()
+{
+    const QDateTime start(QDate(2013, 3, 10), QTime(10, 0), Qt::UTC);
+    Recurrence recurrence;
+    recurrence.setStartDateTime(start, false);
+    recurrence.setDaily(1);
+    recurrence.setDuration(3);
+
+    Recurrence::Cursor cursor(&recurrence, start);
+    QCOMPARE(cursor.next(), start.addDays(1));
+    QCOMPARE(cursor.next(), start.addDays(2));
+    QVERIFY(!cursor.next().isValid());
+    QVERIFY(!cursor.next().isValid());
+
+    // Nothing before the start
+    Recurrence::Cursor backward(&recurrence, start, Recurrence::Cursor::Backward);
+    QVERIFY(!backward.next().isValid());
+}
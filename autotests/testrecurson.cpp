@@ -24,6 +24,7 @@
 #include "memorycalendar.h"
 #include "utils.h"
 
+#include <QBitArray>
 #include <QDebug>
 #include <QDate>
 #include <QFile>
@@ -96,13 +97,22 @@ int main(int argc, char **argv)
         if (outstream) {
             // Output to file for testing purposes
             int nr = 0;
+            QBitArray days(dt.daysTo(QDate(2021, 1, 1)));
             while (dt.year() <= 2020 && nr <= 500) {
                 if (incidence->recursOn(dt, viewZone)) {
                     (*outstream) << dt.toString(Qt::ISODate) << endl;
+                    days.setBit(QDate(1996, 7, 1).daysTo(dt));
                     nr++;
                 }
                 dt = dt.addDays(1);
             }
+            // The bitmap of the checked dates must agree with recursOn()
+            days.resize(QDate(1996, 7, 1).daysTo(dt));
+            if (incidence->recurrence()->recursOnDates(QDate(1996, 7, 1), dt.addDays(-1), viewZone) != days) {
+                qWarning() << "recursOnDates() differs from recursOn() for" << incidence->summary();
+                delete outstream;
+                return 1;
+            }
         } else {
             dt = QDate(2005, 1, 1);
             while (dt.year() < 2007) {
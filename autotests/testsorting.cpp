@@ -0,0 +1,242 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "testsorting.h"
+#include "memorycalendar.h"
+#include "sorting.h"
+
+#include <QTest>
+QTEST_MAIN(SortingTest)
+
+using namespace KCalCore;
+
+static const QDateTime s_base(QDate(2017, 3, 1), QTime(0, 0), Qt::UTC);
+
+// Timed incidences start on even days at whole hours, all-day incidences
+// are on odd days, so the comparators from sorting.h define a strict order
+// up to incidences with equal dates and summaries.
+static void setupIncidence(const Incidence::Ptr &incidence, int i)
+{
+    if (i % 5 == 0) {
+        incidence->setDtStart(QDateTime(s_base.date().addDays(2 * ((i * 7) % 11) + 1), QTime(), Qt::UTC));
+        incidence->setAllDay(true);
+    } else {
+        incidence->setDtStart(s_base.addDays(2 * ((i * 3) % 7)).addSecs(3600 * ((i * 37) % 23)));
+    }
+    incidence->setSummary(i % 2 ? QStringLiteral("Item %1").arg((i * 13) % 17)
+                          : QStringLiteral("item %1").arg((i * 13) % 17));
+}
+
+// All-day to-dos are created on whole days after the creation times of the
+// timed ones, which all fall on the base day.
+static QDateTime createdAt(int i)
+{
+    return i % 5 == 0 ? s_base.addDays(1 + (i * 7) % 11) : s_base.addSecs(60 * ((i * 11) % 31));
+}
+
+template<typename List, typename LessThan>
+static void verifySorted(const List &unsorted, const List &sorted, LessThan lessThan)
+{
+    QCOMPARE(sorted.count(), unsorted.count());
+    for (const auto &incidence : unsorted) {
+        QCOMPARE(sorted.count(incidence), unsorted.count(incidence));
+    }
+    for (int i = 1; i < sorted.count(); ++i) {
+        QVERIFY(!lessThan(sorted.at(i), sorted.at(i - 1)));
+    }
+}
+
+void SortingTest::initTestCase()
+{
+    qputenv("TZ", "UTC");
+}
+
+void SortingTest::testSortEvents()
+{
+    Event::List events;
+    for (int i = 0; i < 200; ++i) {
+        Event::Ptr event(new Event);
+        setupIncidence(event, i);
+        event->setDtEnd(event->dtStart().addSecs(event->allDay() ? 0 : 3600 * (i % 3)));
+        events.append(event);
+    }
+
+    verifySorted(events, Calendar::sortEvents(events, EventSortStartDate, SortDirectionAscending),
+                 Events::startDateLessThan);
+    verifySorted(events, Calendar::sortEvents(events, EventSortStartDate, SortDirectionDescending),
+                 Events::startDateMoreThan);
+    verifySorted(events, Calendar::sortEvents(events, EventSortEndDate, SortDirectionAscending),
+                 Events::endDateLessThan);
+    verifySorted(events, Calendar::sortEvents(events, EventSortEndDate, SortDirectionDescending),
+                 Events::endDateMoreThan);
+    verifySorted(events, Calendar::sortEvents(events, EventSortSummary, SortDirectionAscending),
+                 Events::summaryLessThan);
+    verifySorted(events, Calendar::sortEvents(events, EventSortSummary, SortDirectionDescending),
+                 Events::summaryMoreThan);
+    QCOMPARE(Calendar::sortEvents(events, EventSortUnsorted, SortDirectionAscending), events);
+    QVERIFY(Calendar::sortEvents(Event::List(), EventSortStartDate, SortDirectionAscending).isEmpty());
+}
+
+void SortingTest::testSortTodos()
+{
+    Todo::List todos;
+    for (int i = 0; i < 200; ++i) {
+        Todo::Ptr todo(new Todo);
+        setupIncidence(todo, i);
+        todo->setDtDue(todo->dtStart().addDays(2 * (i % 4)));
+        todo->setCreated(createdAt(i));
+        todo->setPriority(i % 10);
+        todo->setPercentComplete(10 * (i % 11));
+        todos.append(todo);
+    }
+
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortStartDate, SortDirectionAscending),
+                 Todos::startDateLessThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortStartDate, SortDirectionDescending),
+                 Todos::startDateMoreThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortDueDate, SortDirectionAscending),
+                 Todos::dueDateLessThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortDueDate, SortDirectionDescending),
+                 Todos::dueDateMoreThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortPriority, SortDirectionAscending),
+                 Todos::priorityLessThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortPriority, SortDirectionDescending),
+                 Todos::priorityMoreThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortPercentComplete, SortDirectionAscending),
+                 Todos::percentLessThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortPercentComplete, SortDirectionDescending),
+                 Todos::percentMoreThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortSummary, SortDirectionAscending),
+                 Todos::summaryLessThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortSummary, SortDirectionDescending),
+                 Todos::summaryMoreThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortCreated, SortDirectionAscending),
+                 Todos::createdLessThan);
+    verifySorted(todos, Calendar::sortTodos(todos, TodoSortCreated, SortDirectionDescending),
+                 Todos::createdMoreThan);
+}
+
+void SortingTest::testSortJournals()
+{
+    Journal::List journals;
+    for (int i = 0; i < 200; ++i) {
+        Journal::Ptr journal(new Journal);
+        setupIncidence(journal, i);
+        journals.append(journal);
+    }
+
+    verifySorted(journals, Calendar::sortJournals(journals, JournalSortDate, SortDirectionAscending),
+                 Journals::dateLessThan);
+    verifySorted(journals, Calendar::sortJournals(journals, JournalSortDate, SortDirectionDescending),
+                 Journals::dateMoreThan);
+    verifySorted(journals, Calendar::sortJournals(journals, JournalSortSummary, SortDirectionAscending),
+                 Journals::summaryLessThan);
+    verifySorted(journals, Calendar::sortJournals(journals, JournalSortSummary, SortDirectionDescending),
+                 Journals::summaryMoreThan);
+}
+
+void SortingTest::testSummaryCaseFolding()
+{
+    const QStringList summaries = {
+        QStringLiteral("b"), QStringLiteral("A"), QStringLiteral("ä"), QStringLiteral("Äb"),
+        QStringLiteral("a"), QStringLiteral("Straße"), QStringLiteral("STRASSE"), QStringLiteral("ab"),
+        QStringLiteral("Σ"), QStringLiteral("σ"), QString(), QStringLiteral("\U0001D400")
+    };
+    Event::List events;
+    for (const QString &summary : summaries) {
+        Event::Ptr event(new Event);
+        event->setDtStart(s_base);
+        event->setSummary(summary);
+        events.append(event);
+    }
+
+    verifySorted(events, Calendar::sortEvents(events, EventSortSummary, SortDirectionAscending),
+                 Events::summaryLessThan);
+    verifySorted(events, Calendar::sortEvents(events, EventSortStartDate, SortDirectionDescending),
+                 Events::startDateMoreThan);
+}
+
+void SortingTest::testSortPage_data()
+{
+    QTest::addColumn<int>("sortField");
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<int>("limit");
+
+    for (int field = TodoSortStartDate; field <= TodoSortCreated; ++field) {
+        const auto addRow = [field](const char *page, int offset, int limit) {
+            const QByteArray name = QByteArray::number(field) + ' ' + page;
+            QTest::newRow(name.constData()) << field << offset << limit;
+        };
+        addRow("first", 0, 50);
+        addRow("middle", 75, 50);
+        addRow("last", 180, 50);
+        addRow("beyond", 250, 50);
+        addRow("empty", 10, 0);
+        addRow("unlimited", 10, -1);
+    }
+}
+
+void SortingTest::testSortPage()
+{
+    QFETCH(int, sortField);
+    QFETCH(int, offset);
+    QFETCH(int, limit);
+
+    // Unique summaries, so that the sorted order is fully defined
+    Todo::List todos;
+    for (int i = 0; i < 200; ++i) {
+        Todo::Ptr todo(new Todo);
+        setupIncidence(todo, i);
+        todo->setSummary(QStringLiteral("Item %1").arg(i));
+        todo->setDtDue(todo->dtStart().addDays(2 * (i % 4)));
+        todo->setCreated(createdAt(i));
+        todo->setPriority(i % 10);
+        todo->setPercentComplete(10 * (i % 11));
+        todos.append(todo);
+    }
+
+    const TodoSortField field = static_cast<TodoSortField>(sortField);
+    for (SortDirection direction : {SortDirectionAscending, SortDirectionDescending}) {
+        const Todo::List sorted = Calendar::sortTodos(todos, field, direction);
+        QCOMPARE(Calendar::sortTodos(todos, field, direction, offset, limit),
+                 sorted.mid(offset, limit));
+    }
+}
+
+void SortingTest::testCalendarPage()
+{
+    MemoryCalendar::Ptr cal(new MemoryCalendar(QTimeZone::utc()));
+    for (int i = 0; i < 100; ++i) {
+        Event::Ptr event(new Event);
+        event->setDtStart(s_base.addSecs(3600 * ((i * 37) % 100)));
+        event->setSummary(QStringLiteral("Event %1").arg(i));
+        cal->addEvent(event);
+
+        Todo::Ptr todo(new Todo);
+        todo->setDtDue(s_base.addSecs(3600 * ((i * 37) % 100)));
+        todo->setSummary(QStringLiteral("Todo %1").arg(i));
+        cal->addTodo(todo);
+    }
+
+    const Event::List events = cal->events(EventSortStartDate, SortDirectionAscending);
+    QCOMPARE(cal->events(EventSortStartDate, SortDirectionAscending, 20, 10), events.mid(20, 10));
+
+    const Todo::List todos = cal->todos(TodoSortDueDate, SortDirectionDescending);
+    QCOMPARE(cal->todos(TodoSortDueDate, SortDirectionDescending, 0, 50), todos.mid(0, 50));
+}
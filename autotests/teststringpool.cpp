@@ -0,0 +1,123 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "teststringpool.h"
+#include "calendargenerator.h"
+#include "icalformat.h"
+#include "memorycalendar.h"
+#include "stringpool.h"
+
+#include <QDebug>
+#include <QSet>
+#include <QTest>
+#include <QTimeZone>
+
+QTEST_MAIN(StringPoolTest)
+
+using namespace KCalCore;
+
+void StringPoolTest::testIntern()
+{
+    StringPool pool;
+    QCOMPARE(pool.count(), 0);
+
+    const QString first = pool.intern(QString::fromLatin1("category"));
+    const QString second = pool.intern(QString::fromLatin1("category"));
+    QCOMPARE(first, QStringLiteral("category"));
+    QCOMPARE(second, first);
+    QCOMPARE(second.constData(), first.constData());
+    QCOMPARE(pool.intern(QString()), QString());
+    QCOMPARE(pool.count(), 1);
+
+    const QString other = pool.intern(QString::fromLatin1("other"));
+    QVERIFY(other.constData() != first.constData());
+    QCOMPARE(pool.count(), 2);
+
+    pool.clear();
+    QCOMPARE(pool.count(), 0);
+    QCOMPARE(first, QStringLiteral("category"));
+    QVERIFY(pool.intern(QString::fromLatin1("category")).constData() != first.constData());
+}
+
+// Returns the size of the string data of the categories, organizers and
+// attendees of @p calendar, counting data shared between strings once
+static qint64 stringDataSize(const Calendar::Ptr &calendar)
+{
+    QSet<const QChar *> seen;
+    qint64 size = 0;
+    auto account = [&seen, &size](const QString &string) {
+        if (!string.isEmpty() && !seen.contains(string.constData())) {
+            seen.insert(string.constData());
+            size += (string.capacity() + 1) * sizeof(QChar);
+        }
+    };
+
+    const Incidence::List incidences = calendar->rawIncidences();
+    for (const Incidence::Ptr &incidence : incidences) {
+        const QStringList categories = incidence->categories();
+        for (const QString &category : categories) {
+            account(category);
+        }
+        account(incidence->organizer()->name());
+        account(incidence->organizer()->email());
+        const Attendee::List attendees = incidence->attendees();
+        for (const Attendee::Ptr &attendee : attendees) {
+            account(attendee->name());
+            account(attendee->email());
+        }
+    }
+    return size;
+}
+
+void StringPoolTest::testMemoryUsage()
+{
+    // A calendar of a small team: a few people and categories, many meetings
+    CalendarGenerator::Settings settings;
+    settings.count = 1000;
+    settings.attendeePercent = 100;
+    settings.people = 30;
+    const MemoryCalendar::Ptr calendar = CalendarGenerator(settings).generate();
+
+    ICalFormat format;
+    const QString serialized = format.toString(calendar);
+
+    MemoryCalendar::Ptr plain(new MemoryCalendar(QTimeZone::utc()));
+    QVERIFY(ICalFormat().fromString(plain, serialized));
+
+    MemoryCalendar::Ptr interned(new MemoryCalendar(QTimeZone::utc()));
+    ICalFormat internedFormat;
+    internedFormat.setStringPool(StringPool::Ptr(new StringPool));
+    QVERIFY(internedFormat.fromString(interned, serialized));
+    // At most the categories and the names and emails of the people
+    QVERIFY(internedFormat.stringPool()->count() <= settings.categories.count() + 2 * settings.people);
+
+    QCOMPARE(interned->rawIncidences().count(), plain->rawIncidences().count());
+    for (const Incidence::Ptr &incidence : plain->rawIncidences()) {
+        const Incidence::Ptr other = interned->instance(incidence->instanceIdentifier());
+        QVERIFY(other);
+        QCOMPARE(other->categories(), incidence->categories());
+        QCOMPARE(*other->organizer(), *incidence->organizer());
+        QCOMPARE(other->attendeeCount(), incidence->attendeeCount());
+    }
+
+    const qint64 plainSize = stringDataSize(plain);
+    const qint64 internedSize = stringDataSize(interned);
+    qDebug() << "string data without pool:" << plainSize << "bytes, with pool:" << internedSize << "bytes";
+    QVERIFY(internedSize * 50 < plainSize);
+}
@@ -21,9 +21,12 @@
 */
 #include "testtimesininterval.h"
 #include "event.h"
+#include "recurrencerule.h"
 #include "utils.h"
 
+#include <QBitArray>
 #include <QDebug>
+#include <QTimeZone>
 
 #include <QTest>
 QTEST_MAIN(TimesInIntervalTest)
@@ -156,3 +159,190 @@ void TimesInIntervalTest::testSubDailyRecurrenceIntervalLimits()
     }
     QCOMPARE(expectedEventOccurrences.size(), 0);
 }
+
+//Test merging several rules and rdates, and removing exdates, exdatetimes and exrules
+void TimesInIntervalTest::testSubDailyNextDate_data()
+{
+    QTest::addColumn<int>("period");
+    QTest::addColumn<int>("frequency");
+    QTest::addColumn<int>("step");
+
+    QTest::newRow("secondly") << int(RecurrenceRule::rSecondly) << 1 << 1;
+    QTest::newRow("every 7 seconds") << int(RecurrenceRule::rSecondly) << 7 << 7;
+    QTest::newRow("minutely") << int(RecurrenceRule::rMinutely) << 1 << 60;
+    QTest::newRow("every 3 hours") << int(RecurrenceRule::rHourly) << 3 << 3 * 3600;
+}
+
+void TimesInIntervalTest::testSubDailyNextDate()
+{
+    QFETCH(int, period);
+    QFETCH(int, frequency);
+    QFETCH(int, step);
+
+    const QDateTime start(QDate(2013, 03, 10), QTime(10, 2, 3), Qt::UTC);
+    RecurrenceRule rule;
+    rule.setRecurrenceType(static_cast<RecurrenceRule::PeriodType>(period));
+    rule.setFrequency(frequency);
+    rule.setStartDt(start);
+    rule.setDuration(-1);
+
+    QCOMPARE(rule.getNextDate(start.addSecs(-1)), start);
+    QCOMPARE(rule.getNextDate(start.addSecs(-step - 1)), start);
+    for (int i = 0; i < 5; ++i) {
+        const QDateTime occurrence = start.addSecs(qint64(i) * step);
+        QCOMPARE(rule.getNextDate(occurrence.addSecs(-1)), occurrence);
+        QCOMPARE(rule.getNextDate(occurrence), occurrence.addSecs(step));
+    }
+}
+
+void TimesInIntervalTest::testExclusions()
+{
+    const QDateTime start(QDate(2013, 03, 10), QTime(0, 0, 0), Qt::UTC);
+    const QDateTime end = start.addDays(3).addSecs(-1);
+    const QDateTime rDateTime = start.addSecs(30 * 60);
+    const QDateTime exDateTime = start.addSecs(5 * 60 * 60);
+    const QDate exDate = start.date().addDays(1);
+
+    KCalCore::Recurrence recurrence;
+    recurrence.setStartDateTime(start, false);
+    recurrence.setHourly(1);
+    KCalCore::RecurrenceRule *rule = new KCalCore::RecurrenceRule();
+    rule->setRecurrenceType(KCalCore::RecurrenceRule::rMinutely);
+    rule->setFrequency(90);
+    rule->setStartDt(start);
+    recurrence.addRRule(rule);
+    recurrence.addRDateTime(rDateTime);
+    recurrence.addExDate(exDate);
+    recurrence.addExDateTime(exDateTime);
+    KCalCore::RecurrenceRule *exRule = new KCalCore::RecurrenceRule();
+    exRule->setRecurrenceType(KCalCore::RecurrenceRule::rHourly);
+    exRule->setFrequency(6);
+    exRule->setStartDt(start);
+    recurrence.addExRule(exRule);
+
+    QList<QDateTime> expected;
+    for (int minute = 0; minute < 3 * 24 * 60; ++minute) {
+        const QDateTime dt = start.addSecs(minute * 60);
+        if ((minute % 60 == 0 || minute % 90 == 0 || dt == rDateTime)
+            && dt.date() != exDate && dt != exDateTime && minute % 360 != 0) {
+            expected << dt;
+        }
+    }
+
+    QCOMPARE(static_cast<QList<QDateTime> >(recurrence.timesInInterval(start, end)), expected);
+
+    // Stepping through the occurrences gives the same times
+    QList<QDateTime> forward;
+    for (QDateTime dt = recurrence.getNextDateTime(start.addSecs(-1)); dt.isValid() && dt <= end;
+         dt = recurrence.getNextDateTime(dt)) {
+        forward << dt;
+    }
+    QCOMPARE(forward, expected);
+    QList<QDateTime> backward;
+    for (QDateTime dt = recurrence.getPreviousDateTime(end); dt.isValid();
+         dt = recurrence.getPreviousDateTime(dt)) {
+        backward.prepend(dt);
+    }
+    QCOMPARE(backward, expected);
+}
+
+//Test that any number of excluded occurrences is skipped
+void TimesInIntervalTest::testNextDateTimeExclusions()
+{
+    const QDateTime start(QDate(2013, 03, 10), QTime(0, 0, 0), Qt::UTC);
+    const int excluded = 5000;
+
+    KCalCore::Recurrence recurrence;
+    recurrence.setStartDateTime(start, false);
+    KCalCore::RecurrenceRule *rule = new KCalCore::RecurrenceRule();
+    rule->setRecurrenceType(KCalCore::RecurrenceRule::rSecondly);
+    rule->setFrequency(1);
+    rule->setStartDt(start);
+    recurrence.addRRule(rule);
+    KCalCore::DateTimeList exDateTimes;
+    for (int i = 1; i <= excluded; ++i) {
+        exDateTimes << start.addSecs(i);
+    }
+    recurrence.setExDateTimes(exDateTimes);
+
+    QCOMPARE(recurrence.getNextDateTime(start), start.addSecs(excluded + 1));
+    QCOMPARE(recurrence.getPreviousDateTime(start.addSecs(excluded + 1)), start);
+
+    // An exrule which excludes all occurrences must not loop forever
+    recurrence.addExRule(new KCalCore::RecurrenceRule(*rule));
+    QVERIFY(!recurrence.getNextDateTime(start).isValid());
+}
+
+//Test that the times cached by recurTimesOn() follow changes of the recurrence
+void TimesInIntervalTest::testRecurTimesOnCache()
+{
+    const QDateTime start(QDate(2013, 03, 10), QTime(10, 0, 0), Qt::UTC);
+    const QDate date(2013, 03, 11);
+
+    KCalCore::Event::Ptr event(new KCalCore::Event());
+    event->setUid(QStringLiteral("event"));
+    event->setDtStart(start);
+    event->recurrence()->setDaily(1);
+    KCalCore::Recurrence *recurrence = event->recurrence();
+
+    QCOMPARE(recurrence->recurTimesOn(date, QTimeZone::utc()), KCalCore::TimeList() << QTime(10, 0, 0));
+    QCOMPARE(recurrence->recurTimesOn(date, QTimeZone::utc()), KCalCore::TimeList() << QTime(10, 0, 0));
+
+    // Different time zones are cached separately
+    const QTimeZone berlin("Europe/Berlin");
+    QCOMPARE(recurrence->recurTimesOn(date, berlin), KCalCore::TimeList() << QTime(11, 0, 0));
+
+    recurrence->addRDateTime(QDateTime(date, QTime(15, 0, 0), Qt::UTC));
+    QCOMPARE(recurrence->recurTimesOn(date, QTimeZone::utc()),
+             KCalCore::TimeList() << QTime(10, 0, 0) << QTime(15, 0, 0));
+
+    recurrence->setExDateTimes(KCalCore::DateTimeList() << QDateTime(date, QTime(10, 0, 0), Qt::UTC));
+    QCOMPARE(recurrence->recurTimesOn(date, QTimeZone::utc()), KCalCore::TimeList() << QTime(15, 0, 0));
+    QVERIFY(recurrence->recursOn(date, QTimeZone::utc()));
+
+    // Changing the rule itself also clears the cache
+    const QDate otherDate(2013, 03, 13);
+    QCOMPARE(recurrence->recurTimesOn(otherDate, QTimeZone::utc()), KCalCore::TimeList() << QTime(10, 0, 0));
+    recurrence->defaultRRule()->setFrequency(2);
+    QVERIFY(recurrence->recurTimesOn(otherDate, QTimeZone::utc()).isEmpty());
+    QCOMPARE(recurrence->recurTimesOn(date, QTimeZone::utc()), KCalCore::TimeList() << QTime(15, 0, 0));
+
+    recurrence->setRDateTimes(KCalCore::DateTimeList());
+    QVERIFY(recurrence->recurTimesOn(date, QTimeZone::utc()).isEmpty());
+    QVERIFY(!recurrence->recursOn(date, QTimeZone::utc()));
+
+    QCOMPARE(recurrence->recurTimesOn(QDate(2013, 03, 12), berlin), KCalCore::TimeList() << QTime(11, 0, 0));
+    recurrence->shiftTimes(QTimeZone::utc(), berlin);
+    QCOMPARE(recurrence->recurTimesOn(QDate(2013, 03, 12), berlin), KCalCore::TimeList() << QTime(10, 0, 0));
+}
+
+//Test that the days cached by recursOnDates() follow changes of the recurrence
+void TimesInIntervalTest::testRecursOnDatesCache()
+{
+    const QDateTime start(QDate(2013, 03, 10), QTime(10, 0, 0), Qt::UTC);
+    const QDate first(2013, 03, 11);
+    const QDate last(2013, 03, 14);
+
+    KCalCore::Event::Ptr event(new KCalCore::Event());
+    event->setUid(QStringLiteral("event"));
+    event->setDtStart(start);
+    event->recurrence()->setDaily(1);
+    KCalCore::Recurrence *recurrence = event->recurrence();
+
+    QBitArray days(4, true);
+    QCOMPARE(recurrence->recursOnDates(first, last, QTimeZone::utc()), days);
+    QCOMPARE(recurrence->recursOnDates(first, last, QTimeZone::utc()), days);
+
+    recurrence->addExDate(QDate(2013, 03, 12));
+    days.clearBit(1);
+    QCOMPARE(recurrence->recursOnDates(first, last, QTimeZone::utc()), days);
+
+    recurrence->setExDateTimes(KCalCore::DateTimeList() << QDateTime(QDate(2013, 03, 13), QTime(10, 0, 0), Qt::UTC));
+    days.clearBit(2);
+    QCOMPARE(recurrence->recursOnDates(first, last, QTimeZone::utc()), days);
+
+    // Changing the rule itself also clears the cache
+    recurrence->defaultRRule()->setFrequency(2);
+    days.clearBit(0);
+    QCOMPARE(recurrence->recursOnDates(first, last, QTimeZone::utc()), days);
+}
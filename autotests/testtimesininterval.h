@@ -33,6 +33,12 @@ private Q_SLOTS:
     void testSubDailyRecurrenceIntervalInclusive();
     void testSubDailyRecurrence2();
     void testSubDailyRecurrenceIntervalLimits();
+    void testSubDailyNextDate_data();
+    void testSubDailyNextDate();
+    void testExclusions();
+    void testNextDateTimeExclusions();
+    void testRecurTimesOnCache();
+    void testRecursOnDatesCache();
 };
 
 #endif
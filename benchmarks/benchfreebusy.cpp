@@ -0,0 +1,44 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "benchfreebusy.h"
+#include "benchmarkcalendar.h"
+#include "freebusy.h"
+
+#include <QTest>
+
+QTEST_MAIN(BenchFreeBusy)
+
+using namespace KCalCore;
+
+void BenchFreeBusy::benchmarkFreeBusy_data()
+{
+    BenchmarkCalendar::addCounts();
+}
+
+void BenchFreeBusy::benchmarkFreeBusy()
+{
+    QFETCH(int, count);
+    const Event::List events = BenchmarkCalendar::calendar(count)->rawEvents();
+    const QDateTime start = BenchmarkCalendar::sStart.addMonths(6);
+
+    QBENCHMARK {
+        FreeBusy freeBusy(events, start, start.addMonths(1));
+    }
+}
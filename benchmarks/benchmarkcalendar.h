@@ -0,0 +1,80 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#ifndef BENCHMARKCALENDAR_H
+#define BENCHMARKCALENDAR_H
+
+#include "calendargenerator.h"
+#include "icalformat.h"
+
+#include <QHash>
+#include <QTest>
+#include <QTimeZone>
+
+namespace BenchmarkCalendar
+{
+
+// Start of the two years the generated incidences are spread over
+static const QDateTime sStart(QDate(2018, 1, 1), QTime(0, 0), Qt::UTC);
+
+// Returns a calendar of @p count incidences, which only depends on @p count
+inline KCalCore::MemoryCalendar::Ptr generate(int count)
+{
+    KCalCore::CalendarGenerator::Settings settings;
+    settings.seed = count;
+    settings.count = count;
+    settings.start = sStart.date();
+    settings.days = 730;
+    return KCalCore::CalendarGenerator(settings).generate();
+}
+
+// Returns the calendar of @p count incidences, generated once
+inline KCalCore::MemoryCalendar::Ptr calendar(int count)
+{
+    static QHash<int, KCalCore::MemoryCalendar::Ptr> calendars;
+    auto it = calendars.find(count);
+    if (it == calendars.end()) {
+        it = calendars.insert(count, generate(count));
+    }
+    return it.value();
+}
+
+// Returns the iCalendar data of calendar(@p count)
+inline QString iCalendar(int count)
+{
+    static QHash<int, QString> strings;
+    auto it = strings.find(count);
+    if (it == strings.end()) {
+        it = strings.insert(count, KCalCore::ICalFormat().toString(calendar(count)));
+    }
+    return it.value();
+}
+
+// Adds a "count" column with rows for the calendar sizes that are measured
+inline void addCounts()
+{
+    QTest::addColumn<int>("count");
+    for (int count : {1000, 10000, 100000}) {
+        QTest::newRow(QByteArray::number(count).constData()) << count;
+    }
+}
+
+}
+
+#endif
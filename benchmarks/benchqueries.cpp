@@ -0,0 +1,216 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "benchqueries.h"
+#include "benchmarkcalendar.h"
+#include "calfilter.h"
+
+#include <QTest>
+
+QTEST_MAIN(BenchQueries)
+
+using namespace KCalCore;
+
+void BenchQueries::benchmarkRawEvents_data()
+{
+    BenchmarkCalendar::addCounts();
+}
+
+void BenchQueries::benchmarkRawEvents()
+{
+    QFETCH(int, count);
+    const MemoryCalendar::Ptr calendar = BenchmarkCalendar::calendar(count);
+
+    QBENCHMARK {
+        calendar->rawEvents();
+    }
+}
+
+void BenchQueries::benchmarkRawEventsInRange_data()
+{
+    BenchmarkCalendar::addCounts();
+}
+
+void BenchQueries::benchmarkRawEventsInRange()
+{
+    QFETCH(int, count);
+    const MemoryCalendar::Ptr calendar = BenchmarkCalendar::calendar(count);
+    const QDate start = BenchmarkCalendar::sStart.date().addMonths(6);
+
+    QBENCHMARK {
+        calendar->rawEvents(start, start.addMonths(1));
+    }
+}
+
+void BenchQueries::benchmarkRawEventsForDate_data()
+{
+    BenchmarkCalendar::addCounts();
+}
+
+void BenchQueries::benchmarkRawEventsForDate()
+{
+    QFETCH(int, count);
+    const MemoryCalendar::Ptr calendar = BenchmarkCalendar::calendar(count);
+    const QDate start = BenchmarkCalendar::sStart.date();
+
+    // One query per day of a week
+    QBENCHMARK {
+        for (int day = 0; day < 7; ++day) {
+            calendar->rawEventsForDate(start.addDays(day));
+        }
+    }
+}
+
+// The recurring events of @p events on @p date, checked like
+// rawEventsForDate() did before it looked up whole windows of days
+static Event::List recurringEventsPerDay(const Event::List &events, const QDate &date,
+                                         const QTimeZone &timeZone)
+{
+    Event::List result;
+    for (const Event::Ptr &event : events) {
+        if (!event->recurs()) {
+            continue;
+        }
+        if (event->isMultiDay()) {
+            const int extraDays = int(event->dtStart().date().daysTo(event->dtEnd().date()));
+            if (event->recurrence()->recursOnDates(date.addDays(-extraDays), date, timeZone).count(true) > 0) {
+                result.append(event);
+            }
+        } else if (event->recursOn(date, timeZone)) {
+            result.append(event);
+        }
+    }
+    return result;
+}
+
+void BenchQueries::benchmarkMonthView_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("perDay");
+
+    for (int count : {1000, 10000}) {
+        QTest::newRow(QStringLiteral("%1 recursOn per day").arg(count).toLatin1().constData())
+                << count << true;
+        QTest::newRow(QStringLiteral("%1 rawEventsForDate").arg(count).toLatin1().constData())
+                << count << false;
+    }
+}
+
+void BenchQueries::benchmarkMonthView()
+{
+    QFETCH(int, count);
+    QFETCH(bool, perDay);
+    const MemoryCalendar::Ptr calendar = BenchmarkCalendar::calendar(count);
+    const Event::List events = calendar->rawEvents();
+    const QTimeZone timeZone = calendar->timeZone();
+    const QDate start = BenchmarkCalendar::sStart.date();
+
+    // Both ways find the same recurring events
+    for (int day = 0; day < 42; ++day) {
+        const QDate date = start.addDays(day);
+        const Event::List found = calendar->rawEventsForDate(date);
+        Event::List recurring;
+        for (const Event::Ptr &event : found) {
+            if (event->recurs()) {
+                recurring.append(event);
+            }
+        }
+        QCOMPARE(recurring.count(), recurringEventsPerDay(events, date, timeZone).count());
+    }
+
+    // The six weeks of a month view, for a different month each time, so the
+    // cached days of the last window only help with the overlap
+    int month = 0;
+    QBENCHMARK {
+        const QDate first = start.addMonths(month++ % 24);
+        for (int day = 0; day < 42; ++day) {
+            if (perDay) {
+                recurringEventsPerDay(events, first.addDays(day), timeZone);
+            } else {
+                calendar->rawEventsForDate(first.addDays(day));
+            }
+        }
+    }
+}
+
+void BenchQueries::benchmarkRawTodos_data()
+{
+    BenchmarkCalendar::addCounts();
+}
+
+void BenchQueries::benchmarkRawTodos()
+{
+    QFETCH(int, count);
+    const MemoryCalendar::Ptr calendar = BenchmarkCalendar::calendar(count);
+    const QDate start = BenchmarkCalendar::sStart.date().addMonths(6);
+
+    QBENCHMARK {
+        calendar->rawTodos(start, start.addMonths(1));
+    }
+}
+
+void BenchQueries::benchmarkAlarms_data()
+{
+    BenchmarkCalendar::addCounts();
+}
+
+void BenchQueries::benchmarkAlarms()
+{
+    QFETCH(int, count);
+    const MemoryCalendar::Ptr calendar = BenchmarkCalendar::calendar(count);
+    const QDateTime from = BenchmarkCalendar::sStart.addMonths(6);
+
+    QBENCHMARK {
+        calendar->alarms(from, from.addDays(1));
+    }
+}
+
+void BenchQueries::benchmarkFilter_data()
+{
+    BenchmarkCalendar::addCounts();
+}
+
+void BenchQueries::benchmarkFilter()
+{
+    QFETCH(int, count);
+    const Event::List events = BenchmarkCalendar::calendar(count)->rawEvents();
+    CalFilter filter;
+    filter.setCriteria(CalFilter::HideRecurring | CalFilter::ShowCategories);
+    filter.setCategoryList(QStringList() << QStringLiteral("Work") << QStringLiteral("Meeting"));
+
+    QBENCHMARK {
+        Event::List filtered = events;
+        filter.apply(&filtered);
+    }
+}
+
+void BenchQueries::benchmarkSort_data()
+{
+    BenchmarkCalendar::addCounts();
+}
+
+void BenchQueries::benchmarkSort()
+{
+    QFETCH(int, count);
+    const Event::List events = BenchmarkCalendar::calendar(count)->rawEvents();
+
+    QBENCHMARK {
+        Calendar::sortEvents(events, EventSortStartDate, SortDirectionAscending);
+    }
+}
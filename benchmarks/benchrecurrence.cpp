@@ -0,0 +1,169 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "benchrecurrence.h"
+#include "benchmarkcalendar.h"
+#include "occurrenceiterator.h"
+#include "recurrence.h"
+#include "recurrencerule.h"
+
+#include <QTest>
+
+QTEST_MAIN(BenchRecurrence)
+
+using namespace KCalCore;
+
+Q_DECLARE_METATYPE(KCalCore::OccurrenceIterator::Expansion)
+
+void BenchRecurrence::benchmarkOccurrenceIterator_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<OccurrenceIterator::Expansion>("expansion");
+
+    for (int count : {1000, 10000, 100000}) {
+        QTest::newRow(QStringLiteral("%1 serial").arg(count).toLatin1().constData())
+                << count << OccurrenceIterator::SerialExpansion;
+        QTest::newRow(QStringLiteral("%1 parallel").arg(count).toLatin1().constData())
+                << count << OccurrenceIterator::ParallelExpansion;
+    }
+}
+
+void BenchRecurrence::benchmarkOccurrenceIterator()
+{
+    QFETCH(int, count);
+    QFETCH(OccurrenceIterator::Expansion, expansion);
+    const MemoryCalendar::Ptr calendar = BenchmarkCalendar::calendar(count);
+    const QDateTime start = BenchmarkCalendar::sStart.addMonths(6);
+
+    QBENCHMARK {
+        OccurrenceIterator it(*calendar, start, start.addMonths(1), expansion);
+        while (it.hasNext()) {
+            it.next();
+        }
+    }
+}
+
+void BenchRecurrence::benchmarkTimesInInterval_data()
+{
+    QTest::addColumn<QString>("rule");
+
+    QTest::newRow("daily") << QStringLiteral("FREQ=DAILY");
+    QTest::newRow("weekly byday") << QStringLiteral("FREQ=WEEKLY;BYDAY=MO,WE,FR");
+    QTest::newRow("monthly bysetpos") << QStringLiteral("FREQ=MONTHLY;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-1");
+    QTest::newRow("yearly bymonthday") << QStringLiteral("FREQ=YEARLY;BYMONTH=2;BYMONTHDAY=29");
+    QTest::newRow("hourly until") << QStringLiteral("FREQ=HOURLY;INTERVAL=3;UNTIL=20200101T000000Z");
+}
+
+void BenchRecurrence::benchmarkTimesInInterval()
+{
+    QFETCH(QString, rule);
+    RecurrenceRule recurrenceRule;
+    QVERIFY(ICalFormat().fromString(&recurrenceRule, rule));
+    recurrenceRule.setStartDt(BenchmarkCalendar::sStart);
+    const QDateTime start = BenchmarkCalendar::sStart.addYears(1);
+
+    QBENCHMARK {
+        recurrenceRule.timesInInterval(start, start.addYears(1));
+    }
+}
+
+void BenchRecurrence::benchmarkTimesInIntervalExclusions_data()
+{
+    QTest::addColumn<int>("exclusions");
+    QTest::addColumn<bool>("exrule");
+
+    for (int exclusions : {0, 1000, 5000}) {
+        QTest::newRow(QStringLiteral("%1 exdatetimes").arg(exclusions).toLatin1().constData())
+                << exclusions << false;
+        QTest::newRow(QStringLiteral("%1 exdatetimes exrule").arg(exclusions).toLatin1().constData())
+                << exclusions << true;
+    }
+}
+
+void BenchRecurrence::benchmarkTimesInIntervalExclusions()
+{
+    QFETCH(int, exclusions);
+    QFETCH(bool, exrule);
+    // Five days of a minutely recurrence, i.e. 7200 occurrences
+    const int minutes = 5 * 24 * 60;
+    const QDateTime start = BenchmarkCalendar::sStart;
+    Recurrence recurrence;
+    recurrence.setStartDateTime(start, false);
+    recurrence.setMinutely(1);
+
+    SortableList<QDateTime> exDateTimes;
+    for (int i = 0; i < exclusions; ++i) {
+        exDateTimes << start.addSecs(60 * (qint64(i) * minutes / exclusions));
+    }
+    recurrence.setExDateTimes(exDateTimes);
+    if (exrule) {
+        RecurrenceRule *rule = new RecurrenceRule();
+        rule->setRecurrenceType(RecurrenceRule::rMinutely);
+        rule->setFrequency(7);
+        rule->setStartDt(start);
+        recurrence.addExRule(rule);
+    }
+
+    QBENCHMARK {
+        recurrence.timesInInterval(start, start.addSecs(60 * (minutes - 1)));
+    }
+}
+
+void BenchRecurrence::benchmarkNextOccurrences_data()
+{
+    QTest::addColumn<QString>("rule");
+    QTest::addColumn<bool>("cursor");
+
+    for (const QString &rule : {QStringLiteral("FREQ=WEEKLY;BYDAY=MO,WE,FR"),
+                                QStringLiteral("FREQ=MONTHLY;BYDAY=MO,TU,WE,TH,FR;BYSETPOS=-1")}) {
+        QTest::newRow(QStringLiteral("%1 getNextDateTime").arg(rule).toLatin1().constData())
+                << rule << false;
+        QTest::newRow(QStringLiteral("%1 cursor").arg(rule).toLatin1().constData())
+                << rule << true;
+    }
+}
+
+void BenchRecurrence::benchmarkNextOccurrences()
+{
+    QFETCH(QString, rule);
+    QFETCH(bool, cursor);
+    const QDateTime start = BenchmarkCalendar::sStart;
+    Recurrence recurrence;
+    recurrence.setStartDateTime(start, false);
+    RecurrenceRule *recurrenceRule = new RecurrenceRule();
+    QVERIFY(ICalFormat().fromString(recurrenceRule, rule));
+    recurrenceRule->setStartDt(start);
+    recurrence.addRRule(recurrenceRule);
+    const QDateTime from = start.addYears(1);
+
+    // The next 200 occurrences
+    QBENCHMARK {
+        if (cursor) {
+            Recurrence::Cursor it(&recurrence, from);
+            for (int i = 0; i < 200; ++i) {
+                it.next();
+            }
+        } else {
+            QDateTime dt = from;
+            for (int i = 0; i < 200; ++i) {
+                dt = recurrence.getNextDateTime(dt);
+            }
+        }
+    }
+}
@@ -0,0 +1,120 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "calendargenerator.h"
+#include "icalformat.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+using namespace KCalCore;
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("generatecalendar"));
+    QCoreApplication::setApplicationVersion(QStringLiteral("0.1"));
+
+    CalendarGenerator::Settings settings;
+    auto intOption = [](const QString &name, const QString &description, int defaultValue) {
+        return QCommandLineOption(name, description, QStringLiteral("n"), QString::number(defaultValue));
+    };
+    const QCommandLineOption seed = intOption(QStringLiteral("seed"), QStringLiteral("Seed of the random numbers"), settings.seed);
+    const QCommandLineOption count = intOption(QStringLiteral("count"), QStringLiteral("Number of incidences, not counting exceptions"), settings.count);
+    const QCommandLineOption start(QStringLiteral("start"), QStringLiteral("First day of the incidences"), QStringLiteral("yyyy-MM-dd"),
+                                   settings.start.toString(Qt::ISODate));
+    const QCommandLineOption days = intOption(QStringLiteral("days"), QStringLiteral("Number of days the incidences start in"), settings.days);
+    const QCommandLineOption events = intOption(QStringLiteral("events"), QStringLiteral("Relative frequency of events"), settings.eventWeight);
+    const QCommandLineOption todos = intOption(QStringLiteral("todos"), QStringLiteral("Relative frequency of to-dos"), settings.todoWeight);
+    const QCommandLineOption journals = intOption(QStringLiteral("journals"), QStringLiteral("Relative frequency of journals"), settings.journalWeight);
+    const QCommandLineOption recurring = intOption(QStringLiteral("recurring"), QStringLiteral("Percentage of recurring events and to-dos"), settings.recurringPercent);
+    const QCommandLineOption rules(QStringLiteral("rules"),
+                                   QStringLiteral("Relative frequencies of daily, weekly, weekly by day, monthly, monthly by position and yearly rules"),
+                                   QStringLiteral("n,n,n,n,n,n"));
+    const QCommandLineOption exceptions = intOption(QStringLiteral("exceptions"), QStringLiteral("Percentage of recurring events with exceptions"), settings.exceptionPercent);
+    const QCommandLineOption maxExceptions = intOption(QStringLiteral("max-exceptions"), QStringLiteral("Maximum number of exceptions per event"), settings.maxExceptions);
+    const QCommandLineOption attendees = intOption(QStringLiteral("attendees"), QStringLiteral("Percentage of incidences with attendees"), settings.attendeePercent);
+    const QCommandLineOption maxAttendees = intOption(QStringLiteral("max-attendees"), QStringLiteral("Maximum number of attendees per incidence"), settings.maxAttendees);
+    const QCommandLineOption alarms = intOption(QStringLiteral("alarms"), QStringLiteral("Percentage of events and to-dos with an alarm"), settings.alarmPercent);
+    const QCommandLineOption categories(QStringLiteral("categories"), QStringLiteral("Comma separated categories"), QStringLiteral("list"),
+                                        settings.categories.join(QLatin1Char(',')));
+    const QCommandLineOption timeZones(QStringLiteral("timezones"), QStringLiteral("Comma separated IANA time zones"), QStringLiteral("list"),
+                                       QString::fromLatin1(settings.timeZones.join(',')));
+    const QCommandLineOption subTodos = intOption(QStringLiteral("sub-todos"), QStringLiteral("Percentage of to-dos which are sub-to-dos"), settings.subTodoPercent);
+    const QCommandLineOption descriptionLength = intOption(QStringLiteral("description-length"), QStringLiteral("Average length of descriptions"), settings.descriptionLength);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Generates a calendar for benchmarks and stress tests"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOptions({seed, count, start, days, events, todos, journals, recurring, rules,
+                       exceptions, maxExceptions, attendees, maxAttendees, alarms,
+                       categories, timeZones, subTodos, descriptionLength});
+    parser.addPositionalArgument(QStringLiteral("output"), QStringLiteral("Name of the .ics file to write, standard output if omitted"));
+    parser.process(app);
+
+    settings.seed = parser.value(seed).toUInt();
+    settings.count = parser.value(count).toInt();
+    settings.start = QDate::fromString(parser.value(start), Qt::ISODate);
+    settings.days = parser.value(days).toInt();
+    settings.eventWeight = parser.value(events).toInt();
+    settings.todoWeight = parser.value(todos).toInt();
+    settings.journalWeight = parser.value(journals).toInt();
+    settings.recurringPercent = parser.value(recurring).toInt();
+    if (parser.isSet(rules)) {
+        const QStringList weights = parser.value(rules).split(QLatin1Char(','));
+        if (weights.size() != CalendarGenerator::RuleCount) {
+            qCritical("--rules takes %d comma separated numbers", int(CalendarGenerator::RuleCount));
+            return 1;
+        }
+        for (int i = 0; i < CalendarGenerator::RuleCount; ++i) {
+            settings.ruleWeights[i] = weights.at(i).toInt();
+        }
+    }
+    settings.exceptionPercent = parser.value(exceptions).toInt();
+    settings.maxExceptions = parser.value(maxExceptions).toInt();
+    settings.attendeePercent = parser.value(attendees).toInt();
+    settings.maxAttendees = parser.value(maxAttendees).toInt();
+    settings.alarmPercent = parser.value(alarms).toInt();
+    settings.categories = parser.value(categories).split(QLatin1Char(','), QString::SkipEmptyParts);
+    settings.timeZones.clear();
+    const QStringList zones = parser.value(timeZones).split(QLatin1Char(','), QString::SkipEmptyParts);
+    for (const QString &zone : zones) {
+        settings.timeZones.append(zone.toLatin1());
+    }
+    settings.subTodoPercent = parser.value(subTodos).toInt();
+    settings.descriptionLength = parser.value(descriptionLength).toInt();
+
+    if (!settings.start.isValid()) {
+        qCritical("Invalid --start date");
+        return 1;
+    }
+
+    const MemoryCalendar::Ptr calendar = CalendarGenerator(settings).generate();
+    ICalFormat format;
+    const QStringList parsedArgs = parser.positionalArguments();
+    if (parsedArgs.isEmpty()) {
+        QTextStream out(stdout);
+        out.setCodec("UTF-8");
+        out << format.toString(calendar);
+        return 0;
+    }
+    return format.save(calendar, parsedArgs.first()) ? 0 : 1;
+}
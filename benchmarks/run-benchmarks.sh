@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# Runs the benchmarks built with -DBUILD_BENCHMARKS=ON and writes their
+# results as CSV, one line per benchmark function and data row:
+#
+#   benchmark,function,tag,metric,value,total,iterations
+#
+# where value is the metric per iteration.
+#
+# Usage: run-benchmarks.sh BUILD_DIR [OUTPUT] [-- QTEST_ARGUMENTS...]
+#
+# OUTPUT defaults to standard output. QTEST_ARGUMENTS are passed to every
+# benchmark, e.g. "-- -callgrind" or "-- -minimumvalue 100".
+
+set -e
+
+if [ $# -lt 1 ]; then
+    echo "Usage: $0 BUILD_DIR [OUTPUT] [-- QTEST_ARGUMENTS...]" >&2
+    exit 1
+fi
+
+build_dir=$1
+shift
+output=-
+if [ $# -gt 0 ] && [ "$1" != "--" ]; then
+    output=$1
+    shift
+fi
+if [ "$1" = "--" ]; then
+    shift
+fi
+
+benchmarks="benchformat benchfreebusy benchqueries benchrecurrence"
+results=$(mktemp)
+trap 'rm -f "$results" "$results.all"' EXIT
+
+{
+    echo "benchmark,function,tag,metric,value,total,iterations"
+    for benchmark in $benchmarks; do
+        executable=$(find "$build_dir" -type f -name "$benchmark" -perm -u+x | head -n 1)
+        if [ -z "$executable" ]; then
+            echo "$benchmark not found in $build_dir, was it built with -DBUILD_BENCHMARKS=ON?" >&2
+            exit 1
+        fi
+        "$executable" -o "$results,csv" "$@" >&2
+        sed -e "s/^/\"$benchmark\",/" "$results"
+    done
+} > "$results.all"
+
+if [ "$output" = "-" ]; then
+    cat "$results.all"
+else
+    mv "$results.all" "$output"
+fi
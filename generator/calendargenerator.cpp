@@ -0,0 +1,289 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "calendargenerator.h"
+#include "event.h"
+#include "journal.h"
+#include "todo.h"
+
+#include <QBitArray>
+#include <QTimeZone>
+
+using namespace KCalCore;
+
+namespace
+{
+
+const char *const sWords[] = {
+    "meeting", "project", "review", "call", "lunch", "team", "planning", "release",
+    "budget", "customer", "travel", "dentist", "weekly", "sync", "report", "deadline",
+    "école", "Besprechung", "会議", "встреча"
+};
+
+}
+
+CalendarGenerator::CalendarGenerator(const Settings &settings)
+    : mSettings(settings),
+      mRandom(settings.seed)
+{
+}
+
+int CalendarGenerator::uniform(int max)
+{
+    return max > 0 ? int(mRandom() % quint32(max)) : 0;
+}
+
+bool CalendarGenerator::percent(int percentage)
+{
+    return uniform(100) < percentage;
+}
+
+int CalendarGenerator::weighted(const int *weights, int count)
+{
+    int total = 0;
+    for (int i = 0; i < count; ++i) {
+        total += weights[i];
+    }
+    int value = uniform(total);
+    for (int i = 0; i < count; ++i) {
+        if (value < weights[i]) {
+            return i;
+        }
+        value -= weights[i];
+    }
+    return count - 1;
+}
+
+QString CalendarGenerator::text(int length)
+{
+    const int wordCount = sizeof(sWords) / sizeof(sWords[0]);
+    QString result;
+    result.reserve(length + 16);
+    while (result.size() < length) {
+        if (!result.isEmpty()) {
+            result += uniform(12) == 0 ? QLatin1Char('\n') : QLatin1Char(' ');
+        }
+        result += QString::fromUtf8(sWords[uniform(wordCount)]);
+    }
+    return result;
+}
+
+void CalendarGenerator::setRecurrence(const Incidence::Ptr &incidence)
+{
+    Recurrence *recurrence = incidence->recurrence();
+    const QDate start = incidence->dtStart().date();
+    switch (weighted(mSettings.ruleWeights, RuleCount)) {
+    case DailyRule:
+        recurrence->setDaily(1 + uniform(2));
+        recurrence->setDuration(5 + uniform(30));
+        break;
+    case WeeklyRule:
+        recurrence->setWeekly(1 + uniform(2));
+        break;
+    case WeeklyByDayRule: {
+        QBitArray days(7);
+        days.setBit(start.dayOfWeek() - 1);
+        days.setBit(uniform(5));
+        recurrence->setWeekly(1, days);
+        break;
+    }
+    case MonthlyRule:
+        recurrence->setMonthly(1);
+        recurrence->addMonthlyDate(start.day());
+        recurrence->setEndDate(start.addYears(1 + uniform(3)));
+        break;
+    case MonthlyBySetPosRule: {
+        QBitArray days(7);
+        days.fill(true, 0, 5);
+        recurrence->setMonthly(1);
+        recurrence->addMonthlyPos(-1, days);
+        break;
+    }
+    default:
+        recurrence->setYearly(1);
+        recurrence->addYearlyMonth(start.month());
+        break;
+    }
+
+    if (percent(mSettings.exDatePercent)) {
+        QDateTime occurrence = incidence->dtStart();
+        for (int i = 1 + uniform(mSettings.maxExDates); i > 0; --i) {
+            occurrence = recurrence->getNextDateTime(occurrence);
+            if (!occurrence.isValid()) {
+                break;
+            }
+            if (uniform(2) == 0) {
+                recurrence->addExDateTime(occurrence);
+            }
+        }
+    }
+}
+
+void CalendarGenerator::addExceptions(const Incidence::Ptr &incidence, Incidence::List &incidences)
+{
+    // Moved or renamed occurrences, spread over the first occurrences
+    QDateTime occurrence = incidence->dtStart().addSecs(-1);
+    for (int i = 1 + uniform(mSettings.maxExceptions); i > 0; --i) {
+        occurrence = incidence->recurrence()->getNextDateTime(occurrence);
+        if (!occurrence.isValid()) {
+            break;
+        }
+        if (uniform(3) != 0) {
+            continue;
+        }
+        Incidence::Ptr exception = Calendar::createException(incidence, occurrence);
+        if (uniform(2) == 0) {
+            exception->setDtStart(occurrence.addSecs(3600 * (1 + uniform(3))));
+        } else {
+            exception->setSummary(incidence->summary() + QLatin1String(" (") + text(10) + QLatin1Char(')'));
+        }
+        incidences.append(exception);
+    }
+}
+
+MemoryCalendar::Ptr CalendarGenerator::generate()
+{
+    MemoryCalendar::Ptr calendar(new MemoryCalendar(QTimeZone::utc()));
+    populate(calendar);
+    return calendar;
+}
+
+void CalendarGenerator::populate(const Calendar::Ptr &calendar)
+{
+    const int typeWeights[] = {mSettings.eventWeight, mSettings.todoWeight, mSettings.journalWeight};
+    QVector<QTimeZone> timeZones;
+    for (const QByteArray &id : qAsConst(mSettings.timeZones)) {
+        timeZones.append(QTimeZone(id));
+    }
+    if (timeZones.isEmpty()) {
+        timeZones.append(QTimeZone::utc());
+    }
+
+    Incidence::List incidences;
+    incidences.reserve(mSettings.count);
+    // The most recent to-dos with their depth, the parents of sub-to-dos
+    QVector<QPair<QString, int>> recentTodos;
+
+    for (int i = 0; i < mSettings.count; ++i) {
+        const QTimeZone timeZone = timeZones.at(uniform(timeZones.size()));
+        const QDateTime start(mSettings.start.addDays(uniform(mSettings.days)),
+                              QTime(7 + uniform(12), 15 * uniform(4)), timeZone);
+        const bool allDay = percent(mSettings.allDayPercent);
+
+        Incidence::Ptr incidence;
+        switch (weighted(typeWeights, 3)) {
+        case 0: {
+            Event::Ptr event(new Event);
+            event->setDtStart(start);
+            if (allDay) {
+                event->setAllDay(true);
+                event->setDtEnd(start.addDays(uniform(3)));
+            } else {
+                event->setDtEnd(start.addSecs(1800 * (1 + uniform(6))));
+            }
+            incidence = event;
+            break;
+        }
+        case 1: {
+            Todo::Ptr todo(new Todo);
+            todo->setDtStart(start);
+            todo->setDtDue(start.addDays(1 + uniform(14)));
+            todo->setAllDay(allDay);
+            todo->setPriority(uniform(10));
+            if (percent(30)) {
+                todo->setCompleted(start.addDays(1));
+            } else {
+                todo->setPercentComplete(10 * uniform(10));
+            }
+            incidence = todo;
+            break;
+        }
+        default:
+            incidence = Journal::Ptr(new Journal);
+            incidence->setDtStart(start);
+            break;
+        }
+
+        incidence->setUid(QStringLiteral("generated-%1-%2").arg(mSettings.seed).arg(i));
+        incidence->setSummary(text(10 + uniform(30)));
+        if (percent(mSettings.bigDescriptionPercent)) {
+            incidence->setDescription(text(mSettings.bigDescriptionLength));
+        } else if (mSettings.descriptionLength > 0) {
+            incidence->setDescription(text(uniform(2 * mSettings.descriptionLength)));
+        }
+
+        QStringList categories;
+        for (int j = uniform(mSettings.maxCategories + 1); j > 0 && !mSettings.categories.isEmpty(); --j) {
+            const QString category = mSettings.categories.at(uniform(mSettings.categories.size()));
+            if (!categories.contains(category)) {
+                categories.append(category);
+            }
+        }
+        incidence->setCategories(categories);
+
+        if (percent(mSettings.attendeePercent)) {
+            const int organizer = uniform(mSettings.people);
+            incidence->setOrganizer(Person::Ptr(new Person(QStringLiteral("Person %1").arg(organizer),
+                                                           QStringLiteral("person%1@example.com").arg(organizer))));
+            for (int j = 1 + uniform(mSettings.maxAttendees); j > 0; --j) {
+                const int person = uniform(mSettings.people);
+                incidence->addAttendee(Attendee::Ptr(new Attendee(QStringLiteral("Person %1").arg(person),
+                                                                  QStringLiteral("person%1@example.com").arg(person),
+                                                                  uniform(2) == 0,
+                                                                  Attendee::PartStat(uniform(4)),
+                                                                  Attendee::Role(uniform(3)))));
+            }
+        }
+
+        if (incidence->type() != IncidenceBase::TypeJournal) {
+            if (percent(mSettings.alarmPercent)) {
+                Alarm::Ptr alarm = incidence->newAlarm();
+                alarm->setDisplayAlarm(incidence->summary());
+                alarm->setStartOffset(Duration(-300 * (1 + uniform(12))));
+                alarm->setEnabled(true);
+            }
+            if (percent(mSettings.recurringPercent)) {
+                setRecurrence(incidence);
+            }
+        }
+
+        if (incidence->type() == IncidenceBase::TypeTodo) {
+            int depth = 0;
+            if (!recentTodos.isEmpty() && percent(mSettings.subTodoPercent)) {
+                const QPair<QString, int> &parent = recentTodos.at(uniform(recentTodos.size()));
+                if (parent.second + 1 < mSettings.maxTodoDepth) {
+                    incidence->setRelatedTo(parent.first);
+                    depth = parent.second + 1;
+                }
+            }
+            if (recentTodos.size() == 8) {
+                recentTodos.removeFirst();
+            }
+            recentTodos.append(qMakePair(incidence->uid(), depth));
+        }
+
+        incidences.append(incidence);
+        if (incidence->type() == IncidenceBase::TypeEvent && incidence->recurs()
+            && percent(mSettings.exceptionPercent)) {
+            addExceptions(incidence, incidences);
+        }
+    }
+
+    calendar->addIncidences(incidences);
+}
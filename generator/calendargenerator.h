@@ -0,0 +1,150 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#ifndef CALENDARGENERATOR_H
+#define CALENDARGENERATOR_H
+
+#include "memorycalendar.h"
+
+#include <QByteArrayList>
+
+#include <random>
+
+namespace KCalCore
+{
+
+/**
+  Generates calendars with the shapes found in production calendars, for
+  the autotests, the benchmarks and the generatecalendar tool.
+
+  This is not part of the library, but an internal static library built
+  with BUILD_TESTING or BUILD_BENCHMARKS.
+
+  The generated calendar only depends on the Settings, in particular on
+  Settings::seed: the same settings give the same calendar on every
+  platform.
+
+  Percentages are of the incidences the property applies to, e.g.
+  Settings::exceptionPercent is the percentage of recurring events with
+  RECURRENCE-ID exceptions.
+*/
+class CalendarGenerator
+{
+public:
+    /**
+      Kinds of recurrence rules, used as indexes of Settings::ruleWeights.
+    */
+    enum Rule {
+        DailyRule,          /**< FREQ=DAILY;COUNT=n */
+        WeeklyRule,         /**< FREQ=WEEKLY, without end */
+        WeeklyByDayRule,    /**< FREQ=WEEKLY;BYDAY=..., without end */
+        MonthlyRule,        /**< FREQ=MONTHLY;BYMONTHDAY=n;UNTIL=... */
+        MonthlyBySetPosRule,/**< FREQ=MONTHLY;BYDAY=MO,...,FR;BYSETPOS=-1 */
+        YearlyRule,         /**< FREQ=YEARLY;BYMONTH=n, without end */
+        RuleCount
+    };
+
+    struct Settings {
+        /** Seed of the random numbers */
+        quint32 seed = 1;
+        /** Number of incidences, not counting the exceptions */
+        int count = 1000;
+        /** The incidences start in the @p days days from @p start */
+        QDate start = QDate(2018, 1, 1);
+        int days = 730;
+
+        /** Relative frequency of events, to-dos and journals */
+        int eventWeight = 80;
+        int todoWeight = 15;
+        int journalWeight = 5;
+
+        /** Percentage of all-day events and to-dos */
+        int allDayPercent = 10;
+        /** Percentage of recurring events and to-dos */
+        int recurringPercent = 25;
+        /** Relative frequency of each Rule, indexed by Rule */
+        int ruleWeights[RuleCount] = {2, 4, 2, 1, 1, 1};
+        /** Percentage of recurring events with up to @p maxExceptions exceptions */
+        int exceptionPercent = 10;
+        int maxExceptions = 200;
+        /** Percentage of recurring incidences with up to @p maxExDates EXDATEs */
+        int exDatePercent = 20;
+        int maxExDates = 10;
+
+        /** Percentage of incidences with up to @p maxAttendees attendees,
+            taken from a pool of @p people people */
+        int attendeePercent = 40;
+        int maxAttendees = 20;
+        int people = 500;
+        /** Percentage of events and to-dos with an alarm */
+        int alarmPercent = 30;
+        /** Each incidence has up to @p maxCategories of @p categories */
+        QStringList categories = {
+            QStringLiteral("Work"), QStringLiteral("Private"), QStringLiteral("Travel"),
+            QStringLiteral("Birthday"), QStringLiteral("Holiday"), QStringLiteral("Meeting")
+        };
+        int maxCategories = 2;
+        /** Time zones of the incidences, chosen with equal frequency */
+        QByteArrayList timeZones = {
+            QByteArrayLiteral("UTC"), QByteArrayLiteral("Europe/Berlin"),
+            QByteArrayLiteral("America/New_York"), QByteArrayLiteral("Asia/Tokyo")
+        };
+
+        /** Percentage of to-dos which are sub-to-dos of a recent to-do,
+            building hierarchies of up to @p maxTodoDepth levels */
+        int subTodoPercent = 30;
+        int maxTodoDepth = 8;
+
+        /** Average length of a description, and percentage of incidences
+            with a description of @p bigDescriptionLength characters */
+        int descriptionLength = 200;
+        int bigDescriptionPercent = 1;
+        int bigDescriptionLength = 64 * 1024;
+    };
+
+    explicit CalendarGenerator(const Settings &settings = Settings());
+
+    /**
+      Returns a new calendar in UTC holding the generated incidences.
+    */
+    MemoryCalendar::Ptr generate();
+
+    /**
+      Adds the generated incidences to @p calendar.
+    */
+    void populate(const Calendar::Ptr &calendar);
+
+private:
+    int uniform(int max);
+    bool percent(int percentage);
+    int weighted(const int *weights, int count);
+    QString text(int length);
+
+    void setRecurrence(const Incidence::Ptr &incidence);
+    void addExceptions(const Incidence::Ptr &incidence, Incidence::List &incidences);
+
+    Settings mSettings;
+    // Raw engine output is used instead of <random> distributions, whose
+    // results differ between standard libraries
+    std::mt19937 mRandom;
+};
+
+}
+
+#endif
@@ -31,8 +31,10 @@
   @author Cornelius Schumacher \<schumacher@kde.org\>
 */
 #include "alarm.h"
+#include "arena_p.h"
 #include "duration.h"
 #include "incidence.h"
+#include "memoryaccounting_p.h"
 #include "utils.h"
 
 #include <QTime>
@@ -45,7 +47,7 @@ using namespace KCalCore;
   @internal
 */
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::Alarm::Private
+class Q_DECL_HIDDEN KCalCore::Alarm::Private : public ArenaAllocated
 {
 public:
     Private()
@@ -864,3 +866,23 @@ void Alarm::virtual_hook(int id, void *data)
     Q_UNUSED(data);
     Q_ASSERT(false);
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addAlarm(const Alarm::Ptr &alarm)
+{
+    if (!firstTime(alarm.data())) {
+        return;
+    }
+    const Alarm::Private *d = alarm->d;
+    add(MemoryUsage::Alarms, sizeof(Alarm) + 2 * sizeof(void *) + sizeof(Alarm::Private));
+    addCustomProperties(*alarm, MemoryUsage::Alarms);
+    addString(d->mDescription, MemoryUsage::Alarms);
+    addString(d->mFile, MemoryUsage::Alarms);
+    addString(d->mMailSubject, MemoryUsage::Alarms);
+    addStringList(d->mMailAttachFiles, MemoryUsage::Alarms);
+    addVector(d->mMailAddresses, MemoryUsage::Alarms);
+    for (const Person::Ptr &person : qAsConst(d->mMailAddresses)) {
+        addPerson(person);
+    }
+}
+//@endcond
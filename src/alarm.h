@@ -668,6 +668,7 @@ protected:
 
 private:
     //@cond PRIVATE
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
@@ -0,0 +1,161 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+
+#include "arena_p.h"
+
+#include <QAtomicInt>
+
+#include <cstdlib>
+#include <new>
+
+using namespace KCalCore;
+
+//@cond PRIVATE
+// Each allocation is preceded by a header pointing to its chunk, or null
+// for allocations from the heap. Its size keeps the objects aligned as
+// needed by the private classes, which hold pointers, integers and doubles.
+union AllocationHeader {
+    void *chunk;
+    qint64 integer;
+    double floatingPoint;
+};
+
+static const std::size_t sAlignment = alignof(AllocationHeader);
+
+static std::size_t aligned(std::size_t size)
+{
+    return (size + sAlignment - 1) & ~(sAlignment - 1);
+}
+
+struct Arena::Chunk {
+    // One reference for each object, and one held by the arena while it
+    // allocates from the chunk
+    QAtomicInt refs;
+    char *pos;
+    char *end;
+};
+
+static thread_local Arena *sCurrentArena = nullptr;
+static QAtomicInt sLiveChunks;
+//@endcond
+
+Arena::Scope::Scope(Arena *arena)
+    : mPrevious(sCurrentArena)
+{
+    sCurrentArena = arena;
+}
+
+Arena::Scope::~Scope()
+{
+    sCurrentArena = mPrevious;
+}
+
+Arena::Arena(std::size_t chunkSize)
+    : mChunkSize(chunkSize)
+{
+}
+
+Arena::~Arena()
+{
+    if (mChunk) {
+        releaseChunk(mChunk);
+    }
+}
+
+Arena *Arena::current()
+{
+    return sCurrentArena;
+}
+
+void *Arena::allocate(std::size_t size)
+{
+    if (sCurrentArena) {
+        if (void *pointer = sCurrentArena->allocateFromChunk(size)) {
+            return pointer;
+        }
+    }
+
+    void *block = std::malloc(sizeof(AllocationHeader) + size);
+    if (!block) {
+        throw std::bad_alloc();
+    }
+    AllocationHeader *header = static_cast<AllocationHeader *>(block);
+    header->chunk = nullptr;
+    return header + 1;
+}
+
+void Arena::deallocate(void *pointer)
+{
+    if (!pointer) {
+        return;
+    }
+
+    AllocationHeader *header = static_cast<AllocationHeader *>(pointer) - 1;
+    if (header->chunk) {
+        releaseChunk(static_cast<Chunk *>(header->chunk));
+    } else {
+        std::free(header);
+    }
+}
+
+int Arena::liveChunks()
+{
+    return sLiveChunks.load();
+}
+
+void *Arena::allocateFromChunk(std::size_t size)
+{
+    const std::size_t needed = sizeof(AllocationHeader) + aligned(size);
+    // Large objects would waste much of a chunk
+    if (needed > mChunkSize / 8) {
+        return nullptr;
+    }
+
+    if (!mChunk || std::size_t(mChunk->end - mChunk->pos) < needed) {
+        if (mChunk) {
+            releaseChunk(mChunk);
+        }
+        const std::size_t header = aligned(sizeof(Chunk));
+        char *block = static_cast<char *>(std::malloc(header + mChunkSize));
+        if (!block) {
+            mChunk = nullptr;
+            return nullptr;
+        }
+        mChunk = new (block) Chunk;
+        mChunk->refs.store(1);
+        mChunk->pos = block + header;
+        mChunk->end = block + header + mChunkSize;
+        sLiveChunks.ref();
+    }
+
+    AllocationHeader *header = reinterpret_cast<AllocationHeader *>(mChunk->pos);
+    header->chunk = mChunk;
+    mChunk->pos += needed;
+    mChunk->refs.ref();
+    return header + 1;
+}
+
+void Arena::releaseChunk(Chunk *chunk)
+{
+    if (!chunk->refs.deref()) {
+        chunk->~Chunk();
+        std::free(chunk);
+        sLiveChunks.deref();
+    }
+}
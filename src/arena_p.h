@@ -0,0 +1,117 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+#ifndef KCALCORE_ARENA_P_H
+#define KCALCORE_ARENA_P_H
+
+#include "kcalcore_export.h"
+
+#include <QtGlobal>
+
+#include <cstddef>
+
+namespace KCalCore
+{
+
+//@cond PRIVATE
+/**
+  An arena to allocate many small objects from, e.g. while loading a
+  calendar.
+
+  Objects are carved out of large chunks, one after the other. Each chunk
+  counts the objects living in it and is freed with the last of them, so
+  objects may outlive the arena and may be deleted from any thread. The
+  memory of a deleted object is not reused before its whole chunk is freed.
+
+  Only classes deriving from ArenaAllocated are allocated from an arena,
+  and only while a Scope for it is active in the allocating thread.
+*/
+class KCALCORE_EXPORT Arena
+{
+public:
+    /**
+      Makes @p arena the arena of the current thread during its lifetime.
+      With a null @p arena, objects are allocated from the heap.
+    */
+    class KCALCORE_EXPORT Scope
+    {
+    public:
+        explicit Scope(Arena *arena);
+        ~Scope();
+
+    private:
+        Q_DISABLE_COPY(Scope)
+        Arena *mPrevious = nullptr;
+    };
+
+    explicit Arena(std::size_t chunkSize = 64 * 1024);
+    ~Arena();
+
+    /**
+      Returns the arena of the current thread, or nullptr.
+    */
+    static Arena *current();
+
+    /**
+      Allocates @p size bytes from the current arena if there is one, from
+      the heap otherwise.
+    */
+    static void *allocate(std::size_t size);
+
+    /**
+      Frees memory returned by allocate().
+    */
+    static void deallocate(void *pointer);
+
+    /**
+      Returns the number of chunks allocated by all arenas and not freed
+      yet.
+    */
+    static int liveChunks();
+
+private:
+    Q_DISABLE_COPY(Arena)
+    struct Chunk;
+    void *allocateFromChunk(std::size_t size);
+    static void releaseChunk(Chunk *chunk);
+
+    std::size_t mChunkSize;
+    Chunk *mChunk = nullptr;
+};
+
+/**
+  Base class for the private classes allocated from the current Arena.
+*/
+class ArenaAllocated
+{
+public:
+    static void *operator new(std::size_t size)
+    {
+        return Arena::allocate(size);
+    }
+
+    static void operator delete(void *pointer)
+    {
+        Arena::deallocate(pointer);
+    }
+};
+//@endcond
+
+}
+
+#endif
@@ -30,16 +30,36 @@
 */
 
 #include "attachment.h"
+#include "arena_p.h"
+#include "memoryaccounting_p.h"
+#include <QBuffer>
 #include <QDataStream>
 
 using namespace KCalCore;
 
+//@cond PRIVATE
+// Returns the size of the data decoded from @p base64 by
+// QByteArray::fromBase64(), which skips invalid characters, without
+// decoding it
+static uint decodedBase64Size(const QByteArray &base64)
+{
+    qint64 digits = 0;
+    for (const char c : base64) {
+        if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')
+                || c == '+' || c == '/') {
+            ++digits;
+        }
+    }
+    return uint(digits * 6 / 8);
+}
+//@endcond
+
 /**
   Private class that helps to provide binary compatibility between releases.
   @internal
 */
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::Attachment::Private
+class Q_DECL_HIDDEN KCalCore::Attachment::Private : public ArenaAllocated
 {
 public:
     Private(const QString &mime, bool binary)
@@ -54,6 +74,8 @@ public:
           mMimeType(other.mMimeType),
           mUri(other.mUri),
           mEncodedData(other.mEncodedData),
+          mStore(other.mStore),
+          mStoreKey(other.mStoreKey),
           mLabel(other.mLabel),
           mBinary(other.mBinary),
           mLocal(other.mLocal),
@@ -64,11 +86,24 @@ public:
     {
     }
 
+    // Returns the decoded data kept in the store, or a null array
+    QByteArray readStore() const
+    {
+        QByteArray data;
+        if (QIODevice *device = mStore->open(mStoreKey)) {
+            data = device->readAll();
+            delete device;
+        }
+        return data;
+    }
+
     QByteArray mDecodedDataCache;
     uint mSize;
     QString mMimeType;
     QString mUri;
     QByteArray mEncodedData;
+    AttachmentStore::Ptr mStore;  // where the binary data was moved to, if any
+    QByteArray mStoreKey;         // key of the binary data in mStore
     QString mLabel;
     bool mBinary = false;
     bool mLocal = false;
@@ -126,6 +161,9 @@ bool Attachment::isBinary() const
 QByteArray Attachment::data() const
 {
     if (d->mBinary) {
+        if (d->mStore) {
+            return d->readStore().toBase64();
+        }
         return d->mEncodedData;
     } else {
         return QByteArray();
@@ -134,6 +172,11 @@ QByteArray Attachment::data() const
 
 QByteArray Attachment::decodedData() const
 {
+    if (d->mStore) {
+        // Not cached, the point of the store is not to keep it in memory
+        return d->readStore();
+    }
+
     if (d->mDecodedDataCache.isNull()) {
         d->mDecodedDataCache = QByteArray::fromBase64(d->mEncodedData);
     }
@@ -153,6 +196,8 @@ void Attachment::setData(const QByteArray &base64)
     d->mEncodedData = base64;
     d->mBinary = true;
     d->mDecodedDataCache = QByteArray();
+    d->mStore.clear();
+    d->mStoreKey.clear();
     d->mSize = 0;
 }
 
@@ -162,12 +207,56 @@ uint Attachment::size() const
         return 0;
     }
     if (!d->mSize) {
-        d->mSize = decodedData().size();
+        d->mSize = decodedBase64Size(d->mEncodedData);
     }
 
     return d->mSize;
 }
 
+QIODevice *Attachment::openDecodedData() const
+{
+    if (!d->mBinary) {
+        return nullptr;
+    }
+
+    if (d->mStore) {
+        return d->mStore->open(d->mStoreKey);
+    }
+
+    QBuffer *buffer = new QBuffer;
+    buffer->setData(decodedData());
+    buffer->open(QIODevice::ReadOnly);
+    return buffer;
+}
+
+bool Attachment::moveToStore(const AttachmentStore::Ptr &store)
+{
+    if (!d->mBinary || !store) {
+        return false;
+    }
+    if (d->mStore == store) {
+        return true;
+    }
+
+    const uint size = this->size();
+    const QByteArray key = store->store(decodedData());
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    d->mEncodedData = QByteArray();
+    d->mDecodedDataCache = QByteArray();
+    d->mStore = store;
+    d->mStoreKey = key;
+    d->mSize = size;
+    return true;
+}
+
+AttachmentStore::Ptr Attachment::store() const
+{
+    return d->mStore;
+}
+
 QString Attachment::mimeType() const
 {
     return d->mMimeType;
@@ -215,6 +304,9 @@ Attachment &Attachment::operator=(const Attachment &other)
         d->mMimeType = other.d->mMimeType;
         d->mUri = other.d->mUri;
         d->mEncodedData = other.d->mEncodedData;
+        d->mDecodedDataCache = QByteArray();
+        d->mStore = other.d->mStore;
+        d->mStoreKey = other.d->mStoreKey;
         d->mLabel = other.d->mLabel;
         d->mBinary = other.d->mBinary;
         d->mLocal  = other.d->mLocal;
@@ -243,7 +335,7 @@ bool Attachment::operator!=(const Attachment &a2) const
 QDataStream &KCalCore::operator<<(QDataStream &out, const KCalCore::Attachment::Ptr &a)
 {
     if (a) {
-        out << a->d->mSize << a->d->mMimeType << a->d->mUri << a->d->mEncodedData << a->d->mLabel << a->d->mBinary << a->d->mLocal << a->d->mShowInline;
+        out << a->d->mSize << a->d->mMimeType << a->d->mUri << a->data() << a->d->mLabel << a->d->mBinary << a->d->mLocal << a->d->mShowInline;
     }
     return out;
 }
@@ -252,7 +344,27 @@ QDataStream &KCalCore::operator>>(QDataStream &in, const KCalCore::Attachment::P
 {
     if (a) {
         in >> a->d->mSize >> a->d->mMimeType >> a->d->mUri >> a->d->mEncodedData >> a->d->mLabel >> a->d->mBinary >> a->d->mLocal >> a->d->mShowInline;
+        a->d->mDecodedDataCache = QByteArray();
+        a->d->mStore.clear();
+        a->d->mStoreKey.clear();
     }
     return in;
 }
 
+
+//@cond PRIVATE
+void MemoryAccounting::addAttachment(const Attachment::Ptr &attachment)
+{
+    if (!firstTime(attachment.data())) {
+        return;
+    }
+    const Attachment::Private *d = attachment->d;
+    add(MemoryUsage::Attachments, sizeof(Attachment) + 2 * sizeof(void *) + sizeof(Attachment::Private));
+    addString(d->mMimeType, MemoryUsage::Attachments);
+    addString(d->mUri, MemoryUsage::Attachments);
+    addString(d->mLabel, MemoryUsage::Attachments);
+    addByteArray(d->mEncodedData, MemoryUsage::Attachments);
+    addByteArray(d->mDecodedDataCache, MemoryUsage::Attachments);
+    addByteArray(d->mStoreKey, MemoryUsage::Attachments);
+}
+//@endcond
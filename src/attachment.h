@@ -30,6 +30,7 @@
 #define KCALCORE_ATTACHMENT_H
 
 #include "kcalcore_export.h"
+#include "attachmentstore.h"
 
 #include <QHash>
 #include <QString>
@@ -168,9 +169,47 @@ public:
       Returns the size of the attachment, in bytes.
       If the attachment is binary (i.e, there is no @acronym URI associated
       with the attachment) then a value of 0 is returned.
+
+      The data is not decoded to compute the size.
     */
     uint size() const;
 
+    /**
+      Returns a device opened for reading the decoded binary data of the
+      attachment, or nullptr if the attachment is not binary. The caller
+      takes ownership of the device.
+
+      Unlike decodedData(), this does not load the data into memory if it
+      was moved to an AttachmentStore.
+
+      @see moveToStore()
+      @since 5.8
+    */
+    QIODevice *openDecodedData() const;
+
+    /**
+      Moves the binary data of the attachment to @p store. The attachment
+      then only keeps the key to its data, which is read back from the store
+      when accessed; the data accessors return the same data as before.
+
+      Setting new data with setData() or setDecodedData() moves the data
+      back into memory.
+
+      @return true if the data was moved, false if the attachment is not
+      binary or the data could not be stored.
+      @see store()
+      @since 5.8
+    */
+    bool moveToStore(const AttachmentStore::Ptr &store);
+
+    /**
+      Returns the store the binary data of the attachment was moved to, or a
+      null pointer if the data is kept in memory.
+      @see moveToStore()
+      @since 5.8
+    */
+    AttachmentStore::Ptr store() const;
+
     /**
       Sets the @acronym MIME-type of the attachment to @p mime.
 
@@ -258,6 +297,7 @@ public:
 
 private:
     //@cond PRIVATE
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
@@ -0,0 +1,149 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and
+  defines the AttachmentStore class.
+*/
+
+#include "attachmentstore.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+using namespace KCalCore;
+
+//@cond PRIVATE
+class Q_DECL_HIDDEN KCalCore::AttachmentStore::Private
+{
+public:
+    explicit Private(const QString &directory)
+        : mDirectory(directory)
+    {
+    }
+
+    // Returns the path of the payload stored under @p key, or an empty
+    // string if @p key is not a valid key
+    QString path(const QByteArray &key) const
+    {
+        if (key.size() != 64) {
+            return QString();
+        }
+        for (const char c : key) {
+            if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+                return QString();
+            }
+        }
+        // Spread the payloads over subdirectories named after the first
+        // two digits, keeping directories small
+        return mDirectory + QLatin1Char('/') + QLatin1String(key.left(2))
+               + QLatin1Char('/') + QLatin1String(key.mid(2));
+    }
+
+    QString mDirectory;
+    qint64 mThreshold = 64 * 1024;
+};
+//@endcond
+
+AttachmentStore::AttachmentStore(const QString &directory)
+    : d(new Private(directory))
+{
+}
+
+AttachmentStore::~AttachmentStore()
+{
+    delete d;
+}
+
+QString AttachmentStore::directory() const
+{
+    return d->mDirectory;
+}
+
+void AttachmentStore::setThreshold(qint64 size)
+{
+    d->mThreshold = size;
+}
+
+qint64 AttachmentStore::threshold() const
+{
+    return d->mThreshold;
+}
+
+QByteArray AttachmentStore::store(const QByteArray &data)
+{
+    const QByteArray key = QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+    const QString path = d->path(key);
+    if (QFileInfo::exists(path)) {
+        return key;
+    }
+
+    if (!QDir().mkpath(QFileInfo(path).path())) {
+        return QByteArray();
+    }
+
+    // Written atomically, so readers never see a partial payload
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)
+            || file.write(data) != data.size()
+            || !file.commit()) {
+        return QByteArray();
+    }
+    return key;
+}
+
+bool AttachmentStore::contains(const QByteArray &key) const
+{
+    const QString path = d->path(key);
+    return !path.isEmpty() && QFileInfo::exists(path);
+}
+
+qint64 AttachmentStore::size(const QByteArray &key) const
+{
+    const QString path = d->path(key);
+    if (path.isEmpty()) {
+        return -1;
+    }
+    const QFileInfo info(path);
+    return info.exists() ? info.size() : -1;
+}
+
+QIODevice *AttachmentStore::open(const QByteArray &key) const
+{
+    const QString path = d->path(key);
+    if (path.isEmpty()) {
+        return nullptr;
+    }
+
+    QFile *file = new QFile(path);
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
+        return nullptr;
+    }
+    return file;
+}
+
+bool AttachmentStore::remove(const QByteArray &key)
+{
+    const QString path = d->path(key);
+    return !path.isEmpty() && QFile::remove(path);
+}
@@ -0,0 +1,137 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and
+  defines the AttachmentStore class.
+*/
+
+#ifndef KCALCORE_ATTACHMENTSTORE_H
+#define KCALCORE_ATTACHMENTSTORE_H
+
+#include "kcalcore_export.h"
+
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QString>
+
+class QIODevice;
+
+namespace KCalCore
+{
+
+/**
+  @brief
+  An on-disk store for the payloads of binary attachments.
+
+  Inline attachments are kept in memory base64 encoded, and once decoded
+  also in a second, decoded copy. For calendars with embedded documents
+  and images this quickly adds up. Attachment::moveToStore() writes the
+  payload of an attachment to a store and drops it from memory; it is then
+  read back from disk when accessed, preferably through
+  Attachment::openDecodedData().
+
+  Payloads are addressed by a hash of their content, so equal payloads are
+  stored once. Set a store on an ICalFormat with
+  ICalFormat::setAttachmentStore() to move the payloads of at least
+  threshold() bytes to it while reading.
+
+  Payloads are never removed from the directory automatically; it is up to
+  the application to clean up payloads no longer used with remove().
+
+  @since 5.8
+*/
+class KCALCORE_EXPORT AttachmentStore
+{
+public:
+    /**
+      A shared pointer to an AttachmentStore.
+    */
+    typedef QSharedPointer<AttachmentStore> Ptr;
+
+    /**
+      Constructs a store keeping its payloads in @p directory, which is
+      created when the first payload is stored.
+    */
+    explicit AttachmentStore(const QString &directory);
+
+    /**
+      Destructor.
+    */
+    ~AttachmentStore();
+
+    /**
+      Returns the directory the payloads are stored in.
+    */
+    QString directory() const;
+
+    /**
+      Sets the size in bytes from which ICalFormat moves the payloads of
+      the attachments it reads to this store. Default is 64 KiB.
+      @see threshold()
+    */
+    void setThreshold(qint64 size);
+
+    /**
+      Returns the size from which payloads are moved to this store.
+      @see setThreshold()
+    */
+    qint64 threshold() const;
+
+    /**
+      Stores @p data and returns the key to access it, or an empty key if
+      it could not be written.
+    */
+    QByteArray store(const QByteArray &data);
+
+    /**
+      Returns true if a payload is stored under @p key.
+    */
+    bool contains(const QByteArray &key) const;
+
+    /**
+      Returns the size in bytes of the payload stored under @p key, or -1
+      if there is none.
+    */
+    qint64 size(const QByteArray &key) const;
+
+    /**
+      Returns a device opened for reading the payload stored under @p key,
+      or nullptr if there is none. The caller takes ownership of the device.
+    */
+    QIODevice *open(const QByteArray &key) const;
+
+    /**
+      Removes the payload stored under @p key. Attachments still referring
+      to it will have no data anymore.
+      @return true if the payload was removed.
+    */
+    bool remove(const QByteArray &key);
+
+private:
+    //@cond PRIVATE
+    Q_DISABLE_COPY(AttachmentStore)
+    class Private;
+    Private *const d;
+    //@endcond
+};
+
+}
+
+#endif
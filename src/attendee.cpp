@@ -32,6 +32,8 @@
 */
 
 #include "attendee.h"
+#include "arena_p.h"
+#include "memoryaccounting_p.h"
 
 #include <QDataStream>
 
@@ -42,7 +44,7 @@ using namespace KCalCore;
   @internal
 */
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::Attendee::Private
+class Q_DECL_HIDDEN KCalCore::Attendee::Private : public QSharedData, public ArenaAllocated
 {
 public:
     void setCuType(CuType cuType);
@@ -129,13 +131,12 @@ Attendee::Attendee(const QString &name, const QString &email, bool rsvp,
 
 Attendee::Attendee(const Attendee &attendee)
     : Person(attendee),
-      d(new Attendee::Private(*attendee.d))
+      d(attendee.d)
 {
 }
 
 Attendee::~Attendee()
 {
-    delete d;
 }
 
 bool KCalCore::Attendee::operator==(const Attendee &attendee) const
@@ -163,9 +164,8 @@ Attendee &KCalCore::Attendee::operator=(const Attendee &attendee)
         return *this;
     }
 
-    *d = *attendee.d;
-    setName(attendee.name());
-    setEmail(attendee.email());
+    Person::operator=(attendee);
+    d = attendee.d;
     return *this;
 }
 
@@ -268,14 +268,16 @@ QDataStream &KCalCore::operator<<(QDataStream &stream, const KCalCore::Attendee:
 {
     KCalCore::Person::Ptr p(new KCalCore::Person(*((Person *)attendee.data())));
     stream << p;
-    return stream << attendee->d->mRSVP
-           << int(attendee->d->mRole)
-           << int(attendee->d->mStatus)
-           << attendee->d->mUid
-           << attendee->d->mDelegate
-           << attendee->d->mDelegator
-           << attendee->d->cuTypeStr()
-           << attendee->d->mCustomProperties;
+    // Through a const reference, so the shared data isn't detached
+    const Attendee &a = *attendee;
+    return stream << a.d->mRSVP
+           << int(a.d->mRole)
+           << int(a.d->mStatus)
+           << a.d->mUid
+           << a.d->mDelegate
+           << a.d->mDelegator
+           << a.d->cuTypeStr()
+           << a.d->mCustomProperties;
 }
 
 QDataStream &KCalCore::operator>>(QDataStream &stream, KCalCore::Attendee::Ptr &attendee)
@@ -314,3 +316,29 @@ QDataStream &KCalCore::operator>>(QDataStream &stream, KCalCore::Attendee::Ptr &
     attendee.swap(att_temp);
     return stream;
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addAttendee(const Attendee::Ptr &attendee)
+{
+    if (!firstTime(attendee.data())) {
+        return;
+    }
+    add(MemoryUsage::Persons, sizeof(Attendee) + 2 * sizeof(void *));
+    // The name and email are kept by the Person base
+    const Person &person = *attendee;
+    const Person::Private *personData = person.d.constData();
+    if (firstTime(personData)) {
+        add(MemoryUsage::Persons, sizeof(Person::Private));
+        addString(personData->mName, MemoryUsage::Persons);
+        addString(personData->mEmail, MemoryUsage::Persons);
+    }
+    const Attendee::Private *d = attendee->d.constData();
+    if (firstTime(d)) {
+        add(MemoryUsage::Persons, sizeof(Attendee::Private));
+        addString(d->mUid, MemoryUsage::Persons);
+        addString(d->mDelegate, MemoryUsage::Persons);
+        addString(d->mDelegator, MemoryUsage::Persons);
+        addCustomProperties(d->mCustomProperties, MemoryUsage::Persons);
+    }
+}
+//@endcond
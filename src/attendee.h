@@ -54,6 +54,9 @@ namespace KCalCore
   Note that each attendee be can optionally associated with a @acronym UID
   (unique identifier) derived from a Calendar Incidence, Email Message,
   or any other thing you want.
+
+  Like Person, Attendee implicitly shares its data between copies. Calendars
+  use this to store equal attendees of different incidences only once.
 */
 class KCALCORE_EXPORT Attendee : private Person
 {
@@ -318,8 +321,9 @@ public:
 
 private:
     //@cond PRIVATE
+    friend class MemoryAccounting;
     class Private;
-    Private *const d;
+    QSharedDataPointer<Private> d;
     //@endcond
 
     friend KCALCORE_EXPORT QDataStream &operator<<(QDataStream &s,
@@ -38,7 +38,10 @@
 #include "calendar_p.h"
 #include "calfilter.h"
 #include "icaltimezones_p.h"
+#include "instrumentation_p.h"
+#include "memoryaccounting_p.h"
 #include "sorting.h"
+#include "sorting_p.h"
 #include "visitor.h"
 #include "utils.h"
 
@@ -50,7 +53,8 @@ extern "C" {
 #include <icaltimezone.h>
 }
 
-#include <algorithm>  // for std::remove()
+#include <algorithm>  // for std::remove(), std::remove_if()
+#include <limits>
 
 using namespace KCalCore;
 
@@ -198,6 +202,238 @@ QTimeZone Calendar::Private::timeZoneIdSpec(const QByteArray &timeZoneId)
         return tz;
     return QTimeZone::systemTimeZone();
 }
+
+void Calendar::Private::indexIncidence(const Incidence::Ptr &incidence)
+{
+    if (mIndexedKeys.contains(incidence)) {
+        // Added twice, just make sure the keys are still correct
+        reindexIncidence(incidence);
+        return;
+    }
+
+    IndexedKeys &keys = mIndexedKeys[incidence];
+    keys.schedulingId = incidence->schedulingID();
+    mIncidencesBySchedulingId[keys.schedulingId].append(incidence);
+
+    keys.categories = incidence->categories();
+    for (const QString &category : qAsConst(keys.categories)) {
+        mIncidencesByCategory[category].insert(incidence);
+    }
+}
+
+void Calendar::Private::shareAttendees(const Incidence::Ptr &incidence)
+{
+    if (mSharedPersons.size() + mSharedAttendees.size() > mSharedPurgeLimit) {
+        purgeSharedAttendees();
+    }
+
+    const Person::Ptr organizer = incidence->organizer();
+    if (!organizer->isEmpty()) {
+        QWeakPointer<Person> &entry = mSharedPersons[qMakePair(organizer->name(), organizer->email())];
+        const Person::Ptr shared = entry.toStrongRef();
+        if (!shared || *shared != *organizer) {
+            // Unused, or renamed since it was entered under this key
+            entry = organizer;
+        } else if (shared != organizer && shared->count() == organizer->count()) {
+            *organizer = *shared;
+        }
+    }
+
+    const Attendee::List attendees = incidence->attendees();
+    for (const Attendee::Ptr &attendee : attendees) {
+        // Only compare through const references, which don't detach
+        const Attendee &a = *attendee;
+        QVector<QWeakPointer<Attendee> > &variants = mSharedAttendees[qMakePair(a.name(), a.email())];
+        bool found = false;
+        for (auto it = variants.begin(); it != variants.end();) {
+            const Attendee::Ptr shared = it->toStrongRef();
+            if (!shared) {
+                it = variants.erase(it);
+                continue;
+            }
+            const Attendee &s = *shared;
+            if (s == a && s.customProperties() == a.customProperties()) {
+                if (shared != attendee) {
+                    *attendee = s;
+                }
+                found = true;
+                break;
+            }
+            ++it;
+        }
+        if (!found) {
+            variants.append(attendee);
+        }
+    }
+}
+
+void Calendar::Private::purgeSharedAttendees()
+{
+    for (auto it = mSharedPersons.begin(); it != mSharedPersons.end();) {
+        if (it->isNull()) {
+            it = mSharedPersons.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for (auto it = mSharedAttendees.begin(); it != mSharedAttendees.end();) {
+        QVector<QWeakPointer<Attendee> > &variants = *it;
+        variants.erase(std::remove_if(variants.begin(), variants.end(),
+                                      [](const QWeakPointer<Attendee> &a) { return a.isNull(); }),
+                       variants.end());
+        if (variants.isEmpty()) {
+            it = mSharedAttendees.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    // Sweep again once the maps have doubled, so this is amortized O(1)
+    mSharedPurgeLimit = qMax(1024, 2 * (mSharedPersons.size() + mSharedAttendees.size()));
+}
+
+void Calendar::Private::reindexIncidence(const Incidence::Ptr &incidence)
+{
+    // Incidences stay associated to their notebook when deleted, so this
+    // is done before the check below
+    auto dit = mDuplicateKeys.find(incidence);
+    if (dit != mDuplicateKeys.end()) {
+        const DuplicateKey key = duplicateKey(incidence);
+        if (*dit != key) {
+            mIncidencesByDuplicateKey.remove(*dit, incidence);
+            mIncidencesByDuplicateKey.insert(key, incidence);
+            *dit = key;
+        }
+    }
+
+    auto it = mIndexedKeys.find(incidence);
+    if (it == mIndexedKeys.end()) {
+        // Not in this calendar
+        return;
+    }
+
+    // schedulingID() falls back to the uid, so compare the result instead of
+    // checking for FieldSchedulingId in the dirty fields
+    const QString sid = incidence->schedulingID();
+    if (it->schedulingId != sid) {
+        removeFromSchedulingIdIndex(incidence, it->schedulingId);
+        mIncidencesBySchedulingId[sid].append(incidence);
+        it->schedulingId = sid;
+    }
+
+    const QStringList categories = incidence->categories();
+    if (it->categories != categories) {
+        removeFromCategoryIndex(incidence, it->categories);
+        for (const QString &category : categories) {
+            mIncidencesByCategory[category].insert(incidence);
+        }
+        it->categories = categories;
+    }
+}
+
+void Calendar::Private::unindexIncidence(const Incidence::Ptr &incidence)
+{
+    auto it = mIndexedKeys.find(incidence);
+    if (it == mIndexedKeys.end()) {
+        return;
+    }
+
+    removeFromSchedulingIdIndex(incidence, it->schedulingId);
+    removeFromCategoryIndex(incidence, it->categories);
+    mIndexedKeys.erase(it);
+}
+
+void Calendar::Private::removeFromSchedulingIdIndex(const Incidence::Ptr &incidence,
+                                                    const QString &schedulingId)
+{
+    auto it = mIncidencesBySchedulingId.find(schedulingId);
+    if (it != mIncidencesBySchedulingId.end()) {
+        it->removeOne(incidence);
+        if (it->isEmpty()) {
+            mIncidencesBySchedulingId.erase(it);
+        }
+    }
+}
+
+void Calendar::Private::removeFromCategoryIndex(const Incidence::Ptr &incidence,
+                                                const QStringList &categories)
+{
+    for (const QString &category : categories) {
+        auto it = mIncidencesByCategory.find(category);
+        if (it != mIncidencesByCategory.end()) {
+            it->remove(incidence);
+            // Drop categories no longer used by any incidence
+            if (it->isEmpty()) {
+                mIncidencesByCategory.erase(it);
+            }
+        }
+    }
+}
+
+Calendar::Private::DuplicateKey Calendar::Private::duplicateKey(const Incidence::Ptr &incidence)
+{
+    // All invalid start times are equal for duplicates(), valid ones are
+    // compared as points in time
+    const QDateTime dtStart = incidence->dtStart();
+    return DuplicateKey(dtStart.isValid() ? dtStart.toMSecsSinceEpoch() : std::numeric_limits<qint64>::min(),
+                        incidence->summary());
+}
+
+void Calendar::Private::addToDuplicateIndex(const Incidence::Ptr &incidence)
+{
+    if (!mDuplicateKeys.contains(incidence)) {
+        const DuplicateKey key = duplicateKey(incidence);
+        mIncidencesByDuplicateKey.insert(key, incidence);
+        mDuplicateKeys.insert(incidence, key);
+    }
+}
+
+void Calendar::Private::removeFromDuplicateIndex(const Incidence::Ptr &incidence)
+{
+    auto it = mDuplicateKeys.find(incidence);
+    if (it != mDuplicateKeys.end()) {
+        mIncidencesByDuplicateKey.remove(*it, incidence);
+        mDuplicateKeys.erase(it);
+    }
+}
+
+void Calendar::Private::deferNotification(const Incidence::Ptr &incidence,
+                                          PendingChange change)
+{
+    auto it = mPendingChanges.find(incidence);
+    if (it == mPendingChanges.end()) {
+        mPendingIncidences.append(incidence);
+        mPendingChanges.insert(incidence, change);
+        return;
+    }
+
+    switch (change) {
+    case PendingAdded:
+        // Deleted and added again: the observers only need to refresh it
+        if (*it == PendingDeleted) {
+            *it = PendingChanged;
+        }
+        break;
+    case PendingChanged:
+        // An added incidence is reported with its final state anyway
+        break;
+    case PendingDeleted:
+        // Added and deleted again: the observers never need to know
+        if (*it == PendingAdded) {
+            mPendingChanges.erase(it);
+        } else {
+            *it = PendingDeleted;
+        }
+        break;
+    }
+}
+
+bool Calendar::Private::isPendingAddition(const Incidence::Ptr &incidence) const
+{
+    auto it = mPendingChanges.constFind(incidence);
+    return it != mPendingChanges.constEnd() && *it == PendingAdded;
+}
 //@endcond
 
 QByteArray Calendar::timeZoneId() const
@@ -243,21 +479,14 @@ CalFilter *Calendar::filter() const
 
 QStringList Calendar::categories() const
 {
-    Incidence::List rawInc(rawIncidences());
-    QStringList cats, thisCats;
-    // @TODO: For now just iterate over all incidences. In the future,
-    // the list of categories should be built when reading the file.
-    for (Incidence::List::ConstIterator i = rawInc.constBegin();
-            i != rawInc.constEnd(); ++i) {
-        thisCats = (*i)->categories();
-        for (QStringList::ConstIterator si = thisCats.constBegin();
-                si != thisCats.constEnd(); ++si) {
-            if (!cats.contains(*si)) {
-                cats.append(*si);
-            }
-        }
-    }
-    return cats;
+    QStringList categories = d->mIncidencesByCategory.keys();
+    categories.sort();
+    return categories;
+}
+
+Incidence::List Calendar::incidencesWithCategory(const QString &category) const
+{
+    return Incidence::List::fromList(d->mIncidencesByCategory.value(category).toList());
 }
 
 Incidence::List Calendar::incidences(const QDate &date) const
@@ -299,9 +528,9 @@ Incidence::List Calendar::duplicates(const Incidence::Ptr &incidence)
 {
     if (incidence) {
         Incidence::List list;
-        Incidence::List vals = values(d->mNotebookIncidences);
-        Incidence::List::const_iterator it;
-        for (it = vals.constBegin(); it != vals.constEnd(); ++it) {
+        const QList<Incidence::Ptr> candidates = d->mIncidencesByDuplicateKey.values(Private::duplicateKey(incidence));
+        QList<Incidence::Ptr>::const_iterator it;
+        for (it = candidates.constBegin(); it != candidates.constEnd(); ++it) {
             if (((incidence->dtStart() == (*it)->dtStart()) ||
                     (!incidence->dtStart().isValid() && !(*it)->dtStart().isValid())) &&
                     (incidence->summary() == (*it)->summary())) {
@@ -365,26 +594,17 @@ bool Calendar::hasValidNotebook(const QString &notebook) const
 
 bool Calendar::isVisible(const Incidence::Ptr &incidence) const
 {
-    if (d->mIncidenceVisibility.contains(incidence)) {
-        return d->mIncidenceVisibility[incidence];
-    }
-    const QString nuid = notebook(incidence);
-    bool rv;
-    if (d->mNotebooks.contains(nuid)) {
-        rv = d->mNotebooks.value(nuid);
-    } else {
-        // NOTE returns true also for nonexisting notebooks for compatibility
-        rv = true;
-    }
-    d->mIncidenceVisibility[incidence] = rv;
-    return rv;
+    // Not cached, so that this stays read-only and can't go stale
+    // NOTE returns true also for nonexisting notebooks for compatibility
+    return d->mNotebooks.value(notebook(incidence), true);
 }
 
 void Calendar::clearNotebookAssociations()
 {
     d->mNotebookIncidences.clear();
     d->mUidToNotebook.clear();
-    d->mIncidenceVisibility.clear();
+    d->mIncidencesByDuplicateKey.clear();
+    d->mDuplicateKeys.clear();
 }
 
 bool Calendar::setNotebook(const Incidence::Ptr &inc, const QString &notebook)
@@ -412,15 +632,18 @@ bool Calendar::setNotebook(const Incidence::Ptr &inc, const QString &notebook)
             for (it = list.begin(); it != list.end(); ++it) {
                 d->mNotebookIncidences.remove(old, *it);
                 d->mNotebookIncidences.insert(notebook, *it);
+                d->addToDuplicateIndex(*it);
             }
             notifyIncidenceChanged(inc);   // for removing from old notebook
             // don not remove from mUidToNotebook to keep deleted incidences
             d->mNotebookIncidences.remove(old, inc);
+            d->removeFromDuplicateIndex(inc);
         }
     }
     if (!notebook.isEmpty()) {
         d->mUidToNotebook.insert(inc->uid(), notebook);
         d->mNotebookIncidences.insert(notebook, inc);
+        d->addToDuplicateIndex(inc);
         qCDebug(KCALCORE_LOG) << "setting notebook" << notebook << "for" << inc->uid();
         notifyIncidenceChanged(inc);   // for inserting into new notebook
     }
@@ -461,47 +684,19 @@ Event::List Calendar::sortEvents(const Event::List &eventList,
                                  EventSortField sortField,
                                  SortDirection sortDirection)
 {
-
     if (eventList.isEmpty()) {
         return Event::List();
     }
 
-    Event::List eventListSorted;
-
-    // Notice we alphabetically presort Summaries first.
-    // We do this so comparison "ties" stay in a nice order.
-    eventListSorted = eventList;
-    switch (sortField) {
-    case EventSortUnsorted:
-        break;
-
-    case EventSortStartDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(eventListSorted.begin(), eventListSorted.end(), Events::startDateLessThan);
-        } else {
-            std::sort(eventListSorted.begin(), eventListSorted.end(), Events::startDateMoreThan);
-        }
-        break;
-
-    case EventSortEndDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(eventListSorted.begin(), eventListSorted.end(), Events::endDateLessThan);
-        } else {
-            std::sort(eventListSorted.begin(), eventListSorted.end(), Events::endDateMoreThan);
-        }
-        break;
-
-    case EventSortSummary:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(eventListSorted.begin(), eventListSorted.end(), Events::summaryLessThan);
-        } else {
-            std::sort(eventListSorted.begin(), eventListSorted.end(), Events::summaryMoreThan);
-        }
-        break;
-    }
-
-    return eventListSorted;
+    return SortHelpers::sortEvents(eventList, sortField, sortDirection);
+}
 
+Event::List Calendar::sortEvents(const Event::List &eventList,
+                                 EventSortField sortField,
+                                 SortDirection sortDirection,
+                                 int offset, int limit)
+{
+    return SortHelpers::sortEvents(eventList, sortField, sortDirection, offset, limit);
 }
 
 Event::List Calendar::events(const QDate &date,
@@ -538,6 +733,16 @@ Event::List Calendar::events(EventSortField sortField,
     return el;
 }
 
+Event::List Calendar::events(EventSortField sortField,
+                             SortDirection sortDirection,
+                             int offset, int limit) const
+{
+    // Filter first, so that only the Events on the page get sorted
+    Event::List el = rawEvents(EventSortUnsorted, sortDirection);
+    d->mFilter->apply(&el);
+    return SortHelpers::sortEvents(el, sortField, sortDirection, offset, limit);
+}
+
 bool Calendar::addIncidence(const Incidence::Ptr &incidence)
 {
     if (!incidence) {
@@ -548,6 +753,31 @@ bool Calendar::addIncidence(const Incidence::Ptr &incidence)
     return incidence->accept(v, incidence);
 }
 
+bool Calendar::addIncidences(const Incidence::List &incidences)
+{
+    const bool startBatch = !batchAdding();
+    if (startBatch) {
+        startBatchAdding();
+    }
+
+    AddIncidencesHookData data = { &incidences, false, false };
+    virtual_hook(AddIncidencesHook, &data);
+    bool success = data.success;
+    if (!data.handled) {
+        // Through the per-type methods, which subclasses may reimplement
+        AddVisitor<Calendar> v(this);
+        success = true;
+        for (const Incidence::Ptr &incidence : incidences) {
+            success = incidence && incidence->accept(v, incidence) && success;
+        }
+    }
+
+    if (startBatch) {
+        endBatchAdding();
+    }
+    return success;
+}
+
 bool Calendar::deleteIncidence(const Incidence::Ptr &incidence)
 {
     if (!incidence) {
@@ -634,29 +864,13 @@ Incidence::Ptr Calendar::deleted(const QString &uid, const QDateTime &recurrence
 
 Incidence::List Calendar::incidencesFromSchedulingID(const QString &sid) const
 {
-    Incidence::List result;
-    const Incidence::List incidences = rawIncidences();
-    Incidence::List::const_iterator it = incidences.begin();
-    for (; it != incidences.end(); ++it) {
-        if ((*it)->schedulingID() == sid) {
-            result.append(*it);
-        }
-    }
-    return result;
+    return d->mIncidencesBySchedulingId.value(sid);
 }
 
 Incidence::Ptr Calendar::incidenceFromSchedulingID(const QString &uid) const
 {
-    const Incidence::List incidences = rawIncidences();
-    Incidence::List::const_iterator it = incidences.begin();
-    for (; it != incidences.end(); ++it) {
-        if ((*it)->schedulingID() == uid) {
-            // Touchdown, and the crowd goes wild
-            return *it;
-        }
-    }
-    // Not found
-    return Incidence::Ptr();
+    const auto it = d->mIncidencesBySchedulingId.constFind(uid);
+    return it != d->mIncidencesBySchedulingId.cend() ? it->first() : Incidence::Ptr();
 }
 
 /** static */
@@ -668,68 +882,16 @@ Todo::List Calendar::sortTodos(const Todo::List &todoList,
         return Todo::List();
     }
 
-    Todo::List todoListSorted;
-
-    // Notice we alphabetically presort Summaries first.
-    // We do this so comparison "ties" stay in a nice order.
-
     // Note that To-dos may not have Start DateTimes nor due DateTimes.
+    return SortHelpers::sortTodos(todoList, sortField, sortDirection);
+}
 
-    todoListSorted = todoList;
-    switch (sortField) {
-    case TodoSortUnsorted:
-        break;
-
-    case TodoSortStartDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::startDateLessThan);
-        } else {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::startDateMoreThan);
-        }
-        break;
-
-    case TodoSortDueDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::dueDateLessThan);
-        } else {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::dueDateMoreThan);
-        }
-        break;
-
-    case TodoSortPriority:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::priorityLessThan);
-        } else {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::priorityMoreThan);
-        }
-        break;
-
-    case TodoSortPercentComplete:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::percentLessThan);
-        } else {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::percentMoreThan);
-        }
-        break;
-
-    case TodoSortSummary:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::summaryLessThan);
-        } else {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::summaryMoreThan);
-        }
-        break;
-
-    case TodoSortCreated:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::createdLessThan);
-        } else {
-            std::sort(todoListSorted.begin(), todoListSorted.end(), Todos::createdMoreThan);
-        }
-        break;
-    }
-
-    return todoListSorted;
+Todo::List Calendar::sortTodos(const Todo::List &todoList,
+                               TodoSortField sortField,
+                               SortDirection sortDirection,
+                               int offset, int limit)
+{
+    return SortHelpers::sortTodos(todoList, sortField, sortDirection, offset, limit);
 }
 
 Todo::List Calendar::todos(TodoSortField sortField,
@@ -740,6 +902,16 @@ Todo::List Calendar::todos(TodoSortField sortField,
     return tl;
 }
 
+Todo::List Calendar::todos(TodoSortField sortField,
+                           SortDirection sortDirection,
+                           int offset, int limit) const
+{
+    // Filter first, so that only the Todos on the page get sorted
+    Todo::List tl = rawTodos(TodoSortUnsorted, sortDirection);
+    d->mFilter->apply(&tl);
+    return SortHelpers::sortTodos(tl, sortField, sortDirection, offset, limit);
+}
+
 Todo::List Calendar::todos(const QDate &date) const
 {
     Todo::List el = rawTodosForDate(date);
@@ -764,30 +936,7 @@ Journal::List Calendar::sortJournals(const Journal::List &journalList,
         return Journal::List();
     }
 
-    Journal::List journalListSorted = journalList;
-
-    switch (sortField) {
-    case JournalSortUnsorted:
-        break;
-
-    case JournalSortDate:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(journalListSorted.begin(), journalListSorted.end(), Journals::dateLessThan);
-        } else {
-            std::sort(journalListSorted.begin(), journalListSorted.end(), Journals::dateMoreThan);
-        }
-        break;
-
-    case JournalSortSummary:
-        if (sortDirection == SortDirectionAscending) {
-            std::sort(journalListSorted.begin(), journalListSorted.end(), Journals::summaryLessThan);
-        } else {
-            std::sort(journalListSorted.begin(), journalListSorted.end(), Journals::summaryMoreThan);
-        }
-        break;
-    }
-
-    return journalListSorted;
+    return SortHelpers::sortJournals(journalList, sortField, sortDirection);
 }
 
 Journal::List Calendar::journals(JournalSortField sortField,
@@ -951,7 +1100,7 @@ bool Calendar::isAncestorOf(const Incidence::Ptr &ancestor,
 
 Incidence::List Calendar::relations(const QString &uid) const
 {
-    return d->mIncidenceRelations[uid];
+    return d->mIncidenceRelations.value(uid);
 }
 
 Calendar::CalendarObserver::~CalendarObserver()
@@ -995,6 +1144,10 @@ void Calendar::CalendarObserver::calendarIncidenceAdditionCanceled(const Inciden
     Q_UNUSED(incidence);
 }
 
+Calendar::CalendarBatchObserver::~CalendarBatchObserver()
+{
+}
+
 void Calendar::registerObserver(CalendarObserver *observer)
 {
     if (!observer) {
@@ -1027,6 +1180,7 @@ void Calendar::setModified(bool modified)
     if (modified != d->mModified || d->mNewObserver) {
         d->mNewObserver = false;
         for (CalendarObserver *observer : qAsConst(d->mObservers)) {
+            KCALCORE_COUNT(ObserverCallbacks);
             observer->calendarModified(modified, this);
         }
         d->mModified = modified;
@@ -1078,22 +1232,33 @@ void Calendar::notifyIncidenceAdded(const Incidence::Ptr &incidence)
         return;
     }
 
+    d->shareAttendees(incidence);
+    d->indexIncidence(incidence);
+
     if (!d->mObserversEnabled) {
         return;
     }
 
-    for (CalendarObserver *observer : qAsConst(d->mObservers)) {
-        observer->calendarIncidenceAdded(incidence);
-    }
-
     for (auto role : { IncidenceBase::RoleStartTimeZone, IncidenceBase::RoleEndTimeZone }) {
         const auto dt = incidence->dateTime(role);
         if (dt.isValid() && dt.timeZone() != QTimeZone::utc()) {
-            if (!d->mTimeZones.contains(dt.timeZone())) {
-                d->mTimeZones.push_back(dt.timeZone());
+            const QTimeZone tz = dt.timeZone();
+            if (!d->mTimeZoneIds.contains(tz.id())) {
+                d->mTimeZoneIds.insert(tz.id());
+                d->mTimeZones.push_back(tz);
             }
         }
     }
+
+    if (d->batchAddingInProgress) {
+        d->deferNotification(incidence, Private::PendingAdded);
+        return;
+    }
+
+    for (CalendarObserver *observer : qAsConst(d->mObservers)) {
+        KCALCORE_COUNT(ObserverCallbacks);
+        observer->calendarIncidenceAdded(incidence);
+    }
 }
 
 void Calendar::notifyIncidenceChanged(const Incidence::Ptr &incidence)
@@ -1102,11 +1267,19 @@ void Calendar::notifyIncidenceChanged(const Incidence::Ptr &incidence)
         return;
     }
 
+    d->reindexIncidence(incidence);
+
     if (!d->mObserversEnabled) {
         return;
     }
 
+    if (d->batchAddingInProgress) {
+        d->deferNotification(incidence, Private::PendingChanged);
+        return;
+    }
+
     for (CalendarObserver *observer : qAsConst(d->mObservers)) {
+        KCALCORE_COUNT(ObserverCallbacks);
         observer->calendarIncidenceChanged(incidence);
     }
 }
@@ -1117,11 +1290,20 @@ void Calendar::notifyIncidenceAboutToBeDeleted(const Incidence::Ptr &incidence)
         return;
     }
 
+    d->unindexIncidence(incidence);
+
     if (!d->mObserversEnabled) {
         return;
     }
 
+    // Not deferred, the observers must see the incidence before it is gone;
+    // unless they haven't been told about the incidence yet
+    if (d->batchAddingInProgress && d->isPendingAddition(incidence)) {
+        return;
+    }
+
     for (CalendarObserver *observer : qAsConst(d->mObservers)) {
+        KCALCORE_COUNT(ObserverCallbacks);
         observer->calendarIncidenceAboutToBeDeleted(incidence);
     }
 }
@@ -1136,7 +1318,13 @@ void Calendar::notifyIncidenceDeletedOld(const Incidence::Ptr &incidence)
         return;
     }
 
+    // Delivered with notifyIncidenceDeleted() at the end of the batch
+    if (d->batchAddingInProgress) {
+        return;
+    }
+
     for (CalendarObserver *observer : qAsConst(d->mObservers)) {
+        KCALCORE_COUNT(ObserverCallbacks);
         observer->calendarIncidenceDeleted(incidence);
     }
 }
@@ -1151,7 +1339,13 @@ void Calendar::notifyIncidenceDeleted(const Incidence::Ptr &incidence)
         return;
     }
 
+    if (d->batchAddingInProgress) {
+        d->deferNotification(incidence, Private::PendingDeleted);
+        return;
+    }
+
     for (CalendarObserver *observer : qAsConst(d->mObservers)) {
+        KCALCORE_COUNT(ObserverCallbacks);
         observer->calendarIncidenceDeleted(incidence, this);
     }
 }
@@ -1167,6 +1361,7 @@ void Calendar::notifyIncidenceAdditionCanceled(const Incidence::Ptr &incidence)
     }
 
     for (CalendarObserver *observer : qAsConst(d->mObservers)) {
+        KCALCORE_COUNT(ObserverCallbacks);
         observer->calendarIncidenceAdditionCanceled(incidence);
     }
 }
@@ -1363,6 +1558,61 @@ void Calendar::startBatchAdding()
 void Calendar::endBatchAdding()
 {
     d->batchAddingInProgress = false;
+
+    // Take the pending changes first, observers may modify the calendar
+    const QVector<Incidence::Ptr> pending = d->mPendingIncidences;
+    QHash<Incidence::Ptr, Private::PendingChange> changes = d->mPendingChanges;
+    d->mPendingIncidences.clear();
+    d->mPendingChanges.clear();
+
+    Incidence::List added, changed, deleted;
+    for (const Incidence::Ptr &incidence : pending) {
+        auto it = changes.find(incidence);
+        if (it == changes.end()) {
+            continue;
+        }
+        switch (*it) {
+        case Private::PendingAdded:
+            added.append(incidence);
+            break;
+        case Private::PendingChanged:
+            changed.append(incidence);
+            break;
+        case Private::PendingDeleted:
+            deleted.append(incidence);
+            break;
+        }
+        changes.erase(it);
+    }
+
+    if (added.isEmpty() && changed.isEmpty() && deleted.isEmpty()) {
+        return;
+    }
+
+    const QList<CalendarObserver *> observers = d->mObservers;
+    for (CalendarObserver *observer : observers) {
+        // An earlier observer may have unregistered it
+        if (d->mObservers.contains(observer)) {
+            KCALCORE_COUNT(ObserverCallbacks);
+            // The bulk callback is a separate interface, so that
+            // CalendarObserver keeps its vtable
+            CalendarBatchObserver *batchObserver = dynamic_cast<CalendarBatchObserver *>(observer);
+            if (batchObserver) {
+                batchObserver->calendarIncidencesChanged(added, changed, deleted, this);
+                continue;
+            }
+            for (const Incidence::Ptr &incidence : qAsConst(added)) {
+                observer->calendarIncidenceAdded(incidence);
+            }
+            for (const Incidence::Ptr &incidence : qAsConst(changed)) {
+                observer->calendarIncidenceChanged(incidence);
+            }
+            for (const Incidence::Ptr &incidence : qAsConst(deleted)) {
+                observer->calendarIncidenceDeleted(incidence);
+                observer->calendarIncidenceDeleted(incidence, this);
+            }
+        }
+    }
 }
 
 bool Calendar::batchAdding() const
@@ -1370,6 +1620,35 @@ bool Calendar::batchAdding() const
     return d->batchAddingInProgress;
 }
 
+void Calendar::setArenaAllocation(bool enable)
+{
+    if (enable == (d->mArena != nullptr)) {
+        return;
+    }
+
+    if (enable) {
+        d->mArena = new Arena;
+    } else {
+        // Incidences allocated from the arena keep their memory
+        delete d->mArena;
+        d->mArena = nullptr;
+    }
+}
+
+bool Calendar::arenaAllocation() const
+{
+    return d->mArena;
+}
+
+MemoryUsage Calendar::memoryUsage() const
+{
+    MemoryAccounting accounting;
+    accounting.addCalendar(*this);
+    // Subclasses add their own data structures
+    const_cast<Calendar *>(this)->virtual_hook(MemoryUsageHook, &accounting);
+    return accounting.usage();
+}
+
 void Calendar::setDeletionTracking(bool enable)
 {
     d->mDeletionTracking = enable;
@@ -1382,8 +1661,77 @@ bool Calendar::deletionTracking() const
 
 void Calendar::virtual_hook(int id, void *data)
 {
+    // Hooks not handled by a subclass keep the default behavior
     Q_UNUSED(id);
     Q_UNUSED(data);
-    Q_ASSERT(false);
 }
 
+
+//@cond PRIVATE
+void MemoryAccounting::addCalendar(const Calendar &calendar)
+{
+    const Calendar::Private *d = calendar.d;
+    const auto indexes = MemoryUsage::CalendarIndexes;
+    const auto maps = MemoryUsage::CalendarMaps;
+
+    const Incidence::List incidences = calendar.rawIncidences();
+    for (const Incidence::Ptr &incidence : incidences) {
+        addIncidence(*incidence);
+    }
+
+    add(MemoryUsage::IncidenceObjects, sizeof(Calendar::Private));
+    addCustomProperties(calendar, MemoryUsage::Strings);
+    addString(d->mProductId, MemoryUsage::Strings);
+    if (d->mOwner) {
+        addPerson(d->mOwner);
+    }
+    addVector(d->mTimeZones, indexes);
+    addSet(d->mTimeZoneIds, indexes);
+
+    // Notebooks and relations
+    addHash(d->mOrphans, maps);
+    addHash(d->mOrphanUids, maps);
+    addHash(d->mNotebookIncidences, maps);
+    for (auto it = d->mNotebookIncidences.cbegin(), end = d->mNotebookIncidences.cend(); it != end; ++it) {
+        addString(it.key(), maps);
+    }
+    addHash(d->mUidToNotebook, maps);
+    for (auto it = d->mUidToNotebook.cbegin(), end = d->mUidToNotebook.cend(); it != end; ++it) {
+        addString(it.key(), maps);
+        addString(it.value(), maps);
+    }
+    addHash(d->mNotebooks, maps);
+    addString(d->mDefaultNotebook, maps);
+    addMap(d->mIncidenceRelations, maps);
+    for (const Incidence::List &related : d->mIncidenceRelations) {
+        addVector(related, maps);
+    }
+
+    // Lookup indexes
+    addHash(d->mIndexedKeys, indexes);
+    for (const Calendar::Private::IndexedKeys &keys : d->mIndexedKeys) {
+        addString(keys.schedulingId, indexes);
+        addStringList(keys.categories, indexes);
+    }
+    addHash(d->mIncidencesBySchedulingId, indexes);
+    for (const Incidence::List &matches : d->mIncidencesBySchedulingId) {
+        addVector(matches, indexes);
+    }
+    addHash(d->mIncidencesByCategory, indexes);
+    for (const QSet<Incidence::Ptr> &set : d->mIncidencesByCategory) {
+        addSet(set, indexes);
+    }
+    addHash(d->mIncidencesByDuplicateKey, indexes);
+    addHash(d->mDuplicateKeys, indexes);
+    for (const Calendar::Private::DuplicateKey &key : d->mDuplicateKeys) {
+        addString(key.second, indexes);
+    }
+    addHash(d->mSharedPersons, indexes);
+    addHash(d->mSharedAttendees, indexes);
+    for (const QVector<QWeakPointer<Attendee> > &attendees : d->mSharedAttendees) {
+        addVector(attendees, indexes);
+    }
+    addVector(d->mPendingIncidences, indexes);
+    addHash(d->mPendingChanges, indexes);
+}
+//@endcond
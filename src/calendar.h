@@ -127,6 +127,20 @@ enum JournalSortField {
   as pointers so that changes to the returned Incidences are immediately
   visible in the Calendar.  Do <em>Not</em> attempt to 'delete' any Incidence
   object you get from Calendar -- use the delete...() methods.
+
+  <b>Concurrent Queries</b>:
+
+  As long as nobody modifies a MemoryCalendar or its incidences, the
+  following const methods may be called concurrently from several threads:
+  the lookups by uid, identifier, schedulingID, category and notebook
+  (incidence(), event(), todo(), journal(), instance(), instances(),
+  incidenceFromSchedulingID(), incidencesWithCategory(), incidences(const QString &),
+  notebook(), isVisible(), categories(), relations()), and the unsorted or
+  sorted lists of all incidences (rawEvents(), rawTodos(), rawJournals(),
+  rawIncidences(), deletedEvents() and friends).
+  Queries that expand recurrences, i.e. the date and date range queries and
+  alarms(), fill caches of the recurrence rules and must not run concurrently.
+  To query while the calendar is being modified, use MemoryCalendar::snapshot().
 */
 class KCALCORE_EXPORT Calendar : public QObject, public CustomProperties,
     public IncidenceBase::IncidenceObserver
@@ -309,16 +323,32 @@ public:
     /**
       Returns a list of all categories used by Incidences in this Calendar.
 
-      @return a QStringList containing all the categories.
+      @return a QStringList containing all the categories, sorted by
+      QString::operator<(). Before 5.8 the order was unspecified.
     */
     QStringList categories() const;
 
+    /**
+      Returns all Incidences in this Calendar which have the given category.
+
+      @param category is the category to look for.
+
+      @return the list of Incidences with category @p category, in no
+      particular order.
+      @see categories()
+      @since 5.8
+    */
+    Incidence::List incidencesWithCategory(const QString &category) const;
+
     // Incidence Specific Methods //
 
     /**
        Call this to tell the calendar that you're adding a batch of incidences.
        So it doesn't, for example, ask the destination for each incidence.
 
+       Until endBatchAdding() is called, the registered observers are not
+       notified about added, changed and deleted incidences.
+
         @see endBatchAdding()
     */
     virtual void startBatchAdding();
@@ -326,6 +356,11 @@ public:
     /**
        Tells the Calendar that you stoped adding a batch of incidences.
 
+       The observers are then notified about all changes made during the
+       batch, each CalendarBatchObserver with a single
+       CalendarBatchObserver::calendarIncidencesChanged() call.
+       Reimplementations must call the base implementation.
+
         @see startBatchAdding()
      */
     virtual void endBatchAdding();
@@ -335,6 +370,38 @@ public:
     */
     bool batchAdding() const;
 
+    /**
+      Sets whether the incidences loaded into this calendar by ICalFormat
+      are allocated in large blocks owned by the calendar, rather than one by
+      one from the heap. This makes loading and freeing large calendars
+      faster and fragments the heap less; a block is only freed once none of
+      the incidences in it is used anymore.
+
+      Default is false.
+      @see arenaAllocation()
+      @since 5.8
+    */
+    void setArenaAllocation(bool enable);
+
+    /**
+      Returns whether loaded incidences are allocated in blocks owned by the
+      calendar.
+      @see setArenaAllocation()
+      @since 5.8
+    */
+    bool arenaAllocation() const;
+
+    /**
+      Returns an estimate of the memory retained by this calendar: its
+      incidences with everything they own (see IncidenceBase::memoryUsage()),
+      its lookup indexes and its notebook and relation maps.
+
+      For a MemoryCalendar this includes the deleted incidences kept for
+      deletion tracking.
+      @since 5.8
+    */
+    MemoryUsage memoryUsage() const;
+
     /**
       Inserts an Incidence into the calendar.
 
@@ -346,6 +413,23 @@ public:
     */
     virtual bool addIncidence(const Incidence::Ptr &incidence);
 
+    /**
+      Inserts a list of Incidences into the calendar.
+
+      The observers are notified once for all of them, see
+      startBatchAdding(). Each incidence is added with addEvent(), addTodo()
+      or addJournal(). A MemoryCalendar, but not a subclass of it, inserts
+      them all at once instead.
+
+      @param incidences is the list of Incidences to insert.
+
+      @return true if all Incidences were successfully inserted; false otherwise.
+
+      @see addIncidence()
+      @since 5.8
+    */
+    bool addIncidences(const Incidence::List &incidences);
+
     /**
       Removes an Incidence from the calendar.
 
@@ -506,6 +590,9 @@ public:
     /**
       List all possible duplicate incidences.
 
+      Since 5.8 each incidence is listed at most once, also when setNotebook()
+      was called several times for it. Before, it was listed once per call.
+
       @param incidence is the incidence to check.
       @return a list of duplicate incidences.
     */
@@ -547,14 +634,16 @@ public:
 
       @param sid is a unique scheduling identifier string.
 
-      @return a pointer to the Incidence.
+      @return a pointer to the Incidence, the first one of
+      incidencesFromSchedulingID() if there are several.
       A null pointer is returned if no such Incidence exists.
     */
     virtual Incidence::Ptr incidenceFromSchedulingID(const QString &sid) const;
 
     /**
       Searches all events and todos for an incidence with this
-      scheduling identifier. Returns a list of matching results.
+      scheduling identifier. Returns a list of matching results, in the
+      order they were added or got this scheduling identifier.
 
       @param sid is a unique scheduling identifier string.
      */
@@ -647,6 +736,28 @@ public:
     static Event::List sortEvents(const Event::List &eventList,
                                   EventSortField sortField,
                                   SortDirection sortDirection);
+
+    /**
+      Sort a list of Events and return a page of the result.
+
+      Only the Events up to the end of the page are sorted, so getting the
+      first few items of a large list is much cheaper than a full sort.
+
+      @param eventList is a pointer to a list of Events.
+      @param sortField specifies the EventSortField.
+      @param sortDirection specifies the SortDirection.
+      @param offset is the number of sorted Events to skip.
+      @param limit is the maximum number of Events to return, or -1 for all.
+
+      @return at most @p limit Events, starting at position @p offset of
+      the list sorted as specified.
+      @since 5.8
+    */
+    static Event::List sortEvents(const Event::List &eventList,
+                                  EventSortField sortField,
+                                  SortDirection sortDirection,
+                                  int offset, int limit);
+
     /**
       Returns a sorted, filtered list of all Events for this Calendar.
 
@@ -658,6 +769,23 @@ public:
     virtual Event::List events(EventSortField sortField = EventSortUnsorted,
                                SortDirection sortDirection = SortDirectionAscending) const;
 
+    /**
+      Returns a page of the sorted, filtered list of all Events for this
+      Calendar.
+
+      @param sortField specifies the EventSortField.
+      @param sortDirection specifies the SortDirection.
+      @param offset is the number of sorted Events to skip.
+      @param limit is the maximum number of Events to return, or -1 for all.
+
+      @return at most @p limit filtered Events, starting at position @p offset
+      of the list sorted as specified.
+      @see sortEvents()
+      @since 5.8
+    */
+    Event::List events(EventSortField sortField, SortDirection sortDirection,
+                       int offset, int limit) const;
+
     /**
       Returns a filtered list of all Events which occur on the given timestamp.
 
@@ -861,6 +989,27 @@ public:
                                 TodoSortField sortField,
                                 SortDirection sortDirection);
 
+    /**
+      Sort a list of Todos and return a page of the result.
+
+      Only the Todos up to the end of the page are sorted, so getting the
+      first few items of a large list is much cheaper than a full sort.
+
+      @param todoList is a pointer to a list of Todos.
+      @param sortField specifies the TodoSortField.
+      @param sortDirection specifies the SortDirection.
+      @param offset is the number of sorted Todos to skip.
+      @param limit is the maximum number of Todos to return, or -1 for all.
+
+      @return at most @p limit Todos, starting at position @p offset of
+      the list sorted as specified.
+      @since 5.8
+    */
+    static Todo::List sortTodos(const Todo::List &todoList,
+                                TodoSortField sortField,
+                                SortDirection sortDirection,
+                                int offset, int limit);
+
     /**
       Returns a sorted, filtered list of all Todos for this Calendar.
 
@@ -872,6 +1021,23 @@ public:
     virtual Todo::List todos(TodoSortField sortField = TodoSortUnsorted,
                              SortDirection sortDirection = SortDirectionAscending) const;
 
+    /**
+      Returns a page of the sorted, filtered list of all Todos for this
+      Calendar, e.g. the next 50 Todos by due date.
+
+      @param sortField specifies the TodoSortField.
+      @param sortDirection specifies the SortDirection.
+      @param offset is the number of sorted Todos to skip.
+      @param limit is the maximum number of Todos to return, or -1 for all.
+
+      @return at most @p limit filtered Todos, starting at position @p offset
+      of the list sorted as specified.
+      @see sortTodos()
+      @since 5.8
+    */
+    Todo::List todos(TodoSortField sortField, SortDirection sortDirection,
+                     int offset, int limit) const;
+
     /**
       Returns a filtered list of all Todos which are due on the specified date.
 
@@ -1268,6 +1434,50 @@ public:
         virtual void calendarIncidenceAdditionCanceled(const Incidence::Ptr &incidence);
     };
 
+    /**
+      @class CalendarBatchObserver
+
+      An optional interface for a CalendarObserver that handles all
+      changes made while batch adding at once.
+
+      A registered CalendarObserver that also inherits this class is notified
+      with a single calendarIncidencesChanged() call when a batch ends.
+      Other observers get calendarIncidenceAdded(), calendarIncidenceChanged()
+      and calendarIncidenceDeleted() calls for each incidence instead.
+
+      @see Calendar::startBatchAdding(), Calendar::endBatchAdding()
+      @since 5.8
+    */
+    class KCALCORE_EXPORT CalendarBatchObserver //krazy:exclude=dpointer
+    {
+    public:
+        /**
+          Destructor.
+        */
+        virtual ~CalendarBatchObserver();
+
+        /**
+          Notify the Observer about the changes made to a Calendar while
+          batch adding, once the batch has ended.
+
+          Each incidence appears in at most one of the lists, with its net
+          change: an incidence that was added and then modified is only
+          reported as added, one that was added and deleted again is not
+          reported at all. calendarIncidenceAboutToBeDeleted() is still called
+          immediately when an incidence is about to be deleted, unless it
+          was added in the same batch.
+
+          @param added the incidences that were inserted
+          @param changed the incidences that were modified
+          @param deleted the incidences that were removed
+          @param calendar is a pointer to the Calendar that was modified
+        */
+        virtual void calendarIncidencesChanged(const Incidence::List &added,
+                                               const Incidence::List &changed,
+                                               const Incidence::List &deleted,
+                                               const Calendar *calendar) = 0;
+    };
+
     /**
       Registers an Observer for this Calendar.
 
@@ -1415,6 +1625,7 @@ private:
     friend class ICalFormat;
 
     //@cond PRIVATE
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
@@ -25,11 +25,29 @@
 #ifndef KCALCORE_CALENDAR_P_H_
 #define KCALCORE_CALENDAR_P_H_
 
+#include "arena_p.h"
 #include "calendar.h"
 #include "calfilter.h"
 
+#include <QPair>
+#include <QSet>
+
 namespace KCalCore {
 
+//@cond PRIVATE
+// Ids of Calendar::virtual_hook(), which extends Calendar without adding
+// virtual methods. Unknown ids are passed on to the base class.
+enum CalendarVirtualHook {
+    AddIncidencesHook, // data is an AddIncidencesHookData
+    MemoryUsageHook    // data is the MemoryAccounting to add to
+};
+
+struct AddIncidencesHookData {
+    const Incidence::List *incidences;
+    bool handled; // set by the subclass if it inserted the incidences
+    bool success;
+};
+//@endcond
 
 /**
   Private class that helps to provide binary compatibility between releases.
@@ -62,13 +80,48 @@ public:
             delete mFilter;
         }
         delete mDefaultFilter;
+        delete mArena;
     }
     QTimeZone timeZoneIdSpec(const QByteArray &timeZoneId);
 
+    // Keep the lookup indexes below in sync with the calendar's incidences.
+    // Called from the notify functions, regardless of mObserversEnabled.
+    void indexIncidence(const Incidence::Ptr &incidence);
+    void reindexIncidence(const Incidence::Ptr &incidence);
+    void unindexIncidence(const Incidence::Ptr &incidence);
+    void removeFromSchedulingIdIndex(const Incidence::Ptr &incidence,
+                                     const QString &schedulingId);
+    void removeFromCategoryIndex(const Incidence::Ptr &incidence,
+                                 const QStringList &categories);
+
+    // Makes the organizer and the attendees of a newly added incidence share
+    // their data with equal ones of the other incidences
+    void shareAttendees(const Incidence::Ptr &incidence);
+    // Drops the entries of the persons and attendees no longer in use
+    void purgeSharedAttendees();
+
+    // The duplicates index covers the incidences associated to a notebook,
+    // i.e. those in mNotebookIncidences
+    typedef QPair<qint64, QString> DuplicateKey;
+    static DuplicateKey duplicateKey(const Incidence::Ptr &incidence);
+    void addToDuplicateIndex(const Incidence::Ptr &incidence);
+    void removeFromDuplicateIndex(const Incidence::Ptr &incidence);
+
+    // Notifications are deferred while batch adding and delivered by
+    // endBatchAdding(), one change per incidence
+    enum PendingChange {
+        PendingAdded,
+        PendingChanged,
+        PendingDeleted
+    };
+    void deferNotification(const Incidence::Ptr &incidence, PendingChange change);
+    bool isPendingAddition(const Incidence::Ptr &incidence) const;
+
     QString mProductId;
     Person::Ptr mOwner;
     QTimeZone mTimeZone;
     QVector<QTimeZone> mTimeZones;
+    QSet<QByteArray> mTimeZoneIds; // ids of mTimeZones
     bool mModified = false;
     bool mNewObserver = false;
     bool mObserversEnabled = false;
@@ -85,11 +138,37 @@ public:
     QMultiHash<QString, Incidence::Ptr > mNotebookIncidences;
     QHash<QString, QString> mUidToNotebook;
     QHash<QString, bool> mNotebooks; // name to visibility
-    QHash<Incidence::Ptr, bool> mIncidenceVisibility; // incidence -> visibility
     QString mDefaultNotebook; // uid of default notebook
     QMap<QString, Incidence::List > mIncidenceRelations;
+    // The keys each incidence is indexed under, so the old keys can be
+    // removed when the incidence changes
+    struct IndexedKeys {
+        QString schedulingId;
+        QStringList categories;
+    };
+    QHash<Incidence::Ptr, IndexedKeys> mIndexedKeys;
+    // schedulingID -> incidences, in the order they got it; a recurring series
+    // and its exceptions usually share one
+    QHash<QString, Incidence::List> mIncidencesBySchedulingId;
+    // category -> incidences using it; a category is removed with its last incidence
+    QHash<QString, QSet<Incidence::Ptr> > mIncidencesByCategory;
+    // (dtStart, summary) -> incidences, see duplicates()
+    QMultiHash<DuplicateKey, Incidence::Ptr> mIncidencesByDuplicateKey;
+    QHash<Incidence::Ptr, DuplicateKey> mDuplicateKeys;
+    // The persons and attendees whose data shareAttendees() shares, by name
+    // and email; every attendee with a different status etc. is a separate
+    // entry. Weak, so the data goes away with the last incidence using it.
+    QHash<QPair<QString, QString>, QWeakPointer<Person> > mSharedPersons;
+    QHash<QPair<QString, QString>, QVector<QWeakPointer<Attendee> > > mSharedAttendees;
+    int mSharedPurgeLimit = 1024;
     bool batchAddingInProgress = false;
+    // Incidences with deferred notifications, in the order of their first
+    // notification; an incidence may appear more than once
+    QVector<Incidence::Ptr> mPendingIncidences;
+    QHash<Incidence::Ptr, PendingChange> mPendingChanges;
     bool mDeletionTracking = false;
+    // Where ICalFormat allocates the incidences it loads, if set
+    Arena *mArena = nullptr;
 };
 
 }
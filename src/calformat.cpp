@@ -53,6 +53,7 @@ public:
     static QString mProductId;   // PRODID string to write to calendar files
     QString mLoadedProductId;    // PRODID string loaded from calendar file
     Exception *mException = nullptr;
+    StringPool::Ptr mStringPool;
 };
 
 QString CalFormat::Private::mApplication = QStringLiteral("libkcal");
@@ -88,6 +89,16 @@ Exception *CalFormat::exception() const
     return d->mException;
 }
 
+void CalFormat::setStringPool(const StringPool::Ptr &pool)
+{
+    d->mStringPool = pool;
+}
+
+StringPool::Ptr CalFormat::stringPool() const
+{
+    return d->mStringPool;
+}
+
 void CalFormat::setApplication(const QString &application,
                                const QString &productID)
 {
@@ -31,6 +31,7 @@
 
 #include "kcalcore_export.h"
 #include "calendar.h"
+#include "stringpool.h"
 
 #include <QString>
 
@@ -173,6 +174,24 @@ public:
     */
     void setException(Exception *error);
 
+    /**
+      Sets the pool used to intern strings that tend to repeat in a
+      calendar, like categories and the names and email addresses of
+      organizers and attendees, while reading. By default no pool is used.
+
+      @param pool is the pool to use, or a null pointer to not intern strings.
+      @see stringPool()
+      @since 5.8
+    */
+    void setStringPool(const StringPool::Ptr &pool);
+
+    /**
+      Returns the pool used to intern strings while reading.
+      @see setStringPool()
+      @since 5.8
+    */
+    StringPool::Ptr stringPool() const;
+
 protected:
     /**
       Sets the PRODID string loaded from calendar file.
@@ -30,8 +30,11 @@
 */
 
 #include "customproperties.h"
+#include "memoryaccounting_p.h"
 
+#include <QAtomicInt>
 #include <QDataStream>
+#include <QMutex>
 #include "kcalcore_debug.h"
 
 using namespace KCalCore;
@@ -39,11 +42,34 @@ using namespace KCalCore;
 //@cond PRIVATE
 static bool checkName(const QByteArray &name);
 
+// Guards the decoding of lazily decoded properties
+Q_GLOBAL_STATIC(QMutex, sDecodingMutex)
+
 class Q_DECL_HIDDEN CustomProperties::Private
 {
 public:
     bool operator==(const Private &other) const;
+
+    // Decodes the properties still held in UTF-8. All of them at once, so
+    // that concurrent readers of a published incidence only ever see
+    // mProperties complete or wait for it.
+    void decode()
+    {
+        if (mUndecoded.loadAcquire()) {
+            QMutexLocker locker(sDecodingMutex());
+            if (mUndecoded.load()) {
+                for (auto it = mRawProperties.cbegin(), end = mRawProperties.cend(); it != end; ++it) {
+                    mProperties.insert(it.key(), QString::fromUtf8(it.value()));
+                }
+                mRawProperties.clear();
+                mUndecoded.storeRelease(0);
+            }
+        }
+    }
+
     QMap<QByteArray, QString> mProperties;   // custom calendar properties
+    QMap<QByteArray, QByteArray> mRawProperties; // UTF-8 custom properties, until decode()
+    QAtomicInt mUndecoded; // 1 while mRawProperties may hold properties
     QMap<QByteArray, QString> mPropertyParameters;
 
     // Volatile properties are not written back to the serialized format and are not compared in operator==
@@ -88,8 +114,11 @@ CustomProperties::CustomProperties()
 }
 
 CustomProperties::CustomProperties(const CustomProperties &cp)
-    : d(new Private(*cp.d))
+    : d(new Private)
 {
+    // Decoded first, cp may be decoded by another thread meanwhile
+    cp.d->decode();
+    *d = *cp.d;
 }
 
 CustomProperties &CustomProperties::operator=(const CustomProperties &other)
@@ -99,6 +128,7 @@ CustomProperties &CustomProperties::operator=(const CustomProperties &other)
         return *this;
     }
 
+    other.d->decode();
     *d = *other.d;
     return *this;
 }
@@ -110,6 +140,8 @@ CustomProperties::~CustomProperties()
 
 bool CustomProperties::operator==(const CustomProperties &other) const
 {
+    d->decode();
+    other.d->decode();
     return *d == *other.d;
 }
 
@@ -128,6 +160,7 @@ void CustomProperties::setCustomProperty(const QByteArray &app, const QByteArray
     if (d->isVolatileProperty(QLatin1String(property)))  {
         d->mVolatileProperties[property] = value;
     } else {
+        d->mRawProperties.remove(property);
         d->mProperties[property] = value;
     }
 
@@ -160,12 +193,28 @@ void CustomProperties::setNonKDECustomProperty(const QByteArray &name, const QSt
         return;
     }
     customPropertyUpdate();
+    d->mRawProperties.remove(name);
     d->mProperties[name] = value;
     d->mPropertyParameters[name] = parameters;
     customPropertyUpdated();
 }
+
+void CustomProperties::setNonKDECustomPropertyUtf8(const QByteArray &name, const QByteArray &value,
+        const QString &parameters)
+{
+    if (value.isNull() || !checkName(name)) {
+        return;
+    }
+    customPropertyUpdate();
+    d->mProperties.remove(name);
+    d->mRawProperties[name] = value;
+    d->mUndecoded.store(1);
+    d->mPropertyParameters[name] = parameters;
+    customPropertyUpdated();
+}
 void CustomProperties::removeNonKDECustomProperty(const QByteArray &name)
 {
+    d->decode();
     if (d->mProperties.contains(name)) {
         customPropertyUpdate();
         d->mProperties.remove(name);
@@ -180,6 +229,7 @@ void CustomProperties::removeNonKDECustomProperty(const QByteArray &name)
 
 QString CustomProperties::nonKDECustomProperty(const QByteArray &name) const
 {
+    d->decode();
     return d->isVolatileProperty(QLatin1String(name)) ? d->mVolatileProperties.value(name) : d->mProperties.value(name);
 }
 
@@ -190,6 +240,7 @@ QString CustomProperties::nonKDECustomPropertyParameters(const QByteArray &name)
 
 void CustomProperties::setCustomProperties(const QMap<QByteArray, QString> &properties)
 {
+    d->decode();
     bool changed = false;
     for (QMap<QByteArray, QString>::ConstIterator it = properties.begin();
             it != properties.end();  ++it) {
@@ -213,6 +264,7 @@ void CustomProperties::setCustomProperties(const QMap<QByteArray, QString> &prop
 
 QMap<QByteArray, QString> CustomProperties::customProperties() const
 {
+    d->decode();
     QMap<QByteArray, QString> result;
     result.unite(d->mProperties);
     result.unite(d->mVolatileProperties);
@@ -255,6 +307,7 @@ bool checkName(const QByteArray &name)
 QDataStream &KCalCore::operator<<(QDataStream &stream,
                                   const KCalCore::CustomProperties &properties)
 {
+    properties.d->decode();
     return stream << properties.d->mProperties
            << properties.d->mPropertyParameters;
 }
@@ -263,7 +316,30 @@ QDataStream &KCalCore::operator>>(QDataStream &stream,
                                   KCalCore::CustomProperties &properties)
 {
     properties.d->mVolatileProperties.clear();
+    properties.d->mRawProperties.clear();
+    properties.d->mUndecoded.store(0);
     return stream >> properties.d->mProperties
            >> properties.d->mPropertyParameters;
 }
 
+
+//@cond PRIVATE
+void MemoryAccounting::addCustomProperties(const CustomProperties &properties,
+                                           MemoryUsage::Category category)
+{
+    const CustomProperties::Private *d = properties.d;
+    add(category, sizeof(CustomProperties::Private));
+    for (const QMap<QByteArray, QString> *map : { &d->mProperties, &d->mPropertyParameters, &d->mVolatileProperties }) {
+        addMap(*map, category);
+        for (auto it = map->cbegin(), end = map->cend(); it != end; ++it) {
+            addByteArray(it.key(), category);
+            addString(it.value(), category);
+        }
+    }
+    addMap(d->mRawProperties, category);
+    for (auto it = d->mRawProperties.cbegin(), end = d->mRawProperties.cend(); it != end; ++it) {
+        addByteArray(it.key(), category);
+        addByteArray(it.value(), category);
+    }
+}
+//@endcond
@@ -37,6 +37,9 @@
 namespace KCalCore
 {
 
+class ICalFormatImpl;
+class MemoryAccounting;
+
 /**
   @brief
   A class to manage custom calendar properties.
@@ -199,6 +202,12 @@ protected:
     virtual void customPropertyUpdated();
 private:
     //@cond PRIVATE
+    // Sets a non-KDE custom property given in UTF-8, decoded on first access
+    void setNonKDECustomPropertyUtf8(const QByteArray &name, const QByteArray &value,
+                                     const QString &parameters);
+
+    friend class ICalFormatImpl;
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
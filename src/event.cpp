@@ -30,6 +30,8 @@
 */
 
 #include "event.h"
+#include "arena_p.h"
+#include "memoryaccounting_p.h"
 #include "visitor.h"
 #include "utils.h"
 #include "kcalcore_debug.h"
@@ -43,7 +45,7 @@ using namespace KCalCore;
   @internal
 */
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::Event::Private
+class Q_DECL_HIDDEN KCalCore::Event::Private : public ArenaAllocated
 {
 public:
     Private()
@@ -362,3 +364,11 @@ bool Event::supportsGroupwareCommunication() const
 {
     return true;
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addEventData(const Event &event)
+{
+    add(MemoryUsage::IncidenceObjects, sizeof(Event) + sizeof(Event::Private));
+    addIncidenceData(event);
+}
+//@endcond
@@ -257,6 +257,7 @@ private:
     void deserialize(QDataStream &in);
 
     //@cond PRIVATE
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
@@ -31,6 +31,7 @@
   @author Reinhold Kainhofer \<reinhold@kainhofer.com\>
 */
 #include "freebusy.h"
+#include "instrumentation_p.h"
 #include "visitor.h"
 #include "utils.h"
 
@@ -107,6 +108,7 @@ FreeBusy::FreeBusy(const Event::List &events, const QDateTime &start, const QDat
 void FreeBusy::Private::init(const Event::List &eventList,
                              const QDateTime &start, const QDateTime &end)
 {
+    KCALCORE_TIME(FreeBusyInitTimer);
     int extraDays, i, x, duration;
     duration = start.daysTo(end);
     QDate day;
@@ -31,6 +31,7 @@
 #include "icalformat.h"
 #include "icalformat_p.h"
 #include "icaltimezones_p.h"
+#include "instrumentation_p.h"
 #include "freebusy.h"
 #include "memorycalendar.h"
 #include "kcalcore_debug.h"
@@ -64,6 +65,8 @@ public:
     }
     ICalFormatImpl *mImpl = nullptr;
     QTimeZone mTimeZone;
+    bool mLazyDecoding = false;
+    AttachmentStore::Ptr mAttachmentStore;
 };
 //@endcond
 
@@ -188,6 +191,7 @@ bool ICalFormat::fromRawString(const Calendar::Ptr &cal, const QByteArray &strin
                                bool deleted, const QString &notebook)
 {
     Q_UNUSED(notebook);
+    KCALCORE_TIME(LoadTimer);
     // Get first VCALENDAR component.
     // TODO: Handle more than one VCALENDAR or non-VCALENDAR top components
     icalcomponent *calendar;
@@ -202,6 +206,9 @@ bool ICalFormat::fromRawString(const Calendar::Ptr &cal, const QByteArray &strin
 
     bool success = true;
 
+    // Allocate the loaded incidences from the calendar's arena, if any
+    Arena::Scope arenaScope(cal->d->mArena);
+
     if (icalcomponent_isa(calendar) == ICAL_XROOT_COMPONENT) {
         icalcomponent *comp;
         for (comp = icalcomponent_get_first_component(calendar, ICAL_VCALENDAR_COMPONENT);
@@ -252,6 +259,7 @@ Incidence::Ptr ICalFormat::fromString(const QString &string)
 QString ICalFormat::toString(const Calendar::Ptr &cal,
                              const QString &notebook, bool deleted)
 {
+    KCALCORE_TIME(SaveTimer);
     icalcomponent *calendar = d->mImpl->createCalendarComponent(cal);
     icalcomponent *component;
 
@@ -666,6 +674,26 @@ QByteArray ICalFormat::timeZoneId() const
     return d->mTimeZone.id();
 }
 
+void ICalFormat::setLazyDecoding(bool lazy)
+{
+    d->mLazyDecoding = lazy;
+}
+
+bool ICalFormat::lazyDecoding() const
+{
+    return d->mLazyDecoding;
+}
+
+void ICalFormat::setAttachmentStore(const AttachmentStore::Ptr &store)
+{
+    d->mAttachmentStore = store;
+}
+
+AttachmentStore::Ptr ICalFormat::attachmentStore() const
+{
+    return d->mAttachmentStore;
+}
+
 void ICalFormat::virtual_hook(int id, void *data)
 {
     Q_UNUSED(id);
@@ -224,6 +224,50 @@ public:
     */
     QByteArray timeZoneId() const;
 
+    /**
+      Sets whether properties which are expensive to convert and seldom used
+      are decoded lazily when reading. The descriptions and comments of the
+      incidences and their custom properties then keep the UTF-8 text of the
+      iCalendar data and are only converted when first accessed, which makes
+      loading faster and uses less memory for calendars with large
+      descriptions.
+
+      The conversion on first access is thread-safe, so incidences read
+      this way can still be queried concurrently, e.g. through a
+      MemoryCalendar::Snapshot.
+
+      Inline attachments are always kept base64 encoded until
+      Attachment::decodedData() is called.
+
+      Default is false.
+      @see lazyDecoding()
+      @since 5.8
+    */
+    void setLazyDecoding(bool lazy);
+
+    /**
+      Returns whether seldom used properties are decoded lazily.
+      @see setLazyDecoding()
+      @since 5.8
+    */
+    bool lazyDecoding() const;
+
+    /**
+      Sets the store the payloads of binary attachments read are moved to,
+      if they are at least AttachmentStore::threshold() bytes large. With a
+      null @p store, attachments are kept in memory, which is the default.
+      @see attachmentStore(), Attachment::moveToStore()
+      @since 5.8
+    */
+    void setAttachmentStore(const AttachmentStore::Ptr &store);
+
+    /**
+      Returns the store the payloads of large attachments are moved to.
+      @see setAttachmentStore()
+      @since 5.8
+    */
+    AttachmentStore::Ptr attachmentStore() const;
+
 protected:
     /**
       @copydoc
@@ -41,6 +41,7 @@
 #include "icalformat.h"
 #include "icaltimezones_p.h"
 #include "incidencebase.h"
+#include "instrumentation_p.h"
 #include "journal.h"
 #include "memorycalendar.h"
 #include "todo.h"
@@ -50,6 +51,10 @@
 #include "kcalcore_debug.h"
 
 #include <QFile>
+#include <QPair>
+#include <QSet>
+
+#include <limits>
 
 using namespace KCalCore;
 
@@ -160,6 +165,8 @@ public:
     void readIncidenceBase(icalcomponent *parent, const IncidenceBase::Ptr &);
     void writeCustomProperties(icalcomponent *parent, CustomProperties *);
     void readCustomProperties(icalcomponent *parent, CustomProperties *);
+    // Interns @p string in the pool of mParent, if any
+    QString intern(const QString &string) const;
 
     ICalFormatImpl *mImpl = nullptr;
     ICalFormat *mParent = nullptr;
@@ -168,6 +175,12 @@ public:
     Todo::List  mTodosRelate;         // todos with relations
     Compat *mCompat = nullptr;
 };
+
+QString ICalFormatImpl::Private::intern(const QString &string) const
+{
+    const StringPool::Ptr pool = mParent->stringPool();
+    return pool ? pool->intern(string) : string;
+}
 //@endcond
 
 inline icaltimetype ICalFormatImpl::writeICalUtcDateTime(const QDateTime &dt, bool dayOnly)
@@ -1539,18 +1552,18 @@ Attendee::Ptr ICalFormatImpl::readAttendee(icalproperty *attendee)
         p = icalproperty_get_next_parameter(attendee, ICAL_X_PARAMETER);
     }
 
-    Attendee::Ptr a(new Attendee(name, email, rsvp, status, role, uid));
+    Attendee::Ptr a(new Attendee(d->intern(name), d->intern(email), rsvp, status, role, uid));
     a->setCuType(cuType);
     a->customProperties().setCustomProperties(custom);
 
     p = icalproperty_get_first_parameter(attendee, ICAL_DELEGATEDTO_PARAMETER);
     if (p) {
-        a->setDelegate(QLatin1String(icalparameter_get_delegatedto(p)));
+        a->setDelegate(d->intern(QLatin1String(icalparameter_get_delegatedto(p))));
     }
 
     p = icalproperty_get_first_parameter(attendee, ICAL_DELEGATEDFROM_PARAMETER);
     if (p) {
-        a->setDelegator(QLatin1String(icalparameter_get_delegatedfrom(p)));
+        a->setDelegator(d->intern(QLatin1String(icalparameter_get_delegatedfrom(p))));
     }
 
     return a;
@@ -1569,7 +1582,7 @@ Person::Ptr ICalFormatImpl::readOrganizer(icalproperty *organizer)
     if (p) {
         cn = QString::fromUtf8(icalparameter_get_cn(p));
     }
-    Person::Ptr org(new Person(cn, email));
+    Person::Ptr org(new Person(d->intern(cn), d->intern(email)));
     // TODO: Treat sent-by, dir and language here, too
     return org;
 }
@@ -1613,6 +1626,13 @@ Attachment::Ptr ICalFormatImpl::readAttachment(icalproperty *attach)
         break;
     }
 
+    if (attachment && attachment->isBinary()) {
+        const AttachmentStore::Ptr store = d->mParent->attachmentStore();
+        if (store && attachment->size() >= store->threshold()) {
+            attachment->moveToStore(store);
+        }
+    }
+
     if (attachment) {
         icalparameter *p =
             icalproperty_get_first_parameter(attach, ICAL_FMTTYPE_PARAMETER);
@@ -1695,14 +1715,15 @@ void ICalFormatImpl::readIncidence(icalcomponent *parent, const Incidence::Ptr &
             break;
 
         case ICAL_DESCRIPTION_PROPERTY: { // description
-            QString textStr = QString::fromUtf8(icalproperty_get_description(p));
-            if (!textStr.isEmpty()) {
+            const char *description = icalproperty_get_description(p);
+            if (description && *description) {
                 QString valStr = QString::fromUtf8(
                                      icalproperty_get_parameter_as_string(p, "X-KDE-TEXTFORMAT"));
-                if (!valStr.compare(QStringLiteral("HTML"), Qt::CaseInsensitive)) {
-                    incidence->setDescription(textStr, true);
+                const bool isRich = !valStr.compare(QStringLiteral("HTML"), Qt::CaseInsensitive);
+                if (d->mParent->lazyDecoding()) {
+                    incidence->setDescriptionUtf8(QByteArray(description), isRich);
                 } else {
-                    incidence->setDescription(textStr, false);
+                    incidence->setDescription(QString::fromUtf8(description), isRich);
                 }
             }
         }
@@ -1811,7 +1832,7 @@ void ICalFormatImpl::readIncidence(icalcomponent *parent, const Incidence::Ptr &
             for (const QString &cat : lstVal) {
                 // ensure no duplicates
                 if (!categories.contains(cat)) {
-                    categories.append(cat);
+                    categories.append(d->intern(cat));
                 }
             }
             break;
@@ -1955,8 +1976,12 @@ void ICalFormatImpl::Private::readIncidenceBase(icalcomponent *parent,
             break;
 
         case ICAL_COMMENT_PROPERTY:
-            incidenceBase->addComment(
-                QString::fromUtf8(icalproperty_get_comment(p)));
+            if (mParent->lazyDecoding()) {
+                incidenceBase->addCommentUtf8(QByteArray(icalproperty_get_comment(p)));
+            } else {
+                incidenceBase->addComment(
+                    QString::fromUtf8(icalproperty_get_comment(p)));
+            }
             break;
 
         case ICAL_CONTACT_PROPERTY:
@@ -1996,18 +2021,27 @@ void ICalFormatImpl::Private::readIncidenceBase(icalcomponent *parent,
 void ICalFormatImpl::Private::readCustomProperties(icalcomponent *parent,
         CustomProperties *properties)
 {
-    QByteArray property;
-    QString value, parameters;
+    QByteArray property, value;
+    QString parameters;
     icalproperty *p = icalcomponent_get_first_property(parent, ICAL_X_PROPERTY);
     icalparameter *param = nullptr;
+    // Values are kept in UTF-8 and decoded by properties if lazy decoding is on
+    auto setProperty = [this, properties](const QByteArray &property, const QByteArray &value,
+                                          const QString &parameters) {
+        if (mParent->lazyDecoding()) {
+            properties->setNonKDECustomPropertyUtf8(property, value, parameters);
+        } else {
+            properties->setNonKDECustomProperty(property, QString::fromUtf8(value), parameters);
+        }
+    };
 
     while (p) {
-        QString nvalue = QString::fromUtf8(icalproperty_get_x(p));
+        QByteArray nvalue(icalproperty_get_x(p));
         if (nvalue.isEmpty()) {
             icalvalue *value = icalproperty_get_value(p);
             if (icalvalue_isa(value) == ICAL_TEXT_VALUE) {
                 // Calling icalvalue_get_text( value ) on a datetime value crashes.
-                nvalue = QString::fromUtf8(icalvalue_get_text(value));
+                nvalue = QByteArray(icalvalue_get_text(value));
             } else {
                 p = icalcomponent_get_next_property(parent, ICAL_X_PROPERTY);
                 continue;
@@ -2018,7 +2052,7 @@ void ICalFormatImpl::Private::readCustomProperties(icalcomponent *parent,
         if (property != nproperty) {
             // New property
             if (!property.isEmpty()) {
-                properties->setNonKDECustomProperty(property, value, parameters);
+                setProperty(property, value, parameters);
             }
             property = name;
             value = nvalue;
@@ -2032,12 +2066,12 @@ void ICalFormatImpl::Private::readCustomProperties(icalcomponent *parent,
             }
             parameters = parametervalues.join(QLatin1Char(';'));
         } else {
-            value = value.append(QLatin1Char(',')).append(nvalue);
+            value = value.append(',').append(nvalue);
         }
         p = icalcomponent_get_next_property(parent, ICAL_X_PROPERTY);
     }
     if (!property.isEmpty()) {
-        properties->setNonKDECustomProperty(property, value, parameters);
+        setProperty(property, value, parameters);
     }
 }
 //@endcond
@@ -2354,6 +2388,7 @@ icaltimetype ICalFormatImpl::writeICalDate(const QDate &date)
 
 icaltimetype ICalFormatImpl::writeICalDateTime(const QDateTime &datetime, bool dateOnly)
 {
+    KCALCORE_COUNT(DateTimeConversions);
     icaltimetype t = icaltime_null_time();
 
     t.year = datetime.date().year();
@@ -2467,6 +2502,7 @@ icalproperty *ICalFormatImpl::writeICalDateTimeProperty(const icalproperty_kind
 QDateTime ICalFormatImpl::readICalDateTime(icalproperty *p, const icaltimetype &t,
                                            const ICalTimeZoneCache *tzCache, bool utc)
 {
+    KCALCORE_COUNT(DateTimeConversions);
 //  qCDebug(KCALCORE_LOG);
 //  _dumpIcaltime( t );
 
@@ -2731,6 +2767,7 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar,
                               bool deleted, const QString &notebook)
 {
     Q_UNUSED(notebook);
+    KCALCORE_TIME(PopulateTimer);
 
     // qCDebug(KCALCORE_LOG)<<"Populate called";
 
@@ -2814,11 +2851,39 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar,
     d->mTodosRelate.clear();
     // TODO: make sure that only actually added events go to this lists.
 
+    // New incidences are inserted together with Calendar::addIncidences().
+    // They are flushed before looking up one of their uids, so duplicates
+    // within the file are handled as if they had been added one by one.
+    // The key matches the lookup below: recurrence ids are compared as
+    // points in time, not as strings.
+    typedef QPair<QString, qint64> PendingKey;
+    auto pendingKey = [](const Incidence::Ptr &incidence) {
+        return PendingKey(incidence->uid(),
+                          incidence->hasRecurrenceId() ? incidence->recurrenceId().toMSecsSinceEpoch()
+                          : std::numeric_limits<qint64>::min());
+    };
+    Incidence::List pending;
+    QSet<PendingKey> pendingIds;
+    auto addLater = [&pending, &pendingIds, &pendingKey](const Incidence::Ptr &incidence) {
+        pending.append(incidence);
+        pendingIds.insert(pendingKey(incidence));
+    };
+    auto flushPending = [&cal, &pending, &pendingIds]() {
+        if (!pending.isEmpty()) {
+            cal->addIncidences(pending);
+            pending.clear();
+            pendingIds.clear();
+        }
+    };
+
     icalcomponent *c = icalcomponent_get_first_component(calendar, ICAL_VTODO_COMPONENT);
     while (c) {
         Todo::Ptr todo = readTodo(c, &timeZoneCache);
         if (todo) {
             // qCDebug(KCALCORE_LOG) << "todo is not zero and deleted is " << deleted;
+            if (pendingIds.contains(pendingKey(todo))) {
+                flushPending();
+            }
             Todo::Ptr old = cal->todo(todo->uid(), todo->recurrenceId());
             if (old) {
                 if (old->uid().isEmpty()) {
@@ -2846,7 +2911,7 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar,
                 }
             } else {
                 // qCDebug(KCALCORE_LOG) << "Adding todo " << todo.data() << todo->uid();
-                cal->addTodo(todo);   // just add this one
+                addLater(todo);   // just add this one
             }
         }
         c = icalcomponent_get_next_component(calendar, ICAL_VTODO_COMPONENT);
@@ -2858,6 +2923,9 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar,
         Event::Ptr event = readEvent(c, &timeZoneCache);
         if (event) {
             // qCDebug(KCALCORE_LOG) << "event is not zero and deleted is " << deleted;
+            if (pendingIds.contains(pendingKey(event))) {
+                flushPending();
+            }
             Event::Ptr old = cal->event(event->uid(), event->recurrenceId());
             if (old) {
                 if (old->uid().isEmpty()) {
@@ -2886,7 +2954,7 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar,
                 }
             } else {
                 // qCDebug(KCALCORE_LOG) << "Adding event " << event.data() << event->uid();
-                cal->addEvent(event);   // just add this one
+                addLater(event);   // just add this one
             }
         }
         c = icalcomponent_get_next_component(calendar, ICAL_VEVENT_COMPONENT);
@@ -2897,6 +2965,9 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar,
     while (c) {
         Journal::Ptr journal = readJournal(c, &timeZoneCache);
         if (journal) {
+            if (pendingIds.contains(pendingKey(journal))) {
+                flushPending();
+            }
             Journal::Ptr old = cal->journal(journal->uid(), journal->recurrenceId());
             if (old) {
                 if (deleted) {
@@ -2912,12 +2983,14 @@ bool ICalFormatImpl::populate(const Calendar::Ptr &cal, icalcomponent *calendar,
                     cal->deleteJournal(journal);   // and move it to deleted
                 }
             } else {
-                cal->addJournal(journal);   // just add this one
+                addLater(journal);   // just add this one
             }
         }
         c = icalcomponent_get_next_component(calendar, ICAL_VJOURNAL_COMPONENT);
     }
 
+    flushPending();
+
     // TODO: Remove any previous time zones no longer referenced in the calendar
 
     return true;
@@ -22,6 +22,7 @@
 #include "icaltimezones_p.h"
 #include "icalformat.h"
 #include "icalformat_p.h"
+#include "instrumentation_p.h"
 #include "recurrence.h"
 #include "recurrencerule.h"
 #include "utils.h"
@@ -466,6 +467,7 @@ void ICalTimeZoneParser::parse(icalcomponent *calendar)
 
 QTimeZone ICalTimeZoneParser::resolveICalTimeZone(const ICalTimeZone &icalZone)
 {
+    KCALCORE_COUNT(TimeZoneResolutions);
     const auto phase = icalZone.standard;
     const auto now = QDateTime::currentDateTimeUtc();
 
@@ -33,9 +33,14 @@
 */
 
 #include "incidence.h"
+#include "arena_p.h"
 #include "calformat.h"
+#include "memoryaccounting_p.h"
 #include "utils.h"
 
+#include <QAtomicInt>
+#include <QMutex>
+#include <QScopedPointer>
 #include <QTemporaryFile>
 #include <QMimeDatabase>
 #include <QTextDocument> // for .toHtmlEscaped() and Qt::mightBeRichText()
@@ -45,18 +50,33 @@
 
 using namespace KCalCore;
 
+//@cond PRIVATE
+// Guards the decoding of lazily decoded descriptions
+Q_GLOBAL_STATIC(QMutex, sDecodingMutex)
+//@endcond
+
 /**
   Private class that helps to provide binary compatibility between releases.
   @internal
 */
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::Incidence::Private
+class Q_DECL_HIDDEN KCalCore::Incidence::Private : public ArenaAllocated
 {
 public:
+    // Properties most incidences do not have, allocated when first set
+    struct Extra : public ArenaAllocated {
+        QStringList mResources;             // resources list (not calendar resources)
+        QString mStatusString;              // status string, for custom status
+        QString mSchedulingID;              // ID for scheduling mails
+        QMap<RelType, QString> mRelatedToUid; // incidence uid this is related to, for each relType
+        QHash<Attachment::Ptr, QString> mTempFiles; // Temporary files for writing attachments to.
+        float mGeoLatitude = INVALID_LATLON;  // Specifies latitude in decimal degrees
+        float mGeoLongitude = INVALID_LATLON; // Specifies longitude in decimal degrees
+        bool mHasGeo = false;                 // if incidence has geo data
+    };
+
     Private()
-        : mGeoLatitude(INVALID_LATLON),
-          mGeoLongitude(INVALID_LATLON),
-          mRecurrence(nullptr),
+        : mRecurrence(nullptr),
           mRevision(0),
           mPriority(0),
           mStatus(StatusNone),
@@ -64,7 +84,6 @@ public:
           mDescriptionIsRich(false),
           mSummaryIsRich(false),
           mLocationIsRich(false),
-          mHasGeo(false),
           mThisAndFuture(false),
           mLocalOnly(false)
     {
@@ -72,17 +91,11 @@ public:
 
     Private(const Private &p)
         : mCreated(p.mCreated),
-          mDescription(p.mDescription),
+          mDescription(p.description()),
           mSummary(p.mSummary),
           mLocation(p.mLocation),
           mCategories(p.mCategories),
-          mResources(p.mResources),
-          mStatusString(p.mStatusString),
-          mSchedulingID(p.mSchedulingID),
-          mRelatedToUid(p.mRelatedToUid),
           mRecurrenceId(p.mRecurrenceId),
-          mGeoLatitude(p.mGeoLatitude),
-          mGeoLongitude(p.mGeoLongitude),
           mRecurrence(nullptr),
           mRevision(p.mRevision),
           mPriority(p.mPriority),
@@ -91,10 +104,54 @@ public:
           mDescriptionIsRich(p.mDescriptionIsRich),
           mSummaryIsRich(p.mSummaryIsRich),
           mLocationIsRich(p.mLocationIsRich),
-          mHasGeo(p.mHasGeo),
           mThisAndFuture(p.mThisAndFuture),
           mLocalOnly(false)
     {
+        if (p.mExtra) {
+            mExtra = new Extra(*p.mExtra);
+            mExtra->mTempFiles.clear();
+        }
+    }
+
+    ~Private()
+    {
+        delete mExtra;
+    }
+
+    const Extra &extra() const
+    {
+        static const Extra empty{};
+        return mExtra ? *mExtra : empty;
+    }
+
+    Extra &writableExtra()
+    {
+        if (!mExtra) {
+            mExtra = new Extra;
+        }
+        return *mExtra;
+    }
+
+    // Published incidences may be read, and so decoded, from several
+    // threads at once
+    const QString &description() const
+    {
+        if (mUndecoded.loadAcquire()) {
+            QMutexLocker locker(sDecodingMutex());
+            if (mUndecoded.load()) {
+                mDescription = QString::fromUtf8(mRawDescription);
+                mRawDescription = QByteArray();
+                mUndecoded.storeRelease(0);
+            }
+        }
+        return mDescription;
+    }
+
+    void setRawDescription(const QByteArray &description)
+    {
+        mDescription.clear();
+        mRawDescription = description;
+        mUndecoded.store(description.isNull() ? 0 : 1);
     }
 
     void clear()
@@ -109,19 +166,25 @@ public:
     {
         mRevision = src.d->mRevision;
         mCreated = src.d->mCreated;
-        mDescription = src.d->mDescription;
+        mDescription = src.d->description();
+        setRawDescription(QByteArray());
         mSummary = src.d->mSummary;
         mCategories = src.d->mCategories;
-        mRelatedToUid = src.d->mRelatedToUid;
-        mResources = src.d->mResources;
-        mStatusString = src.d->mStatusString;
+        if (mExtra || src.d->mExtra) {
+            // Keeps the scheduling id and the temporary files
+            Extra &extra = writableExtra();
+            const Extra &other = src.d->extra();
+            extra.mRelatedToUid = other.mRelatedToUid;
+            extra.mResources = other.mResources;
+            extra.mStatusString = other.mStatusString;
+            extra.mGeoLatitude = other.mGeoLatitude;
+            extra.mGeoLongitude = other.mGeoLongitude;
+            extra.mHasGeo = other.mHasGeo;
+        }
         mStatus = src.d->mStatus;
         mSecrecy = src.d->mSecrecy;
         mPriority = src.d->mPriority;
         mLocation = src.d->mLocation;
-        mGeoLatitude = src.d->mGeoLatitude;
-        mGeoLongitude = src.d->mGeoLongitude;
-        mHasGeo = src.d->mHasGeo;
         mRecurrenceId = src.d->mRecurrenceId;
         mThisAndFuture = src.d->mThisAndFuture;
         mLocalOnly = src.d->mLocalOnly;
@@ -151,21 +214,17 @@ public:
     }
 
     QDateTime mCreated;                 // creation datetime
-    QString mDescription;               // description string
+    mutable QString mDescription;       // description string
+    mutable QByteArray mRawDescription; // UTF-8 description, until decoded by description()
+    mutable QAtomicInt mUndecoded;      // 1 while mRawDescription holds the description
     QString mSummary;                   // summary string
     QString mLocation;                  // location string
     QStringList mCategories;            // category list
     Attachment::List mAttachments;      // attachments list
     Alarm::List mAlarms;                // alarms list
-    QStringList mResources;             // resources list (not calendar resources)
-    QString mStatusString;              // status string, for custom status
-    QString mSchedulingID;              // ID for scheduling mails
-    QMap<RelType, QString> mRelatedToUid; // incidence uid this is related to, for each relType
-    QHash<Attachment::Ptr, QString> mTempFiles; // Temporary files for writing attachments to.
     QDateTime mRecurrenceId;            // recurrenceId
 
-    float mGeoLatitude;                 // Specifies latitude in decimal degrees
-    float mGeoLongitude;                // Specifies longitude in decimal degrees
+    Extra *mExtra = nullptr;            // rarely used properties, or null
     mutable Recurrence *mRecurrence;    // recurrence
     int mRevision;                      // revision number
     int mPriority;                      // priority: 1 = highest, 2 = less, etc.
@@ -174,7 +233,6 @@ public:
     bool mDescriptionIsRich = false;            // description string is richtext.
     bool mSummaryIsRich = false;                // summary string is richtext.
     bool mLocationIsRich = false;               // location string is richtext.
-    bool mHasGeo = false;                       // if incidence has geo data
     bool mThisAndFuture = false;
     bool mLocalOnly = false;                    // allow changes that won't go to the server
 };
@@ -293,7 +351,7 @@ bool Incidence::equals(const IncidenceBase &incidence) const
         resources() == i2->resources() &&
         d->mStatus == i2->d->mStatus &&
         (d->mStatus == StatusNone ||
-         stringCompare(d->mStatusString, i2->d->mStatusString)) &&
+         stringCompare(d->extra().mStatusString, i2->d->extra().mStatusString)) &&
         secrecy() == i2->secrecy() &&
         priority() == i2->priority() &&
         stringCompare(location(), i2->location()) &&
@@ -423,12 +481,25 @@ void Incidence::setDescription(const QString &description, bool isRich)
         return;
     }
     update();
+    d->setRawDescription(QByteArray());
     d->mDescription = description;
     d->mDescriptionIsRich = isRich;
     setFieldDirty(FieldDescription);
     updated();
 }
 
+void Incidence::setDescriptionUtf8(const QByteArray &description, bool isRich)
+{
+    if (mReadOnly) {
+        return;
+    }
+    update();
+    d->setRawDescription(description);
+    d->mDescriptionIsRich = isRich;
+    setFieldDirty(FieldDescription);
+    updated();
+}
+
 void Incidence::setDescription(const QString &description)
 {
     setDescription(description, Qt::mightBeRichText(description));
@@ -436,15 +507,15 @@ void Incidence::setDescription(const QString &description)
 
 QString Incidence::description() const
 {
-    return d->mDescription;
+    return d->description();
 }
 
 QString Incidence::richDescription() const
 {
     if (descriptionIsRich()) {
-        return d->mDescription;
+        return d->description();
     } else {
-        return d->mDescription.toHtmlEscaped().replace(QLatin1Char('\n'), QStringLiteral("<br/>"));
+        return d->description().toHtmlEscaped().replace(QLatin1Char('\n'), QStringLiteral("<br/>"));
     }
 }
 
@@ -542,9 +613,9 @@ void Incidence::setRelatedTo(const QString &relatedToUid, RelType relType)
     // TODO: RFC says that an incidence can have more than one related-to field
     // even for the same relType.
 
-    if (d->mRelatedToUid[relType] != relatedToUid) {
+    if (d->extra().mRelatedToUid.value(relType) != relatedToUid) {
         update();
-        d->mRelatedToUid[relType] = relatedToUid;
+        d->writableExtra().mRelatedToUid[relType] = relatedToUid;
         setFieldDirty(FieldRelatedTo);
         updated();
     }
@@ -552,7 +623,7 @@ void Incidence::setRelatedTo(const QString &relatedToUid, RelType relType)
 
 QString Incidence::relatedTo(RelType relType) const
 {
-    return d->mRelatedToUid.value(relType);
+    return d->extra().mRelatedToUid.value(relType);
 }
 
 // %%%%%%%%%%%%  Recurrence-related methods %%%%%%%%%%%%%%%%%%%%
@@ -760,7 +831,7 @@ void Incidence::clearAttachments()
 
 QString Incidence::writeAttachmentToTempFile(const Attachment::Ptr &attachment) const
 {
-    const QString attachementPath = d->mTempFiles.value(attachment);
+    const QString attachementPath = d->extra().mTempFiles.value(attachment);
     if (!attachementPath.isEmpty()) {
         return attachementPath;
     }
@@ -776,20 +847,31 @@ QString Incidence::writeAttachmentToTempFile(const Attachment::Ptr &attachment)
     file.open();
     // read-only not to give the idea that it could be written to
     file.setPermissions(QFile::ReadUser);
-    file.write(QByteArray::fromBase64(attachment->data()));
-    d->mTempFiles.insert(attachment, file.fileName());
+    QScopedPointer<QIODevice> data(attachment->openDecodedData());
+    if (data) {
+        char buffer[64 * 1024];
+        qint64 read;
+        while ((read = data->read(buffer, sizeof(buffer))) > 0) {
+            file.write(buffer, read);
+        }
+    }
+    d->writableExtra().mTempFiles.insert(attachment, file.fileName());
     file.close();
-    return d->mTempFiles.value(attachment);
+    return file.fileName();
 }
 
 void Incidence::clearTempFiles()
 {
-    QHash<Attachment::Ptr, QString>::const_iterator it = d->mTempFiles.constBegin();
-    const QHash<Attachment::Ptr, QString>::const_iterator end = d->mTempFiles.constEnd();
+    if (!d->mExtra) {
+        return;
+    }
+
+    QHash<Attachment::Ptr, QString>::const_iterator it = d->mExtra->mTempFiles.constBegin();
+    const QHash<Attachment::Ptr, QString>::const_iterator end = d->mExtra->mTempFiles.constEnd();
     for (; it != end; ++it) {
         QFile::remove(it.value());
     }
-    d->mTempFiles.clear();
+    d->mExtra->mTempFiles.clear();
 }
 
 void Incidence::setResources(const QStringList &resources)
@@ -799,14 +881,16 @@ void Incidence::setResources(const QStringList &resources)
     }
 
     update();
-    d->mResources = resources;
+    if (d->mExtra || !resources.isEmpty()) {
+        d->writableExtra().mResources = resources;
+    }
     setFieldDirty(FieldResources);
     updated();
 }
 
 QStringList Incidence::resources() const
 {
-    return d->mResources;
+    return d->extra().mResources;
 }
 
 void Incidence::setPriority(int priority)
@@ -834,7 +918,9 @@ void Incidence::setStatus(Incidence::Status status)
 
     update();
     d->mStatus = status;
-    d->mStatusString.clear();
+    if (d->mExtra) {
+        d->mExtra->mStatusString.clear();
+    }
     setFieldDirty(FieldStatus);
     updated();
 }
@@ -847,7 +933,9 @@ void Incidence::setCustomStatus(const QString &status)
 
     update();
     d->mStatus = status.isEmpty() ? StatusNone : StatusX;
-    d->mStatusString = status;
+    if (d->mExtra || !status.isEmpty()) {
+        d->writableExtra().mStatusString = status;
+    }
     setFieldDirty(FieldStatus);
     updated();
 }
@@ -860,7 +948,7 @@ Incidence::Status Incidence::status() const
 QString Incidence::customStatus() const
 {
     if (d->mStatus == StatusX) {
-        return d->mStatusString;
+        return d->extra().mStatusString;
     } else {
         return QString();
     }
@@ -976,24 +1064,27 @@ void Incidence::setSchedulingID(const QString &sid, const QString &uid)
     if (!uid.isEmpty()) {
         setUid(uid);
     }
-    if (sid != d->mSchedulingID) {
-        d->mSchedulingID = sid;
+    if (sid != d->extra().mSchedulingID) {
+        update();
+        d->writableExtra().mSchedulingID = sid;
         setFieldDirty(FieldSchedulingId);
+        updated();
     }
 }
 
 QString Incidence::schedulingID() const
 {
-    if (d->mSchedulingID.isNull()) {
+    const QString &sid = d->extra().mSchedulingID;
+    if (sid.isNull()) {
         // Nothing set, so use the normal uid
         return uid();
     }
-    return d->mSchedulingID;
+    return sid;
 }
 
 bool Incidence::hasGeo() const
 {
-    return d->mHasGeo;
+    return d->extra().mHasGeo;
 }
 
 void Incidence::setHasGeo(bool hasGeo)
@@ -1002,12 +1093,12 @@ void Incidence::setHasGeo(bool hasGeo)
         return;
     }
 
-    if (hasGeo == d->mHasGeo) {
+    if (hasGeo == d->extra().mHasGeo) {
         return;
     }
 
     update();
-    d->mHasGeo = hasGeo;
+    d->writableExtra().mHasGeo = hasGeo;
     setFieldDirty(FieldGeoLatitude);
     setFieldDirty(FieldGeoLongitude);
     updated();
@@ -1015,7 +1106,7 @@ void Incidence::setHasGeo(bool hasGeo)
 
 float Incidence::geoLatitude() const
 {
-    return d->mGeoLatitude;
+    return d->extra().mGeoLatitude;
 }
 
 void Incidence::setGeoLatitude(float geolatitude)
@@ -1025,21 +1116,21 @@ void Incidence::setGeoLatitude(float geolatitude)
     }
 
     update();
-    d->mGeoLatitude = geolatitude;
+    d->writableExtra().mGeoLatitude = geolatitude;
     setFieldDirty(FieldGeoLatitude);
     updated();
 }
 
 float Incidence::geoLongitude() const
 {
-    return d->mGeoLongitude;
+    return d->extra().mGeoLongitude;
 }
 
 void Incidence::setGeoLongitude(float geolongitude)
 {
     if (!mReadOnly) {
         update();
-        d->mGeoLongitude = geolongitude;
+        d->writableExtra().mGeoLongitude = geolongitude;
         setFieldDirty(FieldGeoLongitude);
         updated();
     }
@@ -1132,14 +1223,14 @@ QStringList Incidence::mimeTypes()
 void Incidence::serialize(QDataStream &out)
 {
     serializeQDateTimeAsKDateTime(out, d->mCreated);
-    out << d->mRevision << d->mDescription << d->mDescriptionIsRich << d->mSummary
+    out << d->mRevision << d->description() << d->mDescriptionIsRich << d->mSummary
         << d->mSummaryIsRich << d->mLocation << d->mLocationIsRich << d->mCategories
-        << d->mResources << d->mStatusString << d->mPriority << d->mSchedulingID
-        << d->mGeoLatitude << d->mGeoLongitude << d->mHasGeo;
+        << d->extra().mResources << d->extra().mStatusString << d->mPriority << d->extra().mSchedulingID
+        << d->extra().mGeoLatitude << d->extra().mGeoLongitude << d->extra().mHasGeo;
     serializeQDateTimeAsKDateTime(out, d->mRecurrenceId);
     out << d->mThisAndFuture
         << d->mLocalOnly << d->mStatus << d->mSecrecy << (d->mRecurrence ? true : false)
-        << d->mAttachments.count() << d->mAlarms.count() << d->mRelatedToUid;
+        << d->mAttachments.count() << d->mAlarms.count() << d->extra().mRelatedToUid;
 
     if (d->mRecurrence) {
         out << d->mRecurrence;
@@ -1160,11 +1251,13 @@ void Incidence::deserialize(QDataStream &in)
     bool hasRecurrence;
     int attachmentCount, alarmCount;
     QMap<int, QString> relatedToUid;
+    Private::Extra extra;
     deserializeKDateTimeAsQDateTime(in, d->mCreated);
+    d->setRawDescription(QByteArray());
     in >> d->mRevision >> d->mDescription >> d->mDescriptionIsRich >> d->mSummary
        >> d->mSummaryIsRich >> d->mLocation >> d->mLocationIsRich >> d->mCategories
-       >> d->mResources >> d->mStatusString >> d->mPriority >> d->mSchedulingID
-       >> d->mGeoLatitude >> d->mGeoLongitude >> d->mHasGeo;
+       >> extra.mResources >> extra.mStatusString >> d->mPriority >> extra.mSchedulingID
+       >> extra.mGeoLatitude >> extra.mGeoLongitude >> extra.mHasGeo;
     deserializeKDateTimeAsQDateTime(in, d->mRecurrenceId);
     in >> d->mThisAndFuture
        >> d->mLocalOnly >> status >> secrecy >> hasRecurrence >> attachmentCount >> alarmCount
@@ -1196,10 +1289,60 @@ void Incidence::deserialize(QDataStream &in)
     d->mStatus = static_cast<Incidence::Status>(status);
     d->mSecrecy = static_cast<Incidence::Secrecy>(secrecy);
 
-    d->mRelatedToUid.clear();
-
     auto it = relatedToUid.cbegin(), end = relatedToUid.cend();
     for (; it != end; ++it) {
-        d->mRelatedToUid.insert(static_cast<Incidence::RelType>(it.key()), it.value());
+        extra.mRelatedToUid.insert(static_cast<Incidence::RelType>(it.key()), it.value());
+    }
+
+    if (d->mExtra) {
+        extra.mTempFiles = d->mExtra->mTempFiles;
+        *d->mExtra = extra;
+    } else if (!extra.mResources.isEmpty() || !extra.mStatusString.isEmpty()
+               || !extra.mSchedulingID.isNull() || !extra.mRelatedToUid.isEmpty()
+               || extra.mHasGeo || extra.mGeoLatitude != INVALID_LATLON
+               || extra.mGeoLongitude != INVALID_LATLON) {
+        d->writableExtra() = extra;
     }
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addIncidenceData(const Incidence &incidence)
+{
+    const Incidence::Private *d = incidence.d;
+    add(MemoryUsage::IncidenceObjects, sizeof(Incidence::Private));
+    addString(d->mDescription, MemoryUsage::Strings);
+    addByteArray(d->mRawDescription, MemoryUsage::Strings);
+    addString(d->mSummary, MemoryUsage::Strings);
+    addString(d->mLocation, MemoryUsage::Strings);
+    addStringList(d->mCategories, MemoryUsage::Strings);
+    if (d->mExtra) {
+        const Incidence::Private::Extra &extra = *d->mExtra;
+        add(MemoryUsage::IncidenceObjects, sizeof(Incidence::Private::Extra));
+        addStringList(extra.mResources, MemoryUsage::Strings);
+        addString(extra.mStatusString, MemoryUsage::Strings);
+        addString(extra.mSchedulingID, MemoryUsage::Strings);
+        addMap(extra.mRelatedToUid, MemoryUsage::Strings);
+        for (const QString &uid : extra.mRelatedToUid) {
+            addString(uid, MemoryUsage::Strings);
+        }
+        addHash(extra.mTempFiles, MemoryUsage::Attachments);
+        for (const QString &fileName : extra.mTempFiles) {
+            addString(fileName, MemoryUsage::Attachments);
+        }
+    }
+
+    addVector(d->mAttachments, MemoryUsage::Attachments);
+    for (const Attachment::Ptr &attachment : qAsConst(d->mAttachments)) {
+        addAttachment(attachment);
+    }
+    addVector(d->mAlarms, MemoryUsage::Alarms);
+    for (const Alarm::Ptr &alarm : qAsConst(d->mAlarms)) {
+        addAlarm(alarm);
+    }
+    if (d->mRecurrence) {
+        addRecurrence(*d->mRecurrence);
+    }
+
+    addIncidenceBaseData(incidence);
+}
+//@endcond
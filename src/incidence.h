@@ -866,6 +866,11 @@ private:
     Incidence &operator=(const Incidence &other);
 
     //@cond PRIVATE
+    // Sets the description from UTF-8, decoded on first access
+    void setDescriptionUtf8(const QByteArray &description, bool isRich);
+
+    friend class ICalFormatImpl;
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
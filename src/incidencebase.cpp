@@ -35,10 +35,14 @@
 */
 
 #include "incidencebase.h"
+#include "arena_p.h"
 #include "calformat.h"
+#include "memoryaccounting_p.h"
 #include "visitor.h"
 #include "utils.h"
 
+#include <QAtomicInt>
+#include <QMutex>
 #include <QTime>
 #include "kcalcore_debug.h"
 #include <QUrl>
@@ -50,14 +54,28 @@
 
 using namespace KCalCore;
 
+//@cond PRIVATE
+// Guards the decoding of lazily decoded comments
+Q_GLOBAL_STATIC(QMutex, sDecodingMutex)
+//@endcond
+
 /**
   Private class that helps to provide binary compatibility between releases.
   @internal
 */
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::IncidenceBase::Private
+class Q_DECL_HIDDEN KCalCore::IncidenceBase::Private : public ArenaAllocated
 {
 public:
+    // Properties most incidences do not have, allocated when first set
+    struct Extra : public ArenaAllocated {
+        QStringList mComments;       // list of incidence comments
+        QList<QByteArray> mRawComments; // UTF-8 comments, until decoded by comments()
+        QAtomicInt mUndecoded;       // 1 while mRawComments holds comments
+        QStringList mContacts;       // list of incidence contacts
+        QUrl mUrl;                   // incidence url property
+    };
+
     Private()
         : mOrganizer(nullptr),
           mUpdateGroupLevel(0),
@@ -77,10 +95,47 @@ public:
 
     ~Private()
     {
+        delete mExtra;
     }
 
     void init(const Private &other);
 
+    const Extra &extra() const
+    {
+        static const Extra empty{};
+        return mExtra ? *mExtra : empty;
+    }
+
+    Extra &writableExtra()
+    {
+        if (!mExtra) {
+            mExtra = new Extra;
+        }
+        return *mExtra;
+    }
+
+    // Published incidences may be read, and so decoded, from several
+    // threads at once
+    const QStringList &comments() const
+    {
+        if (mExtra && mExtra->mUndecoded.loadAcquire()) {
+            QMutexLocker locker(sDecodingMutex());
+            if (mExtra->mUndecoded.load()) {
+                for (const QByteArray &comment : qAsConst(mExtra->mRawComments)) {
+                    mExtra->mComments.append(QString::fromUtf8(comment));
+                }
+                mExtra->mRawComments.clear();
+                mExtra->mUndecoded.storeRelease(0);
+            }
+        }
+        return extra().mComments;
+    }
+
+    void setDirty(Field field)
+    {
+        mDirtyFields |= Q_UINT64_C(1) << field;
+    }
+
     QDateTime mLastModified;     // incidence last modified date
     QDateTime mDtStart;          // incidence start time
     Person::Ptr mOrganizer;           // incidence person (owner)
@@ -91,14 +146,14 @@ public:
     bool mAllDay = false;                // true if the incidence is all-day
     bool mHasDuration = false;           // true if the incidence has a duration
     Attendee::List mAttendees;   // list of incidence attendees
-    QStringList mComments;       // list of incidence comments
-    QStringList mContacts;       // list of incidence contacts
     QList<IncidenceObserver *> mObservers; // list of incidence observers
-    QSet<Field> mDirtyFields;    // Fields that changed since last time the incidence was created
-    // or since resetDirtyFlags() was called
-    QUrl mUrl;                   // incidence url property
+    quint64 mDirtyFields = 0;    // Bit set of the Fields that changed since last time the incidence
+    // was created or since resetDirtyFields() was called
+    Extra *mExtra = nullptr;     // rarely used properties, or null
 };
 
+Q_STATIC_ASSERT(IncidenceBase::FieldUrl < 64);
+
 void IncidenceBase::Private::init(const Private &other)
 {
     mLastModified = other.mLastModified;
@@ -109,15 +164,20 @@ void IncidenceBase::Private::init(const Private &other)
     mAllDay = other.mAllDay;
     mHasDuration = other.mHasDuration;
 
-    mComments = other.mComments;
-    mContacts = other.mContacts;
+    if (other.mExtra) {
+        // Decoded first, other may be decoded by another thread meanwhile
+        other.comments();
+        writableExtra() = *other.mExtra;
+    } else {
+        delete mExtra;
+        mExtra = nullptr;
+    }
 
     mAttendees.clear();
     mAttendees.reserve(other.mAttendees.count());
     for (Attendee::List::ConstIterator it = other.mAttendees.constBegin(), end = other.mAttendees.constEnd(); it != end; ++it) {
         mAttendees.append(Attendee::Ptr(new Attendee(*(*it))));
     }
-    mUrl = other.mUrl;
 }
 //@endcond
 
@@ -157,8 +217,8 @@ IncidenceBase &IncidenceBase::assign(const IncidenceBase &other)
     CustomProperties::operator=(other);
     d->init(*other.d);
     mReadOnly = other.mReadOnly;
-    d->mDirtyFields.clear();
-    d->mDirtyFields.insert(FieldUnknown);
+    d->mDirtyFields = 0;
+    d->setDirty(FieldUnknown);
     return *this;
 }
 
@@ -230,7 +290,7 @@ void IncidenceBase::setUid(const QString &uid)
     if (d->mUid != uid) {
         update();
         d->mUid = uid;
-        d->mDirtyFields.insert(FieldUid);
+        d->setDirty(FieldUid);
         updated();
     }
 }
@@ -245,7 +305,7 @@ void IncidenceBase::setLastModified(const QDateTime &lm)
     // DON'T! updated() because we call this from
     // Calendar::updateEvent().
 
-    d->mDirtyFields.insert(FieldLastModified);
+    d->setDirty(FieldLastModified);
 
     // Convert to UTC and remove milliseconds part.
     QDateTime current = lm.toUTC();
@@ -270,7 +330,7 @@ void IncidenceBase::setOrganizer(const Person::Ptr &organizer)
         // the event's readonly status...
         d->mOrganizer = organizer;
 
-        d->mDirtyFields.insert(FieldOrganizer);
+        d->setDirty(FieldOrganizer);
 
         updated();
     }
@@ -318,7 +378,7 @@ void IncidenceBase::setDtStart(const QDateTime &dtStart)
     if (d->mDtStart != dtStart) {
         update();
         d->mDtStart = dtStart;
-        d->mDirtyFields.insert(FieldDtStart);
+        d->setDirty(FieldDtStart);
         updated();
     }
 }
@@ -341,7 +401,7 @@ void IncidenceBase::setAllDay(bool f)
     update();
     d->mAllDay = f;
     if (d->mDtStart.isValid()) {
-        d->mDirtyFields.insert(FieldDtStart);
+        d->setDirty(FieldDtStart);
     }
     updated();
 }
@@ -351,30 +411,43 @@ void IncidenceBase::shiftTimes(const QTimeZone &oldZone, const QTimeZone &newZon
     update();
     d->mDtStart = d->mDtStart.toTimeZone(oldZone);
     d->mDtStart.setTimeZone(newZone);
-    d->mDirtyFields.insert(FieldDtStart);
-    d->mDirtyFields.insert(FieldDtEnd);
+    d->setDirty(FieldDtStart);
+    d->setDirty(FieldDtEnd);
     updated();
 }
 
 void IncidenceBase::addComment(const QString &comment)
 {
-    d->mComments += comment;
+    d->comments();
+    d->writableExtra().mComments += comment;
+}
+
+void IncidenceBase::addCommentUtf8(const QByteArray &comment)
+{
+    Private::Extra &extra = d->writableExtra();
+    extra.mRawComments.append(comment);
+    extra.mUndecoded.store(1);
 }
 
 bool IncidenceBase::removeComment(const QString &comment)
 {
+    if (!d->comments().contains(comment)) {
+        return false;
+    }
+
     bool found = false;
     QStringList::Iterator i;
+    QStringList &comments = d->writableExtra().mComments;
 
-    for (i = d->mComments.begin(); !found && i != d->mComments.end(); ++i) {
+    for (i = comments.begin(); !found && i != comments.end(); ++i) {
         if ((*i) == comment) {
             found = true;
-            d->mComments.erase(i);
+            comments.erase(i);
         }
     }
 
     if (found) {
-        d->mDirtyFields.insert(FieldComment);
+        d->setDirty(FieldComment);
     }
 
     return found;
@@ -382,37 +455,46 @@ bool IncidenceBase::removeComment(const QString &comment)
 
 void IncidenceBase::clearComments()
 {
-    d->mDirtyFields.insert(FieldComment);
-    d->mComments.clear();
+    d->setDirty(FieldComment);
+    if (d->mExtra) {
+        d->mExtra->mComments.clear();
+        d->mExtra->mRawComments.clear();
+        d->mExtra->mUndecoded.store(0);
+    }
 }
 
 QStringList IncidenceBase::comments() const
 {
-    return d->mComments;
+    return d->comments();
 }
 
 void IncidenceBase::addContact(const QString &contact)
 {
     if (!contact.isEmpty()) {
-        d->mContacts += contact;
-        d->mDirtyFields.insert(FieldContact);
+        d->writableExtra().mContacts += contact;
+        d->setDirty(FieldContact);
     }
 }
 
 bool IncidenceBase::removeContact(const QString &contact)
 {
+    if (!d->extra().mContacts.contains(contact)) {
+        return false;
+    }
+
     bool found = false;
     QStringList::Iterator i;
+    QStringList &contacts = d->writableExtra().mContacts;
 
-    for (i = d->mContacts.begin(); !found && i != d->mContacts.end(); ++i) {
+    for (i = contacts.begin(); !found && i != contacts.end(); ++i) {
         if ((*i) == contact) {
             found = true;
-            d->mContacts.erase(i);
+            contacts.erase(i);
         }
     }
 
     if (found) {
-        d->mDirtyFields.insert(FieldContact);
+        d->setDirty(FieldContact);
     }
 
     return found;
@@ -420,13 +502,15 @@ bool IncidenceBase::removeContact(const QString &contact)
 
 void IncidenceBase::clearContacts()
 {
-    d->mDirtyFields.insert(FieldContact);
-    d->mContacts.clear();
+    d->setDirty(FieldContact);
+    if (d->mExtra) {
+        d->mExtra->mContacts.clear();
+    }
 }
 
 QStringList IncidenceBase::contacts() const
 {
-    return d->mContacts;
+    return d->extra().mContacts;
 }
 
 void IncidenceBase::addAttendee(const Attendee::Ptr &a, bool doupdate)
@@ -458,7 +542,7 @@ void IncidenceBase::addAttendee(const Attendee::Ptr &a, bool doupdate)
 
     d->mAttendees.append(a);
     if (doupdate) {
-        d->mDirtyFields.insert(FieldAttendees);
+        d->setDirty(FieldAttendees);
         updated();
     }
 }
@@ -478,7 +562,7 @@ void IncidenceBase::deleteAttendee(const Attendee::Ptr &a, bool doupdate)
         d->mAttendees.remove(index);
 
         if (doupdate) {
-            d->mDirtyFields.insert(FieldAttendees);
+            d->setDirty(FieldAttendees);
             updated();
         }
     }
@@ -499,7 +583,7 @@ void IncidenceBase::clearAttendees()
     if (mReadOnly) {
         return;
     }
-    d->mDirtyFields.insert(FieldAttendees);
+    d->setDirty(FieldAttendees);
     d->mAttendees.clear();
 }
 
@@ -552,7 +636,7 @@ void IncidenceBase::setDuration(const Duration &duration)
     update();
     d->mDuration = duration;
     setHasDuration(true);
-    d->mDirtyFields.insert(FieldDuration);
+    d->setDirty(FieldDuration);
     updated();
 }
 
@@ -573,13 +657,15 @@ bool IncidenceBase::hasDuration() const
 
 void IncidenceBase::setUrl(const QUrl &url)
 {
-    d->mDirtyFields.insert(FieldUrl);
-    d->mUrl = url;
+    d->setDirty(FieldUrl);
+    if (d->mExtra || !url.isEmpty()) {
+        d->writableExtra().mUrl = url;
+    }
 }
 
 QUrl IncidenceBase::url() const
 {
-    return d->mUrl;
+    return d->extra().mUrl;
 }
 
 void IncidenceBase::registerObserver(IncidenceBase::IncidenceObserver *observer)
@@ -650,17 +736,23 @@ QDateTime IncidenceBase::recurrenceId() const
 
 void IncidenceBase::resetDirtyFields()
 {
-    d->mDirtyFields.clear();
+    d->mDirtyFields = 0;
 }
 
 QSet<IncidenceBase::Field> IncidenceBase::dirtyFields() const
 {
-    return d->mDirtyFields;
+    QSet<Field> fields;
+    for (int field = 0; field <= FieldUrl; ++field) {
+        if (d->mDirtyFields & (Q_UINT64_C(1) << field)) {
+            fields.insert(static_cast<Field>(field));
+        }
+    }
+    return fields;
 }
 
 void IncidenceBase::setFieldDirty(IncidenceBase::Field field)
 {
-    d->mDirtyFields.insert(field);
+    d->setDirty(field);
 }
 
 QUrl IncidenceBase::uri() const
@@ -670,7 +762,17 @@ QUrl IncidenceBase::uri() const
 
 void IncidenceBase::setDirtyFields(const QSet<IncidenceBase::Field> &dirtyFields)
 {
-    d->mDirtyFields = dirtyFields;
+    d->mDirtyFields = 0;
+    for (Field field : dirtyFields) {
+        d->setDirty(field);
+    }
+}
+
+MemoryUsage IncidenceBase::memoryUsage() const
+{
+    MemoryAccounting accounting;
+    accounting.addIncidence(*this);
+    return accounting.usage();
 }
 
 /** static */
@@ -693,8 +795,8 @@ QDataStream &KCalCore::operator<<(QDataStream &out, const KCalCore::IncidenceBas
     serializeQDateTimeAsKDateTime(out, i->d->mLastModified);
     serializeQDateTimeAsKDateTime(out, i->d->mDtStart);
     out << i->organizer() << i->d->mUid << i->d->mDuration
-        << i->d->mAllDay << i->d->mHasDuration << i->d->mComments << i->d->mContacts
-        << i->d->mAttendees.count() << i->d->mUrl;
+        << i->d->mAllDay << i->d->mHasDuration << i->d->comments() << i->d->extra().mContacts
+        << i->d->mAttendees.count() << i->d->extra().mUrl;
 
     for (const Attendee::Ptr &attendee : qAsConst(i->d->mAttendees)) {
         out << attendee;
@@ -734,9 +836,13 @@ QDataStream &KCalCore::operator>>(QDataStream &in, const KCalCore::IncidenceBase
     in >> *(static_cast<CustomProperties *>(i.data()));
     deserializeKDateTimeAsQDateTime(in, i->d->mLastModified);
     deserializeKDateTimeAsQDateTime(in, i->d->mDtStart);
+    IncidenceBase::Private::Extra extra;
     in >> i->d->mOrganizer >> i->d->mUid >> i->d->mDuration
-       >> i->d->mAllDay >> i->d->mHasDuration >> i->d->mComments >> i->d->mContacts >> attendeeCount
-       >> i->d->mUrl;
+       >> i->d->mAllDay >> i->d->mHasDuration >> extra.mComments >> extra.mContacts >> attendeeCount
+       >> extra.mUrl;
+    if (i->d->mExtra || !extra.mComments.isEmpty() || !extra.mContacts.isEmpty() || !extra.mUrl.isEmpty()) {
+        i->d->writableExtra() = extra;
+    }
 
     i->d->mAttendees.clear();
     i->d->mAttendees.reserve(attendeeCount);
@@ -755,3 +861,34 @@ QDataStream &KCalCore::operator>>(QDataStream &in, const KCalCore::IncidenceBase
 IncidenceBase::IncidenceObserver::~IncidenceObserver()
 {
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addIncidenceBaseData(const IncidenceBase &incidence)
+{
+    const IncidenceBase::Private *d = incidence.d;
+    add(MemoryUsage::IncidenceObjects, sizeof(IncidenceBase::Private));
+    addCustomProperties(incidence, MemoryUsage::Strings);
+    addString(d->mUid, MemoryUsage::Strings);
+    if (d->mExtra) {
+        add(MemoryUsage::IncidenceObjects, sizeof(IncidenceBase::Private::Extra));
+        addStringList(d->mExtra->mComments, MemoryUsage::Strings);
+        addList(d->mExtra->mRawComments, MemoryUsage::Strings);
+        for (const QByteArray &comment : qAsConst(d->mExtra->mRawComments)) {
+            addByteArray(comment, MemoryUsage::Strings);
+        }
+        addStringList(d->mExtra->mContacts, MemoryUsage::Strings);
+        if (!d->mExtra->mUrl.isEmpty()) {
+            // QUrl keeps its components in separate strings
+            add(MemoryUsage::Strings, sizeof(QArrayData) + d->mExtra->mUrl.toString().size() * sizeof(QChar));
+        }
+    }
+    if (d->mOrganizer) {
+        addPerson(d->mOrganizer);
+    }
+    addVector(d->mAttendees, MemoryUsage::Persons);
+    for (const Attendee::Ptr &attendee : qAsConst(d->mAttendees)) {
+        addAttendee(attendee);
+    }
+    addList(d->mObservers, MemoryUsage::IncidenceObjects);
+}
+//@endcond
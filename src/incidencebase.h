@@ -59,6 +59,7 @@
 #include "attendee.h"
 #include "customproperties.h"
 #include "duration.h"
+#include "memoryusage.h"
 #include "sortablelist.h"
 
 #include <QDateTime>
@@ -84,6 +85,7 @@ class Event;
 class Todo;
 class Journal;
 class FreeBusy;
+class ICalFormatImpl;
 class Visitor;
 
 /**
@@ -677,6 +679,14 @@ public:
     */
     void resetDirtyFields();
 
+    /**
+      Returns an estimate of the memory retained by this incidence,
+      including its attendees, alarms, attachments and recurrence.
+      @see Calendar::memoryUsage()
+      @since 5.8
+    */
+    MemoryUsage memoryUsage() const;
+
     /**
      * Constant that identifies KCalCore data in a binary stream.
      *
@@ -747,6 +757,11 @@ protected:
 
 private:
     //@cond PRIVATE
+    // Adds a comment given in UTF-8, decoded on first access
+    void addCommentUtf8(const QByteArray &comment);
+
+    friend class ICalFormatImpl;
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
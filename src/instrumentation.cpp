@@ -0,0 +1,249 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and
+  defines the instrumentation counters and timers.
+*/
+#include "instrumentation.h"
+#include "instrumentation_p.h"
+
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QThread>
+
+#include <atomic>
+
+using namespace KCalCore;
+
+//@cond PRIVATE
+namespace
+{
+
+const char *const sCounterNames[] = {
+    "RecurrenceExpansions",
+    "RecurrenceCacheHits",
+    "RecurrenceCacheMisses",
+    "TimeZoneResolutions",
+    "DateTimeConversions",
+    "ObserverCallbacks"
+};
+Q_STATIC_ASSERT(sizeof(sCounterNames) / sizeof(sCounterNames[0]) == Instrumentation::CounterCount);
+
+const char *const sTimerNames[] = {
+    "LoadTimer",
+    "SaveTimer",
+    "PopulateTimer",
+    "TimesInIntervalTimer",
+    "RecursOnTimer",
+    "AlarmsTimer",
+    "FreeBusyInitTimer"
+};
+Q_STATIC_ASSERT(sizeof(sTimerNames) / sizeof(sTimerNames[0]) == Instrumentation::TimerCount);
+
+#ifdef KCALCORE_INSTRUMENTATION
+
+const int MaxTraceEvents = 1000000;
+
+struct TraceEvent {
+    Instrumentation::Timer timer;
+    quintptr thread;
+    qint64 startNanoseconds;
+    qint64 nanoseconds;
+};
+
+struct State {
+    State()
+    {
+        for (auto &counter : counters) {
+            counter = 0;
+        }
+        for (int i = 0; i < Instrumentation::TimerCount; ++i) {
+            timerCalls[i] = 0;
+            timerNanoseconds[i] = 0;
+        }
+        clock.start();
+    }
+
+    std::atomic<quint64> counters[Instrumentation::CounterCount];
+    std::atomic<quint64> timerCalls[Instrumentation::TimerCount];
+    std::atomic<quint64> timerNanoseconds[Instrumentation::TimerCount];
+
+    std::atomic<bool> tracing{false};
+    // Origin of the trace event timestamps
+    QElapsedTimer clock;
+    QMutex traceMutex;
+    QVector<TraceEvent> trace;
+};
+
+Q_GLOBAL_STATIC(State, sState)
+
+#endif
+
+}
+
+#ifdef KCALCORE_INSTRUMENTATION
+
+void Instrumentation::count(Counter counter)
+{
+    sState->counters[counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+Instrumentation::ScopedTimer::ScopedTimer(Timer timer)
+    : mTimer(timer)
+{
+    mElapsed.start();
+}
+
+Instrumentation::ScopedTimer::~ScopedTimer()
+{
+    const qint64 nanoseconds = mElapsed.nsecsElapsed();
+    State *state = sState;
+    state->timerCalls[mTimer].fetch_add(1, std::memory_order_relaxed);
+    state->timerNanoseconds[mTimer].fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    if (state->tracing.load(std::memory_order_relaxed)) {
+        const qint64 start = state->clock.nsecsElapsed() - nanoseconds;
+        const TraceEvent event = {
+            mTimer,
+            reinterpret_cast<quintptr>(QThread::currentThreadId()),
+            start,
+            nanoseconds
+        };
+        QMutexLocker lock(&state->traceMutex);
+        if (state->trace.size() < MaxTraceEvents) {
+            state->trace.append(event);
+        }
+    }
+}
+
+#endif
+//@endcond
+
+bool Instrumentation::isEnabled()
+{
+#ifdef KCALCORE_INSTRUMENTATION
+    return true;
+#else
+    return false;
+#endif
+}
+
+Instrumentation::Snapshot Instrumentation::snapshot()
+{
+    Snapshot result;
+    result.counters.fill(0, CounterCount);
+    result.timerCalls.fill(0, TimerCount);
+    result.timerNanoseconds.fill(0, TimerCount);
+#ifdef KCALCORE_INSTRUMENTATION
+    State *state = sState;
+    for (int i = 0; i < CounterCount; ++i) {
+        result.counters[i] = state->counters[i].load(std::memory_order_relaxed);
+    }
+    for (int i = 0; i < TimerCount; ++i) {
+        result.timerCalls[i] = state->timerCalls[i].load(std::memory_order_relaxed);
+        result.timerNanoseconds[i] = state->timerNanoseconds[i].load(std::memory_order_relaxed);
+    }
+#endif
+    return result;
+}
+
+void Instrumentation::reset()
+{
+#ifdef KCALCORE_INSTRUMENTATION
+    State *state = sState;
+    for (auto &counter : state->counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    for (int i = 0; i < TimerCount; ++i) {
+        state->timerCalls[i].store(0, std::memory_order_relaxed);
+        state->timerNanoseconds[i].store(0, std::memory_order_relaxed);
+    }
+    QMutexLocker lock(&state->traceMutex);
+    state->trace.clear();
+#endif
+}
+
+QString Instrumentation::counterName(Counter counter)
+{
+    if (counter < 0 || counter >= CounterCount) {
+        return QString();
+    }
+    return QString::fromLatin1(sCounterNames[counter]);
+}
+
+QString Instrumentation::timerName(Timer timer)
+{
+    if (timer < 0 || timer >= TimerCount) {
+        return QString();
+    }
+    return QString::fromLatin1(sTimerNames[timer]);
+}
+
+void Instrumentation::setTracingEnabled(bool enabled)
+{
+#ifdef KCALCORE_INSTRUMENTATION
+    sState->tracing.store(enabled);
+#else
+    Q_UNUSED(enabled);
+#endif
+}
+
+bool Instrumentation::tracingEnabled()
+{
+#ifdef KCALCORE_INSTRUMENTATION
+    return sState->tracing.load();
+#else
+    return false;
+#endif
+}
+
+QByteArray Instrumentation::traceJson()
+{
+    QJsonArray events;
+#ifdef KCALCORE_INSTRUMENTATION
+    State *state = sState;
+    QVector<TraceEvent> trace;
+    {
+        QMutexLocker lock(&state->traceMutex);
+        trace = state->trace;
+    }
+    const qint64 pid = QCoreApplication::applicationPid();
+    for (const TraceEvent &event : qAsConst(trace)) {
+        // Complete events, with timestamps in microseconds
+        events.append(QJsonObject {
+            { QStringLiteral("name"), QLatin1String(sTimerNames[event.timer]) },
+            { QStringLiteral("cat"), QStringLiteral("kcalcore") },
+            { QStringLiteral("ph"), QStringLiteral("X") },
+            { QStringLiteral("ts"), double(event.startNanoseconds) / 1000 },
+            { QStringLiteral("dur"), double(event.nanoseconds) / 1000 },
+            { QStringLiteral("pid"), double(pid) },
+            { QStringLiteral("tid"), double(event.thread) }
+        });
+    }
+#endif
+    const QJsonObject document {
+        { QStringLiteral("traceEvents"), events },
+        { QStringLiteral("displayTimeUnit"), QStringLiteral("ns") }
+    };
+    return QJsonDocument(document).toJson(QJsonDocument::Compact);
+}
@@ -0,0 +1,141 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and provides
+  access to the counters and timers of the library's hot paths.
+*/
+#ifndef KCALCORE_INSTRUMENTATION_H
+#define KCALCORE_INSTRUMENTATION_H
+
+#include "kcalcore_export.h"
+
+#include <QString>
+#include <QVector>
+
+namespace KCalCore
+{
+
+/**
+  @brief
+  Counters and timers of the library's hot paths.
+
+  The library only collects them when it is built with the
+  KCALCORE_INSTRUMENTATION CMake option; otherwise isEnabled() returns
+  false, the instrumentation compiles to nothing and all counters stay zero.
+
+  Counters and timers are process wide and updated atomically, so they
+  may be read while other threads use the library. When tracing is
+  enabled, every timed section additionally records a trace event, which
+  traceJson() exports in the Chrome trace event format (see
+  chrome://tracing or https://ui.perfetto.dev).
+
+  @since 5.8
+*/
+namespace Instrumentation
+{
+
+/**
+  The events which are counted.
+*/
+enum Counter {
+    RecurrenceExpansions,  /**< Occurrences of a recurrence rule computed for one interval */
+    RecurrenceCacheHits,   /**< Lookups answered by a recurrence rule's occurrence cache */
+    RecurrenceCacheMisses, /**< Occurrence caches of recurrence rules (re)built */
+    TimeZoneResolutions,   /**< iCalendar time zones resolved to a QTimeZone */
+    DateTimeConversions,   /**< Date-times converted between libical and QDateTime */
+    ObserverCallbacks,     /**< Calls of CalendarObserver methods */
+    CounterCount
+};
+
+/**
+  The sections which are timed.
+*/
+enum Timer {
+    LoadTimer,             /**< ICalFormat parsing a calendar */
+    SaveTimer,             /**< ICalFormat writing a calendar */
+    PopulateTimer,         /**< Adding the parsed incidences to a calendar */
+    TimesInIntervalTimer,  /**< RecurrenceRule::timesInInterval() */
+    RecursOnTimer,         /**< Recurrence::recursOn() */
+    AlarmsTimer,           /**< MemoryCalendar::alarms() */
+    FreeBusyInitTimer,     /**< Building a FreeBusy from events */
+    TimerCount
+};
+
+/**
+  The counters and timers at one point in time.
+*/
+struct KCALCORE_EXPORT Snapshot {
+    /** The counters, indexed by Counter */
+    QVector<quint64> counters;
+    /** How often each section was entered, indexed by Timer */
+    QVector<quint64> timerCalls;
+    /** The time spent in each section in nanoseconds, indexed by Timer */
+    QVector<quint64> timerNanoseconds;
+};
+
+/**
+  Returns true if the library was built with instrumentation.
+*/
+KCALCORE_EXPORT bool isEnabled();
+
+/**
+  Returns the current counters and timers.
+*/
+KCALCORE_EXPORT Snapshot snapshot();
+
+/**
+  Resets all counters and timers to zero and discards the recorded trace
+  events.
+*/
+KCALCORE_EXPORT void reset();
+
+/**
+  Returns the name of @p counter, e.g. "RecurrenceCacheHits".
+*/
+KCALCORE_EXPORT QString counterName(Counter counter);
+
+/**
+  Returns the name of @p timer, e.g. "LoadTimer".
+*/
+KCALCORE_EXPORT QString timerName(Timer timer);
+
+/**
+  Sets whether timed sections record trace events. Tracing is disabled
+  by default, and has no effect if isEnabled() is false.
+
+  At most a million events are kept; later events are dropped.
+*/
+KCALCORE_EXPORT void setTracingEnabled(bool enabled);
+
+/**
+  Returns true if timed sections record trace events.
+*/
+KCALCORE_EXPORT bool tracingEnabled();
+
+/**
+  Returns the recorded trace events as a Chrome trace event JSON document.
+*/
+KCALCORE_EXPORT QByteArray traceJson();
+
+}
+
+}
+
+#endif
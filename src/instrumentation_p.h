@@ -0,0 +1,73 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+#ifndef KCALCORE_INSTRUMENTATION_P_H
+#define KCALCORE_INSTRUMENTATION_P_H
+
+#include "instrumentation.h"
+
+#include <QElapsedTimer>
+
+//@cond PRIVATE
+/*
+  KCALCORE_COUNT(counter) increments an Instrumentation::Counter and
+  KCALCORE_TIME(timer) times the rest of the enclosing scope as an
+  Instrumentation::Timer. Both compile to nothing unless the library is
+  built with KCALCORE_INSTRUMENTATION.
+*/
+#ifdef KCALCORE_INSTRUMENTATION
+
+namespace KCalCore
+{
+namespace Instrumentation
+{
+
+void count(Counter counter);
+
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Timer timer);
+    ~ScopedTimer();
+
+private:
+    Q_DISABLE_COPY(ScopedTimer)
+    Timer mTimer;
+    QElapsedTimer mElapsed;
+};
+
+}
+}
+
+#define KCALCORE_INSTRUMENTATION_CONCAT2(a, b) a##b
+#define KCALCORE_INSTRUMENTATION_CONCAT(a, b) KCALCORE_INSTRUMENTATION_CONCAT2(a, b)
+#define KCALCORE_COUNT(counter) \
+    KCalCore::Instrumentation::count(KCalCore::Instrumentation::counter)
+#define KCALCORE_TIME(timer) \
+    const KCalCore::Instrumentation::ScopedTimer \
+    KCALCORE_INSTRUMENTATION_CONCAT(kcalcoreScopedTimer, __LINE__)(KCalCore::Instrumentation::timer)
+
+#else
+
+#define KCALCORE_COUNT(counter) do {} while (false)
+#define KCALCORE_TIME(timer) do {} while (false)
+
+#endif
+//@endcond
+
+#endif
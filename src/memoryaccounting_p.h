@@ -0,0 +1,155 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+#ifndef KCALCORE_MEMORYACCOUNTING_P_H
+#define KCALCORE_MEMORYACCOUNTING_P_H
+
+#include "alarm.h"
+#include "attachment.h"
+#include "attendee.h"
+#include "memoryusage.h"
+#include "person.h"
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+
+namespace KCalCore
+{
+
+//@cond PRIVATE
+class Calendar;
+class CustomProperties;
+class Event;
+class Incidence;
+class IncidenceBase;
+class MemoryCalendar;
+class Recurrence;
+class RecurrenceRule;
+class Todo;
+
+/**
+  Collects a MemoryUsage.
+
+  Each add function is defined next to the class it measures, which
+  declares MemoryAccounting a friend. Shared data is only counted the
+  first time it is added.
+*/
+class MemoryAccounting
+{
+public:
+    MemoryUsage usage() const
+    {
+        return mUsage;
+    }
+
+    void add(MemoryUsage::Category category, qint64 bytes)
+    {
+        mUsage.addBytes(category, bytes);
+    }
+
+    // Returns true the first time it is called for @p data
+    bool firstTime(const void *data)
+    {
+        if (!data || mSeen.contains(data)) {
+            return false;
+        }
+        mSeen.insert(data);
+        return true;
+    }
+
+    void addString(const QString &string, MemoryUsage::Category category);
+    void addByteArray(const QByteArray &array, MemoryUsage::Category category);
+    void addStringList(const QStringList &list, MemoryUsage::Category category);
+
+    // The heap blocks of containers, without what their elements point to
+    template<typename T>
+    void addList(const QList<T> &list, MemoryUsage::Category category)
+    {
+        if (list.isEmpty() || !firstTime(&list.first())) {
+            return;
+        }
+        add(category, qint64(list.size()) * sizeof(void *) + sizeof(QListData::Data));
+        if (QTypeInfo<T>::isLarge || QTypeInfo<T>::isStatic) {
+            add(category, qint64(list.size()) * sizeof(T));
+        }
+    }
+
+    template<typename T>
+    void addVector(const QVector<T> &vector, MemoryUsage::Category category)
+    {
+        if (vector.capacity() == 0 || !firstTime(vector.constData())) {
+            return;
+        }
+        add(category, qint64(vector.capacity()) * sizeof(T) + sizeof(QArrayData));
+    }
+
+    template<typename K, typename V>
+    void addHash(const QHash<K, V> &hash, MemoryUsage::Category category)
+    {
+        if (hash.capacity() == 0) {
+            return;
+        }
+        add(category, qint64(hash.capacity()) * sizeof(void *) + sizeof(QHashData)
+            + qint64(hash.size()) * sizeof(QHashNode<K, V>));
+    }
+
+    template<typename K, typename V>
+    void addMap(const QMap<K, V> &map, MemoryUsage::Category category)
+    {
+        add(category, sizeof(QMapDataBase) + qint64(map.size()) * sizeof(QMapNode<K, V>));
+    }
+
+    template<typename T>
+    void addSet(const QSet<T> &set, MemoryUsage::Category category)
+    {
+        if (set.capacity() == 0) {
+            return;
+        }
+        add(category, qint64(set.capacity()) * sizeof(void *) + sizeof(QHashData)
+            + qint64(set.size()) * sizeof(QHashNode<T, QHashDummyValue>));
+    }
+
+    // Defined in the files of the classes
+    void addIncidence(const IncidenceBase &incidence);      // memoryusage.cpp
+    void addIncidenceBaseData(const IncidenceBase &incidence); // incidencebase.cpp
+    void addIncidenceData(const Incidence &incidence);      // incidence.cpp
+    void addEventData(const Event &event);                  // event.cpp
+    void addTodoData(const Todo &todo);                     // todo.cpp
+    void addCustomProperties(const CustomProperties &properties,
+                             MemoryUsage::Category category); // customproperties.cpp
+    void addPerson(const Person::Ptr &person);              // person.cpp
+    void addAttendee(const Attendee::Ptr &attendee);        // attendee.cpp
+    void addAlarm(const Alarm::Ptr &alarm);                 // alarm.cpp
+    void addAttachment(const Attachment::Ptr &attachment);  // attachment.cpp
+    void addRecurrence(const Recurrence &recurrence);       // recurrence.cpp
+    void addRecurrenceRule(const RecurrenceRule &rule);     // recurrencerule.cpp
+    void addCalendar(const Calendar &calendar);             // calendar.cpp
+    void addMemoryCalendar(const MemoryCalendar &calendar); // memorycalendar.cpp
+
+private:
+    MemoryUsage mUsage;
+    QSet<const void *> mSeen;
+};
+//@endcond
+
+}
+
+#endif
@@ -33,11 +33,18 @@
  */
 
 #include "memorycalendar.h"
+#include "calendar_p.h"
+#include "instrumentation_p.h"
+#include "memoryaccounting_p.h"
 #include "kcalcore_debug.h"
 #include "utils.h"
 #include "calformat.h"
 
+#include <QBitArray>
 #include <QDate>
+#include <QMutex>
+
+#include <typeinfo>
 
 template <typename K, typename V>
 static QVector<V> values(const QMultiHash<K, V> &c)
@@ -62,8 +69,48 @@ static  QVector<V> values(const QMultiHash<K, V> &c, const K &x)
     return v;
 }
 
+/**
+  Like QMap::value(), but returns a reference. Unlike QMap::operator[], it
+  never inserts into the map, so it is safe in const query methods.
+*/
+template <typename K, typename V>
+static const V &constValue(const QMap<K, V> &c, const K &key)
+{
+    static const V empty;
+    const typename QMap<K, V>::const_iterator it = c.constFind(key);
+    return it != c.constEnd() ? it.value() : empty;
+}
+
 using namespace KCalCore;
 
+// Number of days whose recurrences rawEventsForDate() looks up at once.
+// Recurrence::recursOnDates() keeps the last result, so the queries for the
+// other days of the window, e.g. those of a month view, reuse it.
+static const int DAYS_WINDOW_SIZE = 64;
+
+/**
+  Returns the incidence with the given uid and recurrenceId from @p incidences,
+  which is indexed by uid.
+*/
+static Incidence::Ptr findIncidence(const QMultiHash<QString, Incidence::Ptr> &incidences,
+                                    const QString &uid, const QDateTime &recurrenceId)
+{
+    Incidence::List values = ::values(incidences, uid);
+    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+        Incidence::Ptr i = *it;
+        if (recurrenceId.isNull()) {
+            if (!i->hasRecurrenceId()) {
+                return i;
+            }
+        } else {
+            if (i->hasRecurrenceId() && i->recurrenceId() == recurrenceId) {
+                return i;
+            }
+        }
+    }
+    return Incidence::Ptr();
+}
+
 /**
   Private class that helps to provide binary compatibility between releases.
   @internal
@@ -114,6 +161,7 @@ public:
      */
     QMap<IncidenceBase::IncidenceType, QMultiHash<QString, IncidenceBase::Ptr> > mIncidencesForDate;
 
+    void reserve(const Incidence::List &incidences);
     void insertIncidence(const Incidence::Ptr &incidence);
 
     Incidence::Ptr incidence(const QString &uid,
@@ -126,6 +174,31 @@ public:
 
     void deleteAllIncidences(const IncidenceBase::IncidenceType type);
 
+    // The last published snapshot, created on demand; guarded by mSnapshotMutex
+    QMutex mSnapshotMutex;
+    Snapshot::Ptr mSnapshot;
+};
+
+class Q_DECL_HIDDEN KCalCore::MemoryCalendar::Snapshot::Private
+{
+public:
+    quint64 mVersion = 0;
+
+    // Shallow copies of the containers of MemoryCalendar::Private
+    QMap<IncidenceBase::IncidenceType, QMultiHash<QString, Incidence::Ptr> > mIncidences;
+    QHash<QString, Incidence::Ptr> mIncidencesByIdentifier;
+
+    template<typename List>
+    List rawIncidences(IncidenceBase::IncidenceType type) const
+    {
+        const QMultiHash<QString, Incidence::Ptr> incidences = mIncidences.value(type);
+        List list;
+        list.reserve(incidences.size());
+        for (auto it = incidences.cbegin(), end = incidences.cend(); it != end; ++it) {
+            list.append(it.value().staticCast<typename List::value_type::Type>());
+        }
+        return list;
+    }
 };
 //@endcond
 
@@ -238,20 +311,7 @@ Incidence::Ptr MemoryCalendar::Private::incidence(const QString &uid,
         const Incidence::IncidenceType type,
         const QDateTime &recurrenceId) const
 {
-    Incidence::List values = ::values(mIncidences[type], uid);
-    for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
-        Incidence::Ptr i = *it;
-        if (recurrenceId.isNull()) {
-            if (!i->hasRecurrenceId()) {
-                return i;
-            }
-        } else {
-            if (i->hasRecurrenceId() && i->recurrenceId() == recurrenceId) {
-                return i;
-            }
-        }
-    }
-    return Incidence::Ptr();
+    return findIncidence(constValue(mIncidences, type), uid, recurrenceId);
 }
 
 Incidence::Ptr
@@ -263,7 +323,7 @@ MemoryCalendar::Private::deletedIncidence(const QString &uid,
         return Incidence::Ptr();
     }
 
-    Incidence::List values = ::values(mDeletedIncidences[type], uid);
+    Incidence::List values = ::values(constValue(mDeletedIncidences, type), uid);
     for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
         Incidence::Ptr i = *it;
         if (recurrenceId.isNull()) {
@@ -279,6 +339,27 @@ MemoryCalendar::Private::deletedIncidence(const QString &uid,
     return Incidence::Ptr();
 }
 
+void MemoryCalendar::Private::reserve(const Incidence::List &incidences)
+{
+    int counts[IncidenceBase::TypeUnknown + 1] = {};
+    for (const Incidence::Ptr &incidence : incidences) {
+        if (incidence) {
+            ++counts[incidence->type()];
+        }
+    }
+
+    for (int type = 0; type <= IncidenceBase::TypeUnknown; ++type) {
+        if (counts[type] > 0) {
+            const auto t = static_cast<IncidenceBase::IncidenceType>(type);
+            QMultiHash<QString, Incidence::Ptr> &byUid = mIncidences[t];
+            byUid.reserve(byUid.size() + counts[type]);
+            QMultiHash<QString, IncidenceBase::Ptr> &byDate = mIncidencesForDate[t];
+            byDate.reserve(byDate.size() + counts[type]);
+        }
+    }
+    mIncidencesByIdentifier.reserve(mIncidencesByIdentifier.size() + incidences.count());
+}
+
 void MemoryCalendar::Private::insertIncidence(const Incidence::Ptr &incidence)
 {
     const QString uid = incidence->uid();
@@ -316,6 +397,30 @@ bool MemoryCalendar::addIncidence(const Incidence::Ptr &incidence)
     return true;
 }
 
+// Calendar::addIncidences() for a plain MemoryCalendar, see virtual_hook()
+bool MemoryCalendar::insertIncidences(const Incidence::List &incidences)
+{
+    d->reserve(incidences);
+    bool success = true;
+    for (const Incidence::Ptr &incidence : incidences) {
+        if (!incidence) {
+            success = false;
+            continue;
+        }
+        d->insertIncidence(incidence);
+        notifyIncidenceAdded(incidence);
+        incidence->registerObserver(this);
+    }
+
+    // Once all incidences are in, so parents don't have to wait as orphans
+    for (const Incidence::Ptr &incidence : incidences) {
+        setupRelations(incidence);
+    }
+
+    setModified(true);
+    return success;
+}
+
 bool MemoryCalendar::addEvent(const Event::Ptr &event)
 {
     return addIncidence(event);
@@ -373,8 +478,8 @@ Todo::List MemoryCalendar::rawTodos(TodoSortField sortField,
                                     SortDirection sortDirection) const
 {
     Todo::List todoList;
-    todoList.reserve(d->mIncidences[Incidence::TypeTodo].count());
-    QHashIterator<QString, Incidence::Ptr>i(d->mIncidences[Incidence::TypeTodo]);
+    todoList.reserve(constValue(d->mIncidences, Incidence::TypeTodo).count());
+    QHashIterator<QString, Incidence::Ptr>i(constValue(d->mIncidences, Incidence::TypeTodo));
     while (i.hasNext()) {
         i.next();
         todoList.append(i.value().staticCast<Todo>());
@@ -390,8 +495,8 @@ Todo::List MemoryCalendar::deletedTodos(TodoSortField sortField,
     }
 
     Todo::List todoList;
-    todoList.reserve(d->mDeletedIncidences[Incidence::TypeTodo].count());
-    QHashIterator<QString, Incidence::Ptr >i(d->mDeletedIncidences[Incidence::TypeTodo]);
+    todoList.reserve(constValue(d->mDeletedIncidences, Incidence::TypeTodo).count());
+    QHashIterator<QString, Incidence::Ptr >i(constValue(d->mDeletedIncidences, Incidence::TypeTodo));
     while (i.hasNext()) {
         i.next();
         todoList.append(i.value().staticCast<Todo>());
@@ -405,7 +510,7 @@ Todo::List MemoryCalendar::todoInstances(const Incidence::Ptr &todo,
 {
     Todo::List list;
 
-    Incidence::List values = ::values(d->mIncidences[Incidence::TypeTodo], todo->uid());
+    Incidence::List values = ::values(constValue(d->mIncidences, Incidence::TypeTodo), todo->uid());
     for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
         Todo::Ptr t = (*it).staticCast<Todo>();
         if (t->hasRecurrenceId()) {
@@ -422,15 +527,15 @@ Todo::List MemoryCalendar::rawTodosForDate(const QDate &date) const
 
     const QString dateStr = date.toString();
     QMultiHash<QString, IncidenceBase::Ptr >::const_iterator it =
-        d->mIncidencesForDate[Incidence::TypeTodo].constFind(dateStr);
-    while (it != d->mIncidencesForDate[Incidence::TypeTodo].constEnd() && it.key() == dateStr) {
+        constValue(d->mIncidencesForDate, Incidence::TypeTodo).constFind(dateStr);
+    while (it != constValue(d->mIncidencesForDate, Incidence::TypeTodo).constEnd() && it.key() == dateStr) {
         t = it.value().staticCast<Todo>();
         todoList.append(t);
         ++it;
     }
 
     // Iterate over all todos. Look for recurring todoss that occur on this date
-    QHashIterator<QString, Incidence::Ptr >i(d->mIncidences[Incidence::TypeTodo]);
+    QHashIterator<QString, Incidence::Ptr >i(constValue(d->mIncidences, Incidence::TypeTodo));
     while (i.hasNext()) {
         i.next();
         t = i.value().staticCast<Todo>();
@@ -457,7 +562,7 @@ Todo::List MemoryCalendar::rawTodos(const QDate &start,
     QDateTime nd(end, QTime(23, 59, 59, 999), ts);
 
     // Get todos
-    QHashIterator<QString, Incidence::Ptr >i(d->mIncidences[Incidence::TypeTodo]);
+    QHashIterator<QString, Incidence::Ptr >i(constValue(d->mIncidences, Incidence::TypeTodo));
     Todo::Ptr todo;
     while (i.hasNext()) {
         i.next();
@@ -510,8 +615,9 @@ Alarm::List MemoryCalendar::alarmsTo(const QDateTime &to) const
 Alarm::List MemoryCalendar::alarms(const QDateTime &from, const QDateTime &to, bool excludeBlockedAlarms) const
 {
     Q_UNUSED(excludeBlockedAlarms);
+    KCALCORE_TIME(AlarmsTimer);
     Alarm::List alarmList;
-    QHashIterator<QString, Incidence::Ptr>ie(d->mIncidences[Incidence::TypeEvent]);
+    QHashIterator<QString, Incidence::Ptr>ie(constValue(d->mIncidences, Incidence::TypeEvent));
     Event::Ptr e;
     while (ie.hasNext()) {
         ie.next();
@@ -523,7 +629,7 @@ Alarm::List MemoryCalendar::alarms(const QDateTime &from, const QDateTime &to, b
         }
     }
 
-    QHashIterator<QString, Incidence::Ptr>it(d->mIncidences[Incidence::TypeTodo]);
+    QHashIterator<QString, Incidence::Ptr>it(constValue(d->mIncidences, Incidence::TypeTodo));
     Todo::Ptr t;
     while (it.hasNext()) {
         it.next();
@@ -612,10 +718,10 @@ Event::List MemoryCalendar::rawEventsForDate(const QDate &date,
     // Find the hash for the specified date
     const QString dateStr = date.toString();
     QMultiHash<QString, IncidenceBase::Ptr >::const_iterator it =
-        d->mIncidencesForDate[Incidence::TypeEvent].constFind(dateStr);
+        constValue(d->mIncidencesForDate, Incidence::TypeEvent).constFind(dateStr);
     // Iterate over all non-recurring, single-day events that start on this date
     const auto ts = timeZone.isValid() ? timeZone : this->timeZone();
-    while (it != d->mIncidencesForDate[Incidence::TypeEvent].constEnd() && it.key() == dateStr) {
+    while (it != constValue(d->mIncidencesForDate, Incidence::TypeEvent).constEnd() && it.key() == dateStr) {
         ev = it.value().staticCast<Event>();
         QDateTime end(ev->dtEnd().toTimeZone(ev->dtStart().timeZone()));
         if (ev->allDay()) {
@@ -629,23 +735,26 @@ Event::List MemoryCalendar::rawEventsForDate(const QDate &date,
         ++it;
     }
 
+    // The window of days containing date, aligned so that the queries for
+    // neighbouring dates use the same one
+    const qint64 julianDay = date.toJulianDay();
+    const QDate windowStart = QDate::fromJulianDay(julianDay - julianDay % DAYS_WINDOW_SIZE);
+    const QDate windowEnd = windowStart.addDays(DAYS_WINDOW_SIZE - 1);
+    const int dateIndex = int(windowStart.daysTo(date));
+
     // Iterate over all events. Look for recurring events that occur on this date
-    QHashIterator<QString, Incidence::Ptr>i(d->mIncidences[Incidence::TypeEvent]);
+    QHashIterator<QString, Incidence::Ptr>i(constValue(d->mIncidences, Incidence::TypeEvent));
     while (i.hasNext()) {
         i.next();
         ev = i.value().staticCast<Event>();
         if (ev->recurs()) {
-            if (ev->isMultiDay()) {
-                int extraDays = ev->dtStart().date().daysTo(ev->dtEnd().date());
-                for (int i = 0; i <= extraDays; ++i) {
-                    if (ev->recursOn(date.addDays(-i), ts)) {
-                        eventList.append(ev);
-                        break;
-                    }
-                }
-            } else {
-                if (ev->recursOn(date, ts)) {
+            // Check all days on which an occurrence covering date may start
+            const int extraDays = ev->isMultiDay() ? int(ev->dtStart().date().daysTo(ev->dtEnd().date())) : 0;
+            const QBitArray days = ev->recurrence()->recursOnDates(windowStart.addDays(-extraDays), windowEnd, ts);
+            for (int day = dateIndex; day <= dateIndex + extraDays; ++day) {
+                if (days.testBit(day)) {
                     eventList.append(ev);
+                    break;
                 }
             }
         } else {
@@ -672,7 +781,7 @@ Event::List MemoryCalendar::rawEvents(const QDate &start,
     QDateTime yesterStart = st.addDays(-1);
 
     // Get non-recurring events
-    QHashIterator<QString, Incidence::Ptr>i(d->mIncidences[Incidence::TypeEvent]);
+    QHashIterator<QString, Incidence::Ptr>i(constValue(d->mIncidences, Incidence::TypeEvent));
     Event::Ptr event;
     while (i.hasNext()) {
         i.next();
@@ -731,8 +840,8 @@ Event::List MemoryCalendar::rawEvents(EventSortField sortField,
                                       SortDirection sortDirection) const
 {
     Event::List eventList;
-    eventList.reserve(d->mIncidences[Incidence::TypeEvent].count());
-    QHashIterator<QString, Incidence::Ptr> i(d->mIncidences[Incidence::TypeEvent]);
+    eventList.reserve(constValue(d->mIncidences, Incidence::TypeEvent).count());
+    QHashIterator<QString, Incidence::Ptr> i(constValue(d->mIncidences, Incidence::TypeEvent));
     while (i.hasNext()) {
         i.next();
         eventList.append(i.value().staticCast<Event>());
@@ -748,8 +857,8 @@ Event::List MemoryCalendar::deletedEvents(EventSortField sortField,
     }
 
     Event::List eventList;
-    eventList.reserve(d->mDeletedIncidences[Incidence::TypeEvent].count());
-    QHashIterator<QString, Incidence::Ptr>i(d->mDeletedIncidences[Incidence::TypeEvent]);
+    eventList.reserve(constValue(d->mDeletedIncidences, Incidence::TypeEvent).count());
+    QHashIterator<QString, Incidence::Ptr>i(constValue(d->mDeletedIncidences, Incidence::TypeEvent));
     while (i.hasNext()) {
         i.next();
         eventList.append(i.value().staticCast<Event>());
@@ -763,7 +872,7 @@ Event::List MemoryCalendar::eventInstances(const Incidence::Ptr &event,
 {
     Event::List list;
 
-    Incidence::List values = ::values(d->mIncidences[Incidence::TypeEvent], event->uid());
+    Incidence::List values = ::values(constValue(d->mIncidences, Incidence::TypeEvent), event->uid());
     for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
         Event::Ptr ev = (*it).staticCast<Event>();
         if (ev->hasRecurrenceId()) {
@@ -803,7 +912,7 @@ Journal::List MemoryCalendar::rawJournals(JournalSortField sortField,
         SortDirection sortDirection) const
 {
     Journal::List journalList;
-    QHashIterator<QString, Incidence::Ptr>i(d->mIncidences[Incidence::TypeJournal]);
+    QHashIterator<QString, Incidence::Ptr>i(constValue(d->mIncidences, Incidence::TypeJournal));
     while (i.hasNext()) {
         i.next();
         journalList.append(i.value().staticCast<Journal>());
@@ -819,8 +928,8 @@ Journal::List MemoryCalendar::deletedJournals(JournalSortField sortField,
     }
 
     Journal::List journalList;
-    journalList.reserve(d->mDeletedIncidences[Incidence::TypeJournal].count());
-    QHashIterator<QString, Incidence::Ptr>i(d->mDeletedIncidences[Incidence::TypeJournal]);
+    journalList.reserve(constValue(d->mDeletedIncidences, Incidence::TypeJournal).count());
+    QHashIterator<QString, Incidence::Ptr>i(constValue(d->mDeletedIncidences, Incidence::TypeJournal));
     while (i.hasNext()) {
         i.next();
         journalList.append(i.value().staticCast<Journal>());
@@ -834,7 +943,7 @@ Journal::List MemoryCalendar::journalInstances(const Incidence::Ptr &journal,
 {
     Journal::List list;
 
-    Incidence::List values = ::values(d->mIncidences[Incidence::TypeJournal], journal->uid());
+    Incidence::List values = ::values(constValue(d->mIncidences, Incidence::TypeJournal), journal->uid());
     for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
         Journal::Ptr j = (*it).staticCast<Journal>();
         if (j->hasRecurrenceId()) {
@@ -851,9 +960,9 @@ Journal::List MemoryCalendar::rawJournalsForDate(const QDate &date) const
 
     QString dateStr = date.toString();
     QMultiHash<QString, IncidenceBase::Ptr >::const_iterator it =
-        d->mIncidencesForDate[Incidence::TypeJournal].constFind(dateStr);
+        constValue(d->mIncidencesForDate, Incidence::TypeJournal).constFind(dateStr);
 
-    while (it != d->mIncidencesForDate[Incidence::TypeJournal].constEnd() && it.key() == dateStr) {
+    while (it != constValue(d->mIncidencesForDate, Incidence::TypeJournal).constEnd() && it.key() == dateStr) {
         j = it.value().staticCast<Journal>();
         journalList.append(j);
         ++it;
@@ -866,9 +975,155 @@ Incidence::Ptr MemoryCalendar::instance(const QString &identifier) const
     return d->mIncidencesByIdentifier.value(identifier);
 }
 
+void MemoryCalendar::publishSnapshot()
+{
+    Snapshot::Ptr current = snapshot();
+
+    Snapshot *snapshot = new Snapshot;
+    snapshot->d->mVersion = current->version() + 1;
+    snapshot->d->mIncidences = d->mIncidences;
+    snapshot->d->mIncidencesByIdentifier = d->mIncidencesByIdentifier;
+
+    QMutexLocker locker(&d->mSnapshotMutex);
+    d->mSnapshot = Snapshot::Ptr(snapshot);
+}
+
+MemoryCalendar::Snapshot::Ptr MemoryCalendar::snapshot() const
+{
+    QMutexLocker locker(&d->mSnapshotMutex);
+    if (!d->mSnapshot) {
+        d->mSnapshot = Snapshot::Ptr(new Snapshot);
+    }
+    return d->mSnapshot;
+}
+
+MemoryCalendar::Snapshot::Snapshot()
+    : d(new KCalCore::MemoryCalendar::Snapshot::Private)
+{
+}
+
+MemoryCalendar::Snapshot::~Snapshot()
+{
+    delete d;
+}
+
+quint64 MemoryCalendar::Snapshot::version() const
+{
+    return d->mVersion;
+}
+
+Event::List MemoryCalendar::Snapshot::rawEvents(EventSortField sortField,
+                                                SortDirection sortDirection) const
+{
+    return Calendar::sortEvents(d->rawIncidences<Event::List>(Incidence::TypeEvent),
+                                sortField, sortDirection);
+}
+
+Todo::List MemoryCalendar::Snapshot::rawTodos(TodoSortField sortField,
+                                              SortDirection sortDirection) const
+{
+    return Calendar::sortTodos(d->rawIncidences<Todo::List>(Incidence::TypeTodo),
+                               sortField, sortDirection);
+}
+
+Journal::List MemoryCalendar::Snapshot::rawJournals(JournalSortField sortField,
+                                                    SortDirection sortDirection) const
+{
+    return Calendar::sortJournals(d->rawIncidences<Journal::List>(Incidence::TypeJournal),
+                                  sortField, sortDirection);
+}
+
+Incidence::List MemoryCalendar::Snapshot::rawIncidences() const
+{
+    return Calendar::mergeIncidenceList(rawEvents(), rawTodos(), rawJournals());
+}
+
+Incidence::Ptr MemoryCalendar::Snapshot::incidence(const QString &uid,
+                                                   const QDateTime &recurrenceId) const
+{
+    for (auto type : { Incidence::TypeEvent, Incidence::TypeTodo, Incidence::TypeJournal }) {
+        const Incidence::Ptr i = findIncidence(d->mIncidences.value(type), uid, recurrenceId);
+        if (i) {
+            return i;
+        }
+    }
+    return Incidence::Ptr();
+}
+
+Event::Ptr MemoryCalendar::Snapshot::event(const QString &uid,
+                                           const QDateTime &recurrenceId) const
+{
+    return findIncidence(d->mIncidences.value(Incidence::TypeEvent), uid, recurrenceId).staticCast<Event>();
+}
+
+Todo::Ptr MemoryCalendar::Snapshot::todo(const QString &uid,
+                                         const QDateTime &recurrenceId) const
+{
+    return findIncidence(d->mIncidences.value(Incidence::TypeTodo), uid, recurrenceId).staticCast<Todo>();
+}
+
+Journal::Ptr MemoryCalendar::Snapshot::journal(const QString &uid,
+                                               const QDateTime &recurrenceId) const
+{
+    return findIncidence(d->mIncidences.value(Incidence::TypeJournal), uid, recurrenceId).staticCast<Journal>();
+}
+
+Incidence::Ptr MemoryCalendar::Snapshot::instance(const QString &identifier) const
+{
+    return d->mIncidencesByIdentifier.value(identifier);
+}
+
 void MemoryCalendar::virtual_hook(int id, void *data)
 {
-    Q_UNUSED(id);
-    Q_UNUSED(data);
-    Q_ASSERT(false);
+    switch (id) {
+    case AddIncidencesHook:
+        // Subclasses may reimplement addEvent() etc., so they keep the
+        // default of adding one incidence at a time
+        if (typeid(*this) == typeid(MemoryCalendar)) {
+            AddIncidencesHookData *hookData = static_cast<AddIncidencesHookData *>(data);
+            hookData->success = insertIncidences(*hookData->incidences);
+            hookData->handled = true;
+        }
+        break;
+    case MemoryUsageHook:
+        static_cast<MemoryAccounting *>(data)->addMemoryCalendar(*this);
+        break;
+    default:
+        Calendar::virtual_hook(id, data);
+    }
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addMemoryCalendar(const MemoryCalendar &calendar)
+{
+    const MemoryCalendar::Private *d = calendar.d;
+    const auto indexes = MemoryUsage::CalendarIndexes;
+
+    add(indexes, sizeof(MemoryCalendar::Private));
+    addString(d->mIncidenceBeingUpdated, indexes);
+
+    addMap(d->mIncidences, indexes);
+    for (const auto &incidences : d->mIncidences) {
+        addHash(incidences, indexes);
+    }
+    addHash(d->mIncidencesByIdentifier, indexes);
+    for (auto it = d->mIncidencesByIdentifier.cbegin(), end = d->mIncidencesByIdentifier.cend(); it != end; ++it) {
+        addString(it.key(), indexes);
+    }
+    addMap(d->mIncidencesForDate, indexes);
+    for (const auto &incidences : d->mIncidencesForDate) {
+        addHash(incidences, indexes);
+        for (auto it = incidences.cbegin(), end = incidences.cend(); it != end; ++it) {
+            addString(it.key(), indexes);
+        }
+    }
+
+    addMap(d->mDeletedIncidences, indexes);
+    for (const auto &incidences : d->mDeletedIncidences) {
+        addHash(incidences, indexes);
+        for (const Incidence::Ptr &incidence : incidences) {
+            addIncidence(*incidence);
+        }
+    }
+}
+//@endcond
@@ -302,6 +302,126 @@ public:
     */
     Alarm::List alarmsTo(const QDateTime &to) const;
 
+    // Snapshot Methods //
+
+    /**
+      @brief
+      An immutable view of the incidences of a MemoryCalendar.
+
+      A snapshot is taken by publishSnapshot() and does not change when the
+      calendar changes afterwards. It can be queried from any thread without
+      locking, concurrently with other readers and with the thread modifying
+      the calendar.
+
+      The incidences themselves are shared with the calendar, not copied. A
+      published incidence must therefore not be modified anymore; to change
+      it, delete it from the calendar and add a modified clone instead. Note
+      that deleting an incidence updates the related-to of its sub-incidences.
+
+      @see MemoryCalendar::publishSnapshot(), MemoryCalendar::snapshot()
+      @since 5.8
+    */
+    class KCALCORE_EXPORT Snapshot
+    {
+    public:
+        /**
+          A shared pointer to a Snapshot
+        */
+        typedef QSharedPointer<const Snapshot> Ptr;
+
+        /**
+          Destroys the snapshot.
+        */
+        ~Snapshot();
+
+        /**
+          Returns the version of this snapshot. Each call of publishSnapshot()
+          increases the version by one, the initial empty snapshot has version 0.
+        */
+        quint64 version() const;
+
+        /**
+          @copydoc Calendar::rawEvents(EventSortField, SortDirection)const
+        */
+        Event::List rawEvents(EventSortField sortField = EventSortUnsorted,
+                              SortDirection sortDirection = SortDirectionAscending) const;
+
+        /**
+          @copydoc Calendar::rawTodos(TodoSortField, SortDirection)const
+        */
+        Todo::List rawTodos(TodoSortField sortField = TodoSortUnsorted,
+                            SortDirection sortDirection = SortDirectionAscending) const;
+
+        /**
+          @copydoc Calendar::rawJournals()
+        */
+        Journal::List rawJournals(JournalSortField sortField = JournalSortUnsorted,
+                                  SortDirection sortDirection = SortDirectionAscending) const;
+
+        /**
+          @copydoc Calendar::rawIncidences()
+        */
+        Incidence::List rawIncidences() const;
+
+        /**
+          @copydoc Calendar::incidence()
+        */
+        Incidence::Ptr incidence(const QString &uid, const QDateTime &recurrenceId = {}) const;
+
+        /**
+          @copydoc Calendar::event()
+        */
+        Event::Ptr event(const QString &uid, const QDateTime &recurrenceId = {}) const;
+
+        /**
+          @copydoc Calendar::todo()
+        */
+        Todo::Ptr todo(const QString &uid, const QDateTime &recurrenceId = {}) const;
+
+        /**
+          @copydoc Calendar::journal()
+        */
+        Journal::Ptr journal(const QString &uid, const QDateTime &recurrenceId = {}) const;
+
+        /**
+          @copydoc MemoryCalendar::instance()
+        */
+        Incidence::Ptr instance(const QString &identifier) const;
+
+    private:
+        //@cond PRIVATE
+        friend class MemoryCalendar;
+        Snapshot();
+        class Private;
+        Private *const d;
+        //@endcond
+
+        Q_DISABLE_COPY(Snapshot)
+    };
+
+    /**
+      Publishes the current state of the calendar as a new Snapshot, which
+      is returned by snapshot() from then on.
+
+      This is cheap: the snapshot shares its data with the calendar, and a
+      container is only copied when the calendar modifies it afterwards.
+      Publish after a batch of modifications rather than after each one.
+
+      Must be called from the thread modifying the calendar.
+      @since 5.8
+    */
+    void publishSnapshot();
+
+    /**
+      Returns the most recently published Snapshot of the calendar, or an
+      empty one if publishSnapshot() has not been called yet.
+
+      Unlike the other methods of the calendar, this can be called from any
+      thread.
+      @since 5.8
+    */
+    Snapshot::Ptr snapshot() const;
+
     /**
       @copydoc Calendar::incidenceUpdate(const QString &,const QDateTime &)
     */
@@ -322,6 +442,9 @@ protected:
 
 private:
     //@cond PRIVATE
+    bool insertIncidences(const Incidence::List &incidences);
+
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
@@ -0,0 +1,174 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and
+  defines the MemoryUsage class.
+*/
+#include "memoryusage.h"
+#include "memoryaccounting_p.h"
+#include "event.h"
+#include "journal.h"
+#include "todo.h"
+
+using namespace KCalCore;
+
+//@cond PRIVATE
+namespace
+{
+
+const char *const sCategoryNames[] = {
+    "IncidenceObjects",
+    "Strings",
+    "Persons",
+    "Alarms",
+    "Attachments",
+    "RecurrenceRules",
+    "RecurrenceCaches",
+    "CalendarIndexes",
+    "CalendarMaps"
+};
+Q_STATIC_ASSERT(sizeof(sCategoryNames) / sizeof(sCategoryNames[0]) == MemoryUsage::CategoryCount);
+
+}
+
+class Q_DECL_HIDDEN KCalCore::MemoryUsage::Private
+{
+public:
+    qint64 mBytes[CategoryCount] = {};
+};
+
+void MemoryAccounting::addString(const QString &string, MemoryUsage::Category category)
+{
+    const QString::DataPtr data = const_cast<QString &>(string).data_ptr();
+    // Literals and the shared empty strings are not on the heap
+    if (data->ref.isStatic() || !firstTime(data)) {
+        return;
+    }
+    add(category, sizeof(QArrayData) + (qint64(data->alloc) * sizeof(QChar)));
+}
+
+void MemoryAccounting::addByteArray(const QByteArray &array, MemoryUsage::Category category)
+{
+    const QByteArray::DataPtr data = const_cast<QByteArray &>(array).data_ptr();
+    if (data->ref.isStatic() || !firstTime(data)) {
+        return;
+    }
+    add(category, sizeof(QArrayData) + qint64(data->alloc));
+}
+
+void MemoryAccounting::addIncidence(const IncidenceBase &incidence)
+{
+    if (!firstTime(&incidence)) {
+        return;
+    }
+    switch (incidence.type()) {
+    case IncidenceBase::TypeEvent:
+        addEventData(static_cast<const Event &>(incidence));
+        break;
+    case IncidenceBase::TypeTodo:
+        addTodoData(static_cast<const Todo &>(incidence));
+        break;
+    case IncidenceBase::TypeJournal:
+        // Journals have no private data of their own
+        add(MemoryUsage::IncidenceObjects, sizeof(Journal));
+        addIncidenceData(static_cast<const Journal &>(incidence));
+        break;
+    default:
+        // The size of e.g. a FreeBusy is not known here
+        add(MemoryUsage::IncidenceObjects, sizeof(IncidenceBase));
+        addIncidenceBaseData(incidence);
+        break;
+    }
+}
+
+void MemoryAccounting::addStringList(const QStringList &list, MemoryUsage::Category category)
+{
+    addList(list, category);
+    for (const QString &string : list) {
+        addString(string, category);
+    }
+}
+//@endcond
+
+MemoryUsage::MemoryUsage()
+    : d(new KCalCore::MemoryUsage::Private)
+{
+}
+
+MemoryUsage::MemoryUsage(const MemoryUsage &other)
+    : d(new KCalCore::MemoryUsage::Private(*other.d))
+{
+}
+
+MemoryUsage::~MemoryUsage()
+{
+    delete d;
+}
+
+MemoryUsage &MemoryUsage::operator=(const MemoryUsage &other)
+{
+    // check for self assignment
+    if (&other == this) {
+        return *this;
+    }
+
+    *d = *other.d;
+    return *this;
+}
+
+MemoryUsage &MemoryUsage::operator+=(const MemoryUsage &other)
+{
+    for (int i = 0; i < CategoryCount; ++i) {
+        d->mBytes[i] += other.d->mBytes[i];
+    }
+    return *this;
+}
+
+qint64 MemoryUsage::bytes(Category category) const
+{
+    if (category < 0 || category >= CategoryCount) {
+        return 0;
+    }
+    return d->mBytes[category];
+}
+
+void MemoryUsage::addBytes(Category category, qint64 bytes)
+{
+    if (category >= 0 && category < CategoryCount) {
+        d->mBytes[category] += bytes;
+    }
+}
+
+qint64 MemoryUsage::totalBytes() const
+{
+    qint64 total = 0;
+    for (qint64 bytes : d->mBytes) {
+        total += bytes;
+    }
+    return total;
+}
+
+QString MemoryUsage::categoryName(Category category)
+{
+    if (category < 0 || category >= CategoryCount) {
+        return QString();
+    }
+    return QString::fromLatin1(sCategoryNames[category]);
+}
@@ -0,0 +1,121 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and
+  defines the MemoryUsage class.
+*/
+#ifndef KCALCORE_MEMORYUSAGE_H
+#define KCALCORE_MEMORYUSAGE_H
+
+#include "kcalcore_export.h"
+
+#include <QString>
+
+namespace KCalCore
+{
+
+/**
+  @brief
+  An estimate of the memory retained by a calendar or an incidence,
+  broken down by category.
+
+  The estimate covers the objects, their private data and the heap
+  blocks of their strings and containers; allocator overhead is not
+  included. Data shared between several owners, e.g. an attendee shared
+  by several incidences of a calendar or an implicitly shared string, is
+  counted once.
+
+  @see Calendar::memoryUsage(), IncidenceBase::memoryUsage()
+  @since 5.8
+*/
+class KCALCORE_EXPORT MemoryUsage
+{
+public:
+    /**
+      The categories of retained memory.
+    */
+    enum Category {
+        IncidenceObjects, /**< Incidences and their private data */
+        Strings,          /**< Texts of incidences: uids, summaries, descriptions, categories, custom properties, ... */
+        Persons,          /**< Organizers and attendees with their texts */
+        Alarms,           /**< Alarms with their texts */
+        Attachments,      /**< Attachments with their data; not what is in an AttachmentStore */
+        RecurrenceRules,  /**< Recurrences, their rules and recurrence dates */
+        RecurrenceCaches, /**< Occurrences cached by recurrence rules */
+        CalendarIndexes,  /**< Lookup indexes of the calendar */
+        CalendarMaps,     /**< Notebook and relation maps of the calendar */
+        CategoryCount
+    };
+
+    /**
+      Constructs an empty estimate.
+    */
+    MemoryUsage();
+
+    /**
+      Copy constructor.
+    */
+    MemoryUsage(const MemoryUsage &other);
+
+    /**
+      Destructor.
+    */
+    ~MemoryUsage();
+
+    /**
+      Assignment operator.
+    */
+    MemoryUsage &operator=(const MemoryUsage &other);
+
+    /**
+      Adds the bytes of @p other to this estimate.
+    */
+    MemoryUsage &operator+=(const MemoryUsage &other);
+
+    /**
+      Returns the bytes retained in @p category.
+    */
+    qint64 bytes(Category category) const;
+
+    /**
+      Adds @p bytes to @p category.
+    */
+    void addBytes(Category category, qint64 bytes);
+
+    /**
+      Returns the bytes retained in all categories.
+    */
+    qint64 totalBytes() const;
+
+    /**
+      Returns the name of @p category, e.g. "Attachments".
+    */
+    static QString categoryName(Category category);
+
+private:
+    //@cond PRIVATE
+    class Private;
+    Private *const d;
+    //@endcond
+};
+
+}
+
+#endif
@@ -34,7 +34,11 @@
 #include "calfilter.h"
 #include "utils.h"
 
+#include <QAtomicInt>
 #include <QDate>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
 
 using namespace KCalCore;
 
@@ -81,7 +85,7 @@ public:
      */
     bool occurrenceIsHidden(const Calendar &calendar,
                             const Incidence::Ptr &inc,
-                            const QDateTime &occurrenceDate)
+                            const QDateTime &occurrenceDate) const
     {
         if ((inc->type() == Incidence::TypeTodo) &&
                 calendar.filter() &&
@@ -101,64 +105,161 @@ public:
         return false;
     }
 
-    void setupIterator(const Calendar &calendar, const Incidence::List &incidences)
+    /*
+     * Returns the occurrences of @p inc between start and end.
+     * Only reads from the calendar and the incidences, apart from the
+     * caches of the incidence's own recurrence, so incidences can be
+     * expanded concurrently.
+     */
+    QList<Occurrence> expand(const Calendar &calendar, const Incidence::Ptr &inc) const
     {
-        for (const Incidence::Ptr &inc : qAsConst(incidences)) {
-            if (inc->hasRecurrenceId()) {
-                continue;
-            }
-            if (inc->recurs()) {
-                QHash<QDateTime, Incidence::Ptr> recurrenceIds;
-                QDateTime incidenceRecStart = inc->dateTime(Incidence::RoleRecurrenceStart);
-                //const bool isAllDay = inc->allDay();
-                foreach (const Incidence::Ptr &exception, calendar.instances(inc)) {
-                    if (incidenceRecStart.isValid()) {
-                        recurrenceIds.insert(exception->recurrenceId().toTimeZone(incidenceRecStart.timeZone()), exception);
-                    }
+        QList<Occurrence> occurrences;
+        if (inc->hasRecurrenceId()) {
+            return occurrences;
+        }
+        if (inc->recurs()) {
+            QHash<QDateTime, Incidence::Ptr> recurrenceIds;
+            QDateTime incidenceRecStart = inc->dateTime(Incidence::RoleRecurrenceStart);
+            //const bool isAllDay = inc->allDay();
+            foreach (const Incidence::Ptr &exception, calendar.instances(inc)) {
+                if (incidenceRecStart.isValid()) {
+                    recurrenceIds.insert(exception->recurrenceId().toTimeZone(incidenceRecStart.timeZone()), exception);
                 }
-                const auto occurrences = inc->recurrence()->timesInInterval(start, end);
-                Incidence::Ptr incidence(inc), lastInc(inc);
-                qint64 offset(0), lastOffset(0);
-                QDateTime occurrenceStartDate;
-                for(auto recurrenceId : qAsConst(occurrences)) {
-                    occurrenceStartDate = recurrenceId;
-
-                    bool resetIncidence = false;
-                    if (recurrenceIds.contains(recurrenceId)) {
-                        // TODO: exclude exceptions where the start/end is not within
-                        // (so the occurrence of the recurrence is omitted, but no exception is added)
-                        if (recurrenceIds.value(recurrenceId)->status() == Incidence::StatusCanceled) {
-                            continue;
-                        }
-
-                        incidence = recurrenceIds.value(recurrenceId);
-                        occurrenceStartDate = incidence->dtStart();
-                        resetIncidence = !incidence->thisAndFuture();
-                        offset = incidence->recurrenceId().secsTo(incidence->dtStart());
-                        if (incidence->thisAndFuture()) {
-                            lastInc = incidence;
-                            lastOffset = offset;
-                        }
-                    } else if (inc != incidence) {   //thisAndFuture exception is active
-                        occurrenceStartDate = occurrenceStartDate.addSecs(offset);
+            }
+            const auto occurrenceTimes = inc->recurrence()->timesInInterval(start, end);
+            Incidence::Ptr incidence(inc), lastInc(inc);
+            qint64 offset(0), lastOffset(0);
+            QDateTime occurrenceStartDate;
+            for(auto recurrenceId : qAsConst(occurrenceTimes)) {
+                occurrenceStartDate = recurrenceId;
+
+                bool resetIncidence = false;
+                if (recurrenceIds.contains(recurrenceId)) {
+                    // TODO: exclude exceptions where the start/end is not within
+                    // (so the occurrence of the recurrence is omitted, but no exception is added)
+                    if (recurrenceIds.value(recurrenceId)->status() == Incidence::StatusCanceled) {
+                        continue;
                     }
 
-                    if (!occurrenceIsHidden(calendar, incidence, occurrenceStartDate)) {
-                        occurrenceList << Private::Occurrence(incidence, recurrenceId, occurrenceStartDate);
+                    incidence = recurrenceIds.value(recurrenceId);
+                    occurrenceStartDate = incidence->dtStart();
+                    resetIncidence = !incidence->thisAndFuture();
+                    offset = incidence->recurrenceId().secsTo(incidence->dtStart());
+                    if (incidence->thisAndFuture()) {
+                        lastInc = incidence;
+                        lastOffset = offset;
                     }
+                } else if (inc != incidence) {   //thisAndFuture exception is active
+                    occurrenceStartDate = occurrenceStartDate.addSecs(offset);
+                }
 
-                    if (resetIncidence) {
-                        incidence = lastInc;
-                        offset = lastOffset;
-                    }
+                if (!occurrenceIsHidden(calendar, incidence, occurrenceStartDate)) {
+                    occurrences << Private::Occurrence(incidence, recurrenceId, occurrenceStartDate);
+                }
+
+                if (resetIncidence) {
+                    incidence = lastInc;
+                    offset = lastOffset;
                 }
-            } else {
-                occurrenceList << Private::Occurrence(inc, {}, inc->dtStart());
+            }
+        } else {
+            occurrences << Private::Occurrence(inc, {}, inc->dtStart());
+        }
+        return occurrences;
+    }
+
+    void setupIterator(const Calendar &calendar, const Incidence::List &incidences,
+                       OccurrenceIterator::Expansion expansion = OccurrenceIterator::SerialExpansion)
+    {
+        if (expansion == OccurrenceIterator::ParallelExpansion && incidences.count() > 1
+                && QThreadPool::globalInstance()->maxThreadCount() > 1) {
+            expandInParallel(calendar, incidences);
+        } else {
+            for (const Incidence::Ptr &inc : qAsConst(incidences)) {
+                occurrenceList << expand(calendar, inc);
             }
         }
         occurrenceIt = QListIterator<Private::Occurrence>(occurrenceList);
     }
+
+    /*
+     * The shared state of a parallel expansion. Workers claim the next
+     * incidence from a counter, so the load is balanced, and store its
+     * occurrences at the incidence's index, so the order doesn't depend on
+     * the scheduling.
+     *
+     * It is reference counted because workers that start after all incidences
+     * have been claimed still access the counter.
+     */
+    class ExpansionJob
+    {
+    public:
+        ExpansionJob(const Private *d, const Calendar &calendar,
+                     const Incidence::List &incidences)
+            : d(d), calendar(calendar), incidences(incidences), results(incidences.count())
+        {
+        }
+
+        // Expands incidences until none is left
+        void work()
+        {
+            // results isn't shared, so data() doesn't detach
+            QList<Occurrence> *const out = results.data();
+            int i;
+            while ((i = next.fetchAndAddRelaxed(1)) < incidences.count()) {
+                out[i] = d->expand(calendar, incidences.at(i));
+                done.release();
+            }
+        }
+
+        const Private *d;
+        const Calendar &calendar;
+        const Incidence::List incidences;
+        QVector<QList<Occurrence> > results;
+        QAtomicInt next;
+        QSemaphore done;
+    };
+
+    class ExpansionWorker : public QRunnable
+    {
+    public:
+        explicit ExpansionWorker(const QSharedPointer<ExpansionJob> &job)
+            : mJob(job)
+        {
+        }
+
+        void run() override
+        {
+            mJob->work();
+        }
+
+    private:
+        QSharedPointer<ExpansionJob> mJob;
+    };
+
+    void expandInParallel(const Calendar &calendar, const Incidence::List &incidences);
 };
+
+void OccurrenceIterator::Private::expandInParallel(const Calendar &calendar,
+                                                   const Incidence::List &incidences)
+{
+    QSharedPointer<ExpansionJob> job(new ExpansionJob(this, calendar, incidences));
+
+    QThreadPool *pool = QThreadPool::globalInstance();
+    const int workers = qMin(pool->maxThreadCount(), incidences.count()) - 1;
+    for (int i = 0; i < workers; ++i) {
+        pool->start(new ExpansionWorker(job));
+    }
+
+    // Help out, and wait only for the incidences claimed by started workers,
+    // which avoids a deadlock when called from a busy pool thread
+    job->work();
+    job->done.acquire(incidences.count());
+
+    for (const QList<Occurrence> &occurrences : qAsConst(job->results)) {
+        occurrenceList << occurrences;
+    }
+}
 //@endcond
 
 
@@ -176,6 +277,14 @@ public:
 OccurrenceIterator::OccurrenceIterator(const Calendar &calendar,
                                        const QDateTime &start,
                                        const QDateTime &end)
+    : OccurrenceIterator(calendar, start, end, SerialExpansion)
+{
+}
+
+OccurrenceIterator::OccurrenceIterator(const Calendar &calendar,
+                                       const QDateTime &start,
+                                       const QDateTime &end,
+                                       Expansion expansion)
     : d(new KCalCore::OccurrenceIterator::Private(this))
 {
     d->start = start;
@@ -208,7 +317,7 @@ OccurrenceIterator::OccurrenceIterator(const Calendar &calendar,
 
     const Incidence::List incidences =
         KCalCore::Calendar::mergeIncidenceList(events, todos, journals);
-    d->setupIterator(calendar, incidences);
+    d->setupIterator(calendar, incidences, expansion);
 }
 
 OccurrenceIterator::OccurrenceIterator(const Calendar &calendar,
@@ -47,6 +47,15 @@ class Calendar;
 class KCALCORE_EXPORT OccurrenceIterator
 {
 public:
+    /**
+     * How the occurrences of the incidences are computed.
+     * @since 5.8
+     */
+    enum Expansion {
+        SerialExpansion,  /**< One incidence after the other, in the calling thread */
+        ParallelExpansion /**< Several incidences at once, on QThreadPool::globalInstance() */
+    };
+
     /**
      * Creates iterator that iterates over all occurrences of all incidences
      * between @param start and @param end (inclusive)
@@ -55,6 +64,21 @@ public:
                                 const QDateTime &start = QDateTime(),
                                 const QDateTime &end = QDateTime());
 
+    /**
+     * Creates iterator that iterates over all occurrences of all incidences
+     * between @param start and @param end (inclusive), computing them as
+     * specified by @param expansion.
+     *
+     * The occurrences are iterated in the same order for both kinds of
+     * expansion. With ParallelExpansion the calendar is queried from several
+     * threads, so it must not be modified while the iterator is created.
+     * @since 5.8
+     */
+    OccurrenceIterator(const Calendar &calendar,
+                       const QDateTime &start,
+                       const QDateTime &end,
+                       Expansion expansion);
+
     /**
      * Creates iterator that iterates over all occurrences
      * of @param incidence between @param start and @param end (inclusive)
@@ -34,6 +34,8 @@
 */
 
 #include "person.h"
+#include "arena_p.h"
+#include "memoryaccounting_p.h"
 #include <QRegExp>
 #include <QDataStream>
 
@@ -44,17 +46,28 @@ using namespace KCalCore;
   @internal
 */
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::Person::Private
+class Q_DECL_HIDDEN KCalCore::Person::Private : public QSharedData, public ArenaAllocated
 {
 public:
     Private() {}
+    // Shared by all persons without name and email
+    static const QSharedDataPointer<Private> &empty()
+    {
+        // Not from an arena, it would keep the arena's memory alive
+        static const QSharedDataPointer<Private> sEmpty([]() {
+            Arena::Scope heap(nullptr);
+            return new Private;
+        }());
+        return sEmpty;
+    }
+
     QString mName;   // person name
     QString mEmail;  // person email address
     int mCount = 0;      // person reference count
 };
 //@endcond
 
-Person::Person() : d(new KCalCore::Person::Private)
+Person::Person() : d(Private::empty())
 {
 }
 
@@ -66,13 +79,12 @@ Person::Person(const QString &name, const QString &email)
 }
 
 Person::Person(const Person &person)
-    : d(new KCalCore::Person::Private(*person.d))
+    : d(person.d)
 {
 }
 
 Person::~Person()
 {
-    delete d;
 }
 
 bool KCalCore::Person::operator==(const Person &person) const
@@ -94,7 +106,7 @@ Person &KCalCore::Person::operator=(const Person &person)
         return *this;
     }
 
-    *d = *person.d;
+    d = person.d;
     return *this;
 }
 
@@ -175,9 +187,9 @@ uint qHash(const KCalCore::Person &key)
 
 QDataStream &KCalCore::operator<<(QDataStream &stream, const KCalCore::Person::Ptr &person)
 {
-    return stream << person->d->mName
-           << person->d->mEmail
-           << person->d->mCount;
+    return stream << person->name()
+           << person->email()
+           << person->count();
 }
 
 QDataStream &KCalCore::operator>>(QDataStream &stream, Person::Ptr &person)
@@ -394,3 +406,20 @@ Person::Ptr Person::fromFullName(const QString &fullName)
     extractEmailAddressAndName(fullName, email, name);
     return Person::Ptr(new Person(name, email));
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addPerson(const Person::Ptr &person)
+{
+    if (!firstTime(person.data())) {
+        return;
+    }
+    // The reference count block of the shared pointer
+    add(MemoryUsage::Persons, sizeof(Person) + 2 * sizeof(void *));
+    const Person::Private *d = person->d.constData();
+    if (firstTime(d)) {
+        add(MemoryUsage::Persons, sizeof(Person::Private));
+        addString(d->mName, MemoryUsage::Persons);
+        addString(d->mEmail, MemoryUsage::Persons);
+    }
+}
+//@endcond
@@ -36,6 +36,7 @@
 #include <QString>
 #include <QHash>
 #include <QMetaType>
+#include <QSharedDataPointer>
 #include <QSharedPointer>
 
 namespace KCalCore
@@ -47,6 +48,9 @@ namespace KCalCore
 
   This class represents a person, with a name and an email address.
   It supports the "FirstName LastName\ <mail@domain\>" format.
+
+  The data of a person is implicitly shared: copies, see operator=(), share
+  it until one of them is modified.
 */
 class KCALCORE_EXPORT Person
 {
@@ -193,8 +197,9 @@ public:
 
 private:
     //@cond PRIVATE
+    friend class MemoryAccounting;
     class Private;
-    Private *const d;
+    QSharedDataPointer<Private> d;
     //@endcond
 
     // TODO_KDE5: FIXME: This operator does slicing,if the object is in fact one of the derived classes (Attendee)
@@ -22,6 +22,9 @@
   Boston, MA 02110-1301, USA.
 */
 #include "recurrence.h"
+#include "arena_p.h"
+#include "instrumentation_p.h"
+#include "memoryaccounting_p.h"
 #include "sortablelist.h"
 #include "utils.h"
 
@@ -29,12 +32,24 @@
 
 #include <QTimeZone>
 #include <QBitArray>
+#include <QHash>
 #include <QTime>
+#include <QVarLengthArray>
+#include <QVector>
+
+#include <algorithm>
 
 using namespace KCalCore;
 
+// Number of days whose occurrence times are cached by recurTimesOn()
+static const int TIMES_ON_CACHE_SIZE = 64;
+
+// Number of occurrences excluded by EXRULEs after which a cursor gives up,
+// e.g. when an EXRULE is identical to an RRULE
+static const int EXRULE_LOOP_LIMIT = 10000;
+
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::Recurrence::Private
+class Q_DECL_HIDDEN KCalCore::Recurrence::Private : public ArenaAllocated
 {
 public:
     Private()
@@ -58,6 +73,9 @@ public:
 
     bool operator==(const Private &p) const;
 
+    TimeList recurTimesOn(const QDate &date, const QTimeZone &timeZone) const;
+    void clearCaches() const;
+
     RecurrenceRule::List mExRules;
     RecurrenceRule::List mRRules;
     SortableList<QDateTime> mRDateTimes;
@@ -70,10 +88,29 @@ public:
     // Cache the type of the recurrence with the old system (e.g. MonthlyPos)
     mutable ushort mCachedType;
 
+    // Cache of recurTimesOn() per date and time zone id. It is cleared when
+    // the recurrence changes, or when it holds TIMES_ON_CACHE_SIZE days.
+    mutable QHash<QPair<QDate, QByteArray>, TimeList> mTimesOnCache;
+    // Result of the last recursOnDates() call, for the following day queries
+    // of the same window. It is cleared together with mTimesOnCache.
+    struct DaysCache {
+        QDate start;
+        QDate end;
+        QByteArray timeZoneId;
+        QBitArray days;
+    };
+    mutable DaysCache mDaysCache;
+
     bool mAllDay = false;                // the recurrence has no time, just a date
     bool mRecurReadOnly = false;
 };
 
+void Recurrence::Private::clearCaches() const
+{
+    mTimesOnCache.clear();
+    mDaysCache = DaysCache();
+}
+
 bool Recurrence::Private::operator==(const Recurrence::Private &p) const
 {
 //   qCDebug(KCALCORE_LOG) << mStartDateTime << p.mStartDateTime;
@@ -111,8 +148,224 @@ bool Recurrence::Private::operator==(const Recurrence::Private &p) const
     }
     return true;
 }
+
+/*
+  The start date/time, the RDATE lists and the RRULEs are merged: each source
+  keeps its next occurrence, and a step only advances the sources which are at
+  the returned occurrence. Excluded occurrences are skipped, following the
+  sorted EXDATE-TIMEs along with the occurrences.
+*/
+class Q_DECL_HIDDEN Recurrence::Cursor::Private
+{
+public:
+    Private(const Recurrence::Private *d, const QDateTime &from, bool forward);
+    ~Private();
+
+    // Returns the next occurrence, or an invalid QDateTime if there is none
+    QDateTime next();
+
+private:
+    Q_DISABLE_COPY(Private)
+
+    enum Exclusion {
+        NotExcluded,
+        ExcludedByDate,
+        ExcludedByRule
+    };
+
+    QDateTime nextCandidate();
+    Exclusion exclusion(const QDateTime &dt);
+
+    // Whether a comes before b in the direction of the cursor
+    bool before(const QDateTime &a, const QDateTime &b) const
+    {
+        return mForward ? a < b : b < a;
+    }
+
+    QDateTime rDate(int i) const
+    {
+        QDateTime dt(d->mStartDateTime);
+        dt.setDate(d->mRDates[i]);
+        return dt;
+    }
+
+    const Recurrence::Private *const d;
+    const bool mForward;
+    QDateTime mStart;              // the start date/time, until it is returned
+    int mRDateTime;                // position in mRDateTimes
+    int mRDate;                    // position in mRDates
+    int mExDateTime;               // position in mExDateTimes
+    bool mFinished = false;        // whether there are no more occurrences
+    QVector<RecurrenceRule::Cursor *> mRuleCursors;  // one for each RRULE
+    QVector<QDateTime> mRuleNext;  // next occurrence of each RRULE
+};
+
+Recurrence::Cursor::Private::Private(const Recurrence::Private *d, const QDateTime &from, bool forward)
+    : d(d),
+      mForward(forward)
+{
+    if (before(from, d->mStartDateTime)) {
+        mStart = d->mStartDateTime;
+    }
+
+    const int rDateCount = d->mRDates.count();
+    if (forward) {
+        mRDateTime = d->mRDateTimes.findGT(from);
+        if (mRDateTime < 0) {
+            mRDateTime = d->mRDateTimes.count();
+        }
+        mExDateTime = d->mExDateTimes.findGT(from);
+        if (mExDateTime < 0) {
+            mExDateTime = d->mExDateTimes.count();
+        }
+        mRDate = 0;
+        while (mRDate < rDateCount && rDate(mRDate) <= from) {
+            ++mRDate;
+        }
+    } else {
+        mRDateTime = d->mRDateTimes.findLT(from);
+        mExDateTime = d->mExDateTimes.findLT(from);
+        mRDate = rDateCount - 1;
+        while (mRDate >= 0 && rDate(mRDate) >= from) {
+            --mRDate;
+        }
+    }
+
+    mRuleCursors.reserve(d->mRRules.count());
+    mRuleNext.reserve(d->mRRules.count());
+    for (const RecurrenceRule *rule : qAsConst(d->mRRules)) {
+        RecurrenceRule::Cursor *cursor =
+            new RecurrenceRule::Cursor(rule, from, forward ? RecurrenceRule::Cursor::Forward
+                                                           : RecurrenceRule::Cursor::Backward);
+        mRuleCursors.append(cursor);
+        mRuleNext.append(cursor->next());
+    }
+}
+
+Recurrence::Cursor::Private::~Private()
+{
+    qDeleteAll(mRuleCursors);
+}
+
+QDateTime Recurrence::Cursor::Private::next()
+{
+    int excludedByRule = 0;
+    while (!mFinished) {
+        const QDateTime dt = nextCandidate();
+        if (!dt.isValid()) {
+            break;
+        }
+        switch (exclusion(dt)) {
+        case NotExcluded:
+            return dt;
+        case ExcludedByDate:
+            // EXDATEs and EXDATE-TIMEs are finite and nextCandidate() makes
+            // every source move on, so this ends
+            break;
+        case ExcludedByRule:
+            if (++excludedByRule >= EXRULE_LOOP_LIMIT) {
+                mFinished = true;
+            }
+            break;
+        }
+    }
+    mFinished = true;
+    return QDateTime();
+}
+
+// Returns the next occurrence before exclusions, and advances past it
+QDateTime Recurrence::Cursor::Private::nextCandidate()
+{
+    const int rDateTimeCount = d->mRDateTimes.count();
+    const int rDateCount = d->mRDates.count();
+    const bool hasRDateTime = mRDateTime >= 0 && mRDateTime < rDateTimeCount;
+    const bool hasRDate = mRDate >= 0 && mRDate < rDateCount;
+
+    QDateTime candidate = mStart;
+    if (hasRDateTime && (!candidate.isValid() || before(d->mRDateTimes[mRDateTime], candidate))) {
+        candidate = d->mRDateTimes[mRDateTime];
+    }
+    if (hasRDate) {
+        const QDateTime dt = rDate(mRDate);
+        if (!candidate.isValid() || before(dt, candidate)) {
+            candidate = dt;
+        }
+    }
+    for (const QDateTime &dt : qAsConst(mRuleNext)) {
+        if (dt.isValid() && (!candidate.isValid() || before(dt, candidate))) {
+            candidate = dt;
+        }
+    }
+    if (!candidate.isValid()) {
+        return candidate;
+    }
+
+    // All sources which are at the candidate move on
+    const int step = mForward ? 1 : -1;
+    if (mStart.isValid() && !before(candidate, mStart)) {
+        mStart = QDateTime();
+    }
+    while (mRDateTime >= 0 && mRDateTime < rDateTimeCount
+           && !before(candidate, d->mRDateTimes[mRDateTime])) {
+        mRDateTime += step;
+    }
+    while (mRDate >= 0 && mRDate < rDateCount && !before(candidate, rDate(mRDate))) {
+        mRDate += step;
+    }
+    for (int i = 0, count = mRuleNext.count(); i < count; ++i) {
+        if (mRuleNext[i].isValid() && !before(candidate, mRuleNext[i])) {
+            mRuleNext[i] = mRuleCursors[i]->next();
+            // A rule that doesn't move on would return the same excluded
+            // candidate again, and next() would never end
+            if (mRuleNext[i].isValid() && !before(candidate, mRuleNext[i])) {
+                qCWarning(KCALCORE_LOG) << "Recurrence rule did not advance past" << candidate;
+                mRuleNext[i] = QDateTime();
+            }
+        }
+    }
+    return candidate;
+}
+
+Recurrence::Cursor::Private::Exclusion Recurrence::Cursor::Private::exclusion(const QDateTime &dt)
+{
+    if (d->mExDates.containsSorted(dt.date())) {
+        return ExcludedByDate;
+    }
+
+    const int exDateTimeCount = d->mExDateTimes.count();
+    const int step = mForward ? 1 : -1;
+    while (mExDateTime >= 0 && mExDateTime < exDateTimeCount
+           && before(d->mExDateTimes[mExDateTime], dt)) {
+        mExDateTime += step;
+    }
+    if (mExDateTime >= 0 && mExDateTime < exDateTimeCount && d->mExDateTimes[mExDateTime] == dt) {
+        return ExcludedByDate;
+    }
+
+    for (const RecurrenceRule *rule : qAsConst(d->mExRules)) {
+        if (rule->recursAt(dt)) {
+            return ExcludedByRule;
+        }
+    }
+    return NotExcluded;
+}
 //@endcond
 
+Recurrence::Cursor::Cursor(const Recurrence *recurrence, const QDateTime &from, Direction direction)
+    : d(new Private(recurrence->d, from, direction == Forward))
+{
+}
+
+Recurrence::Cursor::~Cursor()
+{
+    delete d;
+}
+
+QDateTime Recurrence::Cursor::next()
+{
+    return d->next();
+}
+
 Recurrence::Recurrence()
     : d(new KCalCore::Recurrence::Private())
 {
@@ -222,6 +475,7 @@ void Recurrence::updated()
 {
     // recurrenceType() re-calculates the type if it's rMax
     d->mCachedType = rMax;
+    d->clearCaches();
     for (int i = 0, end = d->mObservers.count();  i < end;  ++i) {
         if (d->mObservers[i]) {
             d->mObservers[i]->recurrenceUpdated(this);
@@ -331,6 +585,8 @@ ushort Recurrence::recurrenceType(const RecurrenceRule *rrule)
 
 bool Recurrence::recursOn(const QDate &qd, const QTimeZone &timeZone) const
 {
+    KCALCORE_TIME(RecursOnTimer);
+
     // Don't waste time if date is before the start of the recurrence
     if (QDateTime(qd, QTime(23, 59, 59), timeZone) < d->mStartDateTime) {
         return false;
@@ -394,6 +650,139 @@ bool Recurrence::recursOn(const QDate &qd, const QTimeZone &timeZone) const
     }
 }
 
+//@cond PRIVATE
+// Sets bit i of @p days if @p rule recurs on start.addDays(i), as
+// RecurrenceRule::recursOn() would tell
+static void addRuleDates(const RecurrenceRule *rule, const QDate &start,
+                         const QTimeZone &timeZone, QBitArray &days)
+{
+    const int count = days.size();
+    if (rule->recurrenceType() < RecurrenceRule::rDaily) {
+        // Sub-daily rules have too many occurrences to compute them all
+        for (int i = 0; i < count; ++i) {
+            if (!days.testBit(i) && rule->recursOn(start.addDays(i), timeZone)) {
+                days.setBit(i);
+            }
+        }
+        return;
+    }
+
+    // In chunks, to stay well below the loop limit of timesInInterval()
+    const int chunkDays = 366;
+    // Date-only rules ignore the time zone
+    const bool isAllDay = rule->allDay();
+    const QTimeZone zone = isAllDay ? rule->startDt().timeZone() : timeZone;
+    for (int first = 0; first < count; first += chunkDays) {
+        const int last = qMin(first + chunkDays, count) - 1;
+        QDateTime from(start.addDays(first), QTime(0, 0), zone);
+        const QDateTime to = isAllDay ? QDateTime(start.addDays(last), QTime(23, 59, 59), zone)
+                                      : QDateTime(start.addDays(last + 1), QTime(0, 0), zone);
+        for (;;) {
+            const SortableList<QDateTime> times = rule->timesInInterval(from, to);
+            for (const QDateTime &time : times) {
+                if (!time.isValid()) {
+                    continue;
+                }
+                const qint64 i = start.daysTo(isAllDay ? time.date() : time.toTimeZone(timeZone).date());
+                if (i >= first && i <= last) {
+                    days.setBit(int(i));
+                }
+            }
+            // An invalid last time marks an incomplete list, continue after it
+            if (times.count() < 2 || times.last().isValid()) {
+                break;
+            }
+            from = times.at(times.count() - 2).addSecs(1);
+        }
+    }
+}
+//@endcond
+
+QBitArray Recurrence::recursOnDates(const QDate &start, const QDate &end, const QTimeZone &timeZone) const
+{
+    if (!start.isValid() || !end.isValid() || end < start) {
+        return QBitArray();
+    }
+    const QByteArray timeZoneId = timeZone.id();
+    if (d->mDaysCache.start == start && d->mDaysCache.end == end
+            && d->mDaysCache.timeZoneId == timeZoneId) {
+        return d->mDaysCache.days;
+    }
+    const int count = int(start.daysTo(end)) + 1;
+    QBitArray result(count);
+
+    // The same steps as recursOn(), for all dates at once.
+    // Dates ending before the start of the recurrence are skipped.
+    int first = 0;
+    while (first < count
+           && QDateTime(start.addDays(first), QTime(23, 59, 59), timeZone) < d->mStartDateTime) {
+        ++first;
+    }
+    if (first == count) {
+        d->mDaysCache = {start, end, timeZoneId, result};
+        return result;
+    }
+
+    const auto index = [&start, count](const QDate &date) {
+        const qint64 i = start.daysTo(date);
+        return i >= 0 && i < count ? int(i) : -1;
+    };
+    int i;
+
+    QBitArray rDates(count);
+    for (const QDate &date : qAsConst(d->mRDates)) {
+        if ((i = index(date)) >= 0) {
+            rDates.setBit(i);
+        }
+    }
+    QBitArray recurs(count);
+    if ((i = index(startDate())) >= 0) {
+        recurs.setBit(i);
+    }
+    for (const QDateTime &dateTime : qAsConst(d->mRDateTimes)) {
+        if ((i = index(dateTime.toTimeZone(timeZone).date())) >= 0) {
+            recurs.setBit(i);
+        }
+    }
+    for (const RecurrenceRule *rule : qAsConst(d->mRRules)) {
+        addRuleDates(rule, start, timeZone, recurs);
+    }
+
+    QBitArray exRules(count);
+    for (const RecurrenceRule *rule : qAsConst(d->mExRules)) {
+        addRuleDates(rule, start, timeZone, exRules);
+    }
+    QBitArray exDateTimes(count);
+    for (const QDateTime &dateTime : qAsConst(d->mExDateTimes)) {
+        if ((i = index(dateTime.toTimeZone(timeZone).date())) >= 0) {
+            exDateTimes.setBit(i);
+        }
+    }
+
+    const bool isAllDay = allDay();
+    for (i = first; i < count; ++i) {
+        const QDate date = start.addDays(i);
+        if (d->mExDates.containsSorted(date) || (isAllDay && exRules.testBit(i))) {
+            continue;
+        }
+        if (rDates.testBit(i)) {
+            result.setBit(i);
+            continue;
+        }
+        if (!recurs.testBit(i)) {
+            continue;
+        }
+        if (!exDateTimes.testBit(i) && (isAllDay || !exRules.testBit(i))) {
+            result.setBit(i);
+        } else if (!recurTimesOn(date, timeZone).isEmpty()) {
+            // Some times of the day are excluded, see recursOn()
+            result.setBit(i);
+        }
+    }
+    d->mDaysCache = {start, end, timeZoneId, result};
+    return result;
+}
+
 bool Recurrence::recursAt(const QDateTime &dt) const
 {
     // Convert to recurrence's time zone for date comparisons, and for more efficient time comparisons
@@ -536,6 +925,7 @@ void Recurrence::shiftTimes(const QTimeZone &oldTz, const QTimeZone &newTz)
 
     d->mStartDateTime = d->mStartDateTime.toTimeZone(oldTz);
     d->mStartDateTime.setTimeZone(newTz);
+    d->clearCaches();
 
     int i, end;
     for (i = 0, end = d->mRDateTimes.count();  i < end;  ++i) {
@@ -992,35 +1382,35 @@ void Recurrence::setYearlyMonth(const QList<int> &months)
     }
 }
 
-TimeList Recurrence::recurTimesOn(const QDate &date, const QTimeZone &timeZone) const
+//@cond PRIVATE
+TimeList Recurrence::Private::recurTimesOn(const QDate &date, const QTimeZone &timeZone) const
 {
-// qCDebug(KCALCORE_LOG) << "recurTimesOn(" << date << ")";
     int i, end;
     TimeList times;
 
     // The whole day is excepted
-    if (d->mExDates.containsSorted(date)) {
+    if (mExDates.containsSorted(date)) {
         return times;
     }
 
     // EXRULE takes precedence over RDATE entries, so for all-day events,
     // a matching excule also excludes the whole day automatically
-    if (allDay()) {
-        for (i = 0, end = d->mExRules.count();  i < end;  ++i) {
-            if (d->mExRules[i]->recursOn(date, timeZone)) {
+    if (mAllDay) {
+        for (i = 0, end = mExRules.count();  i < end;  ++i) {
+            if (mExRules[i]->recursOn(date, timeZone)) {
                 return times;
             }
         }
     }
 
-    QDateTime dt = startDateTime().toTimeZone(timeZone);
+    QDateTime dt = mStartDateTime.toTimeZone(timeZone);
     if (dt.date() == date) {
         times << dt.time();
     }
 
     bool foundDate = false;
-    for (i = 0, end = d->mRDateTimes.count();  i < end;  ++i) {
-        dt = d->mRDateTimes[i].toTimeZone(timeZone);
+    for (i = 0, end = mRDateTimes.count();  i < end;  ++i) {
+        dt = mRDateTimes[i].toTimeZone(timeZone);
         if (dt.date() == date) {
             times << dt.time();
             foundDate = true;
@@ -1028,15 +1418,15 @@ TimeList Recurrence::recurTimesOn(const QDate &date, const QTimeZone &timeZone)
             break; // <= Assume that the rdatetime list is sorted
         }
     }
-    for (i = 0, end = d->mRRules.count();  i < end;  ++i) {
-        times += d->mRRules[i]->recurTimesOn(date, timeZone);
+    for (i = 0, end = mRRules.count();  i < end;  ++i) {
+        times += mRRules[i]->recurTimesOn(date, timeZone);
     }
     times.sortUnique();
 
     foundDate = false;
     TimeList extimes;
-    for (i = 0, end = d->mExDateTimes.count();  i < end;  ++i) {
-        dt = d->mExDateTimes[i].toTimeZone(timeZone);
+    for (i = 0, end = mExDateTimes.count();  i < end;  ++i) {
+        dt = mExDateTimes[i].toTimeZone(timeZone);
         if (dt.date() == date) {
             extimes << dt.time();
             foundDate = true;
@@ -1044,9 +1434,9 @@ TimeList Recurrence::recurTimesOn(const QDate &date, const QTimeZone &timeZone)
             break;
         }
     }
-    if (!allDay()) {       // we have already checked all-day times above
-        for (i = 0, end = d->mExRules.count();  i < end;  ++i) {
-            extimes += d->mExRules[i]->recurTimesOn(date, timeZone);
+    if (!mAllDay) {       // we have already checked all-day times above
+        for (i = 0, end = mExRules.count();  i < end;  ++i) {
+            extimes += mExRules[i]->recurTimesOn(date, timeZone);
         }
     }
     extimes.sortUnique();
@@ -1060,28 +1450,85 @@ TimeList Recurrence::recurTimesOn(const QDate &date, const QTimeZone &timeZone)
     }
     return times;
 }
+//@endcond
+
+TimeList Recurrence::recurTimesOn(const QDate &date, const QTimeZone &timeZone) const
+{
+// qCDebug(KCALCORE_LOG) << "recurTimesOn(" << date << ")";
+    const QPair<QDate, QByteArray> key(date, timeZone.id());
+    const auto it = d->mTimesOnCache.constFind(key);
+    if (it != d->mTimesOnCache.constEnd()) {
+        return it.value();
+    }
+
+    const TimeList times = d->recurTimesOn(date, timeZone);
+    if (d->mTimesOnCache.size() >= TIMES_ON_CACHE_SIZE) {
+        d->mTimesOnCache.clear();
+    }
+    d->mTimesOnCache.insert(key, times);
+    return times;
+}
+
+//@cond PRIVATE
+// Merges lists of times, each sorted or made so, into one sorted list
+// without duplicates, in a single pass over all of them
+static SortableList<QDateTime> mergeTimes(QVector<SortableList<QDateTime> > &lists)
+{
+    int total = 0;
+    for (SortableList<QDateTime> &list : lists) {
+        // RecurrenceRule::timesInInterval() may end in an invalid time
+        if (!std::is_sorted(list.cbegin(), list.cend())) {
+            list.sortUnique();
+        }
+        total += list.count();
+    }
+
+    SortableList<QDateTime> result;
+    result.reserve(total);
+    QVarLengthArray<int, 8> pos(lists.count());
+    std::fill(pos.begin(), pos.end(), 0);
+    for (;;) {
+        int next = -1;
+        for (int k = 0, count = lists.count(); k < count; ++k) {
+            if (pos[k] < lists.at(k).count()
+                && (next < 0 || lists.at(k).at(pos[k]) < lists.at(next).at(pos[next]))) {
+                next = k;
+            }
+        }
+        if (next < 0) {
+            return result;
+        }
+        const QDateTime &dt = lists.at(next).at(pos[next]++);
+        if (result.isEmpty() || result.last() != dt) {
+            result.append(dt);
+        }
+    }
+}
+//@endcond
 
 SortableList<QDateTime> Recurrence::timesInInterval(const QDateTime &start, const QDateTime &end) const
 {
     int i, count;
-    SortableList<QDateTime> times;
+    QVector<SortableList<QDateTime> > lists;
+    lists.reserve(d->mRRules.count() + 3);
     for (i = 0, count = d->mRRules.count();  i < count;  ++i) {
-        times += d->mRRules[i]->timesInInterval(start, end);
+        lists.append(d->mRRules[i]->timesInInterval(start, end));
     }
 
     // add rdatetimes that fit in the interval
-    for (i = 0, count = d->mRDateTimes.count();  i < count;  ++i) {
-        if (d->mRDateTimes[i] >= start && d->mRDateTimes[i] <= end) {
-            times += d->mRDateTimes[i];
-        }
+    lists.append(SortableList<QDateTime>());
+    i = d->mRDateTimes.findGE(start);
+    for (count = d->mRDateTimes.count();  i >= 0 && i < count && d->mRDateTimes[i] <= end;  ++i) {
+        lists.last() += d->mRDateTimes[i];
     }
 
     // add rdates that fit in the interval
+    lists.append(SortableList<QDateTime>());
     QDateTime kdt = d->mStartDateTime;
     for (i = 0, count = d->mRDates.count();  i < count;  ++i) {
         kdt.setDate(d->mRDates[i]);
         if (kdt >= start && kdt <= end) {
-            times += kdt;
+            lists.last() += kdt;
         }
     }
 
@@ -1094,185 +1541,55 @@ SortableList<QDateTime> Recurrence::timesInInterval(const QDateTime &start, cons
             d->mRRules.isEmpty() &&
             start <= d->mStartDateTime &&
             end >= d->mStartDateTime) {
-        times += d->mStartDateTime;
+        lists.append(SortableList<QDateTime>() << d->mStartDateTime);
     }
 
-    times.sortUnique();
+    const SortableList<QDateTime> times = mergeTimes(lists);
+    if (times.isEmpty() || (d->mExDates.isEmpty() && d->mExDateTimes.isEmpty() && d->mExRules.isEmpty())) {
+        return times;
+    }
 
-    // Remove excluded times
-    int idt = 0;
-    int enddt = times.count();
-    for (i = 0, count = d->mExDates.count();  i < count && idt < enddt;  ++i) {
-        while (idt < enddt && times[idt].date() < d->mExDates[i]) {
-            ++idt;
+    lists.clear();
+    for (i = 0, count = d->mExRules.count();  i < count;  ++i) {
+        lists.append(d->mExRules[i]->timesInInterval(start, end));
+    }
+    lists.append(d->mExDateTimes);
+    const SortableList<QDateTime> extimes = mergeTimes(lists);
+
+    // Remove excluded times, in one pass over the sorted lists
+    SortableList<QDateTime> result;
+    result.reserve(times.count());
+    int idate = 0;
+    const int exDateCount = d->mExDates.count();
+    int itime = 0;
+    const int exTimeCount = extimes.count();
+    for (const QDateTime &dt : times) {
+        const QDate date = dt.date();
+        while (idate < exDateCount && d->mExDates[idate] < date) {
+            ++idate;
         }
-        while (idt < enddt && times[idt].date() == d->mExDates[i]) {
-            times.removeAt(idt);
-            --enddt;
+        if (idate < exDateCount && d->mExDates[idate] == date) {
+            continue;
         }
-    }
-    SortableList<QDateTime> extimes;
-    for (i = 0, count = d->mExRules.count();  i < count;  ++i) {
-        extimes += d->mExRules[i]->timesInInterval(start, end);
-    }
-    extimes += d->mExDateTimes;
-    extimes.sortUnique();
-
-    int st = 0;
-    for (i = 0, count = extimes.count();  i < count;  ++i) {
-        int j = times.removeSorted(extimes[i], st);
-        if (j >= 0) {
-            st = j;
+        while (itime < exTimeCount && extimes[itime] < dt) {
+            ++itime;
         }
+        if (itime < exTimeCount && extimes[itime] == dt) {
+            continue;
+        }
+        result.append(dt);
     }
-
-    return times;
+    return result;
 }
 
 QDateTime Recurrence::getNextDateTime(const QDateTime &preDateTime) const
 {
-    QDateTime nextDT = preDateTime;
-    // prevent infinite loops, e.g. when an exrule extinguishes an rrule (e.g.
-    // the exrule is identical to the rrule). If an occurrence is found, break
-    // out of the loop by returning that QDateTime
-// TODO_Recurrence: Is a loop counter of 1000 really okay? I mean for secondly
-// recurrence, an exdate might exclude more than 1000 intervals!
-    int loop = 0;
-    while (loop < 1000) {
-        // Outline of the algo:
-        //   1) Find the next date/time after preDateTime when the event could recur
-        //     1.0) Add the start date if it's after preDateTime
-        //     1.1) Use the next occurrence from the explicit RDATE lists
-        //     1.2) Add the next recurrence for each of the RRULEs
-        //   2) Take the earliest recurrence of these = QDateTime nextDT
-        //   3) If that date/time is not excluded, either explicitly by an EXDATE or
-        //      by an EXRULE, return nextDT as the next date/time of the recurrence
-        //   4) If it's excluded, start all at 1), but starting at nextDT (instead
-        //      of preDateTime). Loop at most 1000 times.
-        ++loop;
-        // First, get the next recurrence from the RDate lists
-        SortableList<QDateTime> dates;
-        if (nextDT < startDateTime()) {
-            dates << startDateTime();
-        }
-
-        int end;
-        // Assume that the rdatetime list is sorted
-        int i = d->mRDateTimes.findGT(nextDT);
-        if (i >= 0) {
-            dates << d->mRDateTimes[i];
-        }
-
-        QDateTime kdt(startDateTime());
-        for (i = 0, end = d->mRDates.count();  i < end;  ++i) {
-            kdt.setDate(d->mRDates[i]);
-            if (kdt > nextDT) {
-                dates << kdt;
-                break;
-            }
-        }
-
-        // Add the next occurrences from all RRULEs.
-        for (i = 0, end = d->mRRules.count();  i < end;  ++i) {
-            QDateTime dt = d->mRRules[i]->getNextDate(nextDT);
-            if (dt.isValid()) {
-                dates << dt;
-            }
-        }
-
-        // Take the first of these (all others can't be used later on)
-        dates.sortUnique();
-        if (dates.isEmpty()) {
-            return QDateTime();
-        }
-        nextDT = dates.first();
-
-        // Check if that date/time is excluded explicitly or by an exrule:
-        if (!d->mExDates.containsSorted(nextDT.date()) &&
-                !d->mExDateTimes.containsSorted(nextDT)) {
-            bool allowed = true;
-            for (i = 0, end = d->mExRules.count();  i < end;  ++i) {
-                allowed = allowed && !(d->mExRules[i]->recursAt(nextDT));
-            }
-            if (allowed) {
-                return nextDT;
-            }
-        }
-    }
-
-    // Couldn't find a valid occurrences in 1000 loops, something is wrong!
-    return QDateTime();
+    return Cursor::Private(d, preDateTime, true).next();
 }
 
 QDateTime Recurrence::getPreviousDateTime(const QDateTime &afterDateTime) const
 {
-    QDateTime prevDT = afterDateTime;
-    // prevent infinite loops, e.g. when an exrule extinguishes an rrule (e.g.
-    // the exrule is identical to the rrule). If an occurrence is found, break
-    // out of the loop by returning that QDateTime
-    int loop = 0;
-    while (loop < 1000) {
-        // Outline of the algo:
-        //   1) Find the next date/time after preDateTime when the event could recur
-        //     1.1) Use the next occurrence from the explicit RDATE lists
-        //     1.2) Add the next recurrence for each of the RRULEs
-        //   2) Take the earliest recurrence of these = QDateTime nextDT
-        //   3) If that date/time is not excluded, either explicitly by an EXDATE or
-        //      by an EXRULE, return nextDT as the next date/time of the recurrence
-        //   4) If it's excluded, start all at 1), but starting at nextDT (instead
-        //      of preDateTime). Loop at most 1000 times.
-        ++loop;
-        // First, get the next recurrence from the RDate lists
-        SortableList<QDateTime> dates;
-        if (prevDT > startDateTime()) {
-            dates << startDateTime();
-        }
-
-        int i = d->mRDateTimes.findLT(prevDT);
-        if (i >= 0) {
-            dates << d->mRDateTimes[i];
-        }
-
-        QDateTime kdt(startDateTime());
-        for (i = d->mRDates.count();  --i >= 0;) {
-            kdt.setDate(d->mRDates[i]);
-            if (kdt < prevDT) {
-                dates << kdt;
-                break;
-            }
-        }
-
-        // Add the previous occurrences from all RRULEs.
-        int end;
-        for (i = 0, end = d->mRRules.count();  i < end;  ++i) {
-            QDateTime dt = d->mRRules[i]->getPreviousDate(prevDT);
-            if (dt.isValid()) {
-                dates << dt;
-            }
-        }
-
-        // Take the last of these (all others can't be used later on)
-        dates.sortUnique();
-        if (dates.isEmpty()) {
-            return QDateTime();
-        }
-        prevDT = dates.last();
-
-        // Check if that date/time is excluded explicitly or by an exrule:
-        if (!d->mExDates.containsSorted(prevDT.date()) &&
-                !d->mExDateTimes.containsSorted(prevDT)) {
-            bool allowed = true;
-            for (i = 0, end = d->mExRules.count();  i < end;  ++i) {
-                allowed = allowed && !(d->mExRules[i]->recursAt(prevDT));
-            }
-            if (allowed) {
-                return prevDT;
-            }
-        }
-    }
-
-    // Couldn't find a valid occurrences in 1000 loops, something is wrong!
-    return QDateTime();
+    return Cursor::Private(d, afterDateTime, false).next();
 }
 
 /***************************** PROTECTED FUNCTIONS ***************************/
@@ -1420,6 +1737,7 @@ void Recurrence::setExDateTimes(const SortableList<QDateTime> &exdates)
 
     d->mExDateTimes = exdates;
     d->mExDateTimes.sortUnique();
+    d->clearCaches();
 }
 
 void Recurrence::addExDateTime(const QDateTime &exdate)
@@ -1554,6 +1872,7 @@ KCALCORE_EXPORT QDataStream &KCalCore::operator>>(QDataStream &in, KCalCore::Rec
        >> r->d->mAllDay >> r->d->mRecurReadOnly >> r->d->mExDates
        >> exruleCount >> rruleCount;
 
+    r->d->clearCaches();
     r->d->mExRules.clear();
     r->d->mRRules.clear();
 
@@ -1573,3 +1892,26 @@ KCALCORE_EXPORT QDataStream &KCalCore::operator>>(QDataStream &in, KCalCore::Rec
 
     return in;
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addRecurrence(const Recurrence &recurrence)
+{
+    const Recurrence::Private *d = recurrence.d;
+    add(MemoryUsage::RecurrenceRules, sizeof(Recurrence) + sizeof(Recurrence::Private));
+    addList(d->mRRules, MemoryUsage::RecurrenceRules);
+    for (const RecurrenceRule *rule : qAsConst(d->mRRules)) {
+        addRecurrenceRule(*rule);
+    }
+    addList(d->mExRules, MemoryUsage::RecurrenceRules);
+    for (const RecurrenceRule *rule : qAsConst(d->mExRules)) {
+        addRecurrenceRule(*rule);
+    }
+    addList(d->mRDateTimes, MemoryUsage::RecurrenceRules);
+    addList(d->mRDates, MemoryUsage::RecurrenceRules);
+    addList(d->mExDateTimes, MemoryUsage::RecurrenceRules);
+    addList(d->mExDates, MemoryUsage::RecurrenceRules);
+    addList(d->mObservers, MemoryUsage::RecurrenceRules);
+    addHash(d->mTimesOnCache, MemoryUsage::RecurrenceCaches);
+    add(MemoryUsage::RecurrenceCaches, (d->mDaysCache.days.size() + 7) / 8);
+}
+//@endcond
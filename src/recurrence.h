@@ -27,7 +27,8 @@
 #include "kcalcore_export.h"
 #include "recurrencerule.h"
 
-class QBitArray;
+#include <QBitArray>
+
 class QTimeZone;
 
 namespace KCalCore
@@ -97,6 +98,70 @@ public:
         virtual void recurrenceUpdated(Recurrence *r) = 0;
     };
 
+    /**
+      Steps through the occurrences of a recurrence, forwards or backwards
+      from a date/time, without computing a list of them.
+
+      The cursor follows the RRULEs, RDATEs and exclusions along with its
+      position, so taking n occurrences costs much less than n calls of
+      getNextDateTime(). The recurrence must not be changed or deleted while
+      the cursor is used.
+
+      @code
+      // The next 20 occurrences
+      Recurrence::Cursor cursor(recurrence, QDateTime::currentDateTime());
+      for (int i = 0; i < 20; ++i) {
+          const QDateTime dt = cursor.next();
+          if (!dt.isValid()) {
+              break;
+          }
+          ...
+      }
+      @endcode
+      @see RecurrenceRule::Cursor
+      @since 5.8
+    */
+    class KCALCORE_EXPORT Cursor
+    {
+    public:
+        /** The direction in which a cursor steps. */
+        enum Direction {
+            Forward,  /**< Occurrences after the start, earliest first */
+            Backward  /**< Occurrences before the start, latest first */
+        };
+
+        /**
+          Constructs a cursor on the occurrences of @p recurrence before or
+          after @p from, which itself is never returned.
+          @param recurrence the recurrence.
+          @param from the date/time to start from.
+          @param direction the direction in which to step.
+        */
+        Cursor(const Recurrence *recurrence, const QDateTime &from, Direction direction = Forward);
+
+        /**
+          Destroys the cursor.
+        */
+        ~Cursor();
+
+        /**
+          Returns the next occurrence in the direction of the cursor, the
+          same as getNextDateTime() or getPreviousDateTime() of the previous
+          one.
+          @return date/time of the occurrence, or invalid date if there are
+          no more occurrences.
+        */
+        QDateTime next();
+
+    private:
+        //@cond PRIVATE
+        Q_DISABLE_COPY(Cursor)
+        friend class Recurrence;
+        class Private;
+        Private *const d;
+        //@endcond
+    };
+
     /** enumeration for describing how an event recurs, if at all. */
     enum {
         rNone = 0,
@@ -204,6 +269,24 @@ public:
     */
     bool recursOn(const QDate &date, const QTimeZone &timeZone) const;
 
+    /**
+      Returns the dates from @p start to @p end (inclusive) on which the
+      event will recur, as a bit array with one bit per date: bit i is set
+      if recursOn(start.addDays(i), timeZone) is true.
+
+      This is much faster than calling recursOn() for each date, since the
+      occurrences of the whole range are computed at once. The result of
+      the last call is kept until the recurrence changes, so asking again
+      for the same range is cheap.
+
+      @param start first date to check.
+      @param end last date to check.
+      @param timeZone time zone for the dates.
+      @return an empty array if @p end is before @p start.
+      @since 5.8
+    */
+    QBitArray recursOnDates(const QDate &start, const QDate &end, const QTimeZone &timeZone) const;
+
     /**
       Returns true if the date/time specified is one at which the event will
       recur. Times are rounded down to the nearest minute to determine the
@@ -658,6 +741,7 @@ protected:
 
 private:
     //@cond PRIVATE
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
@@ -20,6 +20,9 @@
   Boston, MA 02110-1301, USA.
 */
 #include "recurrencerule.h"
+#include "arena_p.h"
+#include "instrumentation_p.h"
+#include "memoryaccounting_p.h"
 #include "utils.h"
 #include "kcalcore_debug.h"
 
@@ -694,7 +697,7 @@ bool Constraint::readDateTime(const QDateTime &dt, RecurrenceRule::PeriodType ty
  **************************************************************************/
 
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::RecurrenceRule::Private
+class Q_DECL_HIDDEN KCalCore::RecurrenceRule::Private : public ArenaAllocated
 {
 public:
     Private(RecurrenceRule *parent)
@@ -717,6 +720,7 @@ public:
     void setDirty();
     void buildConstraints();
     bool buildCache() const;
+    void ensureCache() const;
     Constraint getNextValidDateInterval(const QDateTime &preDate, PeriodType type) const;
     Constraint getPreviousValidDateInterval(const QDateTime &afterDate, PeriodType type) const;
     SortableList<QDateTime> datesForInterval(const Constraint &interval, PeriodType type) const;
@@ -1323,6 +1327,7 @@ void RecurrenceRule::Private::buildConstraints()
 bool RecurrenceRule::Private::buildCache() const
 {
     Q_ASSERT(mDuration > 0);
+    KCALCORE_COUNT(RecurrenceCacheMisses);
     // Build the list of all occurrences of this event (we need that to determine
     // the end date!)
     Constraint interval(getNextValidDateInterval(mDateStart, mPeriod));
@@ -1364,6 +1369,17 @@ bool RecurrenceRule::Private::buildCache() const
         return false;
     }
 }
+
+// Build the cache unless it is up to date.
+// Only call ensureCache() if mDuration > 0.
+void RecurrenceRule::Private::ensureCache() const
+{
+    if (mCached) {
+        KCALCORE_COUNT(RecurrenceCacheHits);
+    } else {
+        buildCache();
+    }
+}
 //@endcond
 
 bool RecurrenceRule::dateMatchesRules(const QDateTime &kdt) const
@@ -1623,9 +1639,7 @@ QDateTime RecurrenceRule::getPreviousDate(const QDateTime &afterDate) const
 
     // If we have a cache (duration given), use that
     if (d->mDuration > 0) {
-        if (!d->mCached) {
-            d->buildCache();
-        }
+        d->ensureCache();
         int i = d->mCachedDates.findLT(toDate);
         if (i >= 0) {
             return d->mCachedDates[i];
@@ -1679,15 +1693,14 @@ QDateTime RecurrenceRule::getNextDate(const QDateTime &preDate) const
 
     if (d->mTimedRepetition) {
         // It's a simple sub-daily recurrence with no constraints
-        int n = static_cast<int>((d->mDateStart.secsTo(fromDate) + 1) % d->mTimedRepetition);
-        QDateTime next = fromDate.addSecs(d->mTimedRepetition - n + 1);
+        const qint64 elapsed = d->mDateStart.secsTo(fromDate);
+        QDateTime next = elapsed < 0 ? d->mDateStart
+                         : fromDate.addSecs(d->mTimedRepetition - elapsed % d->mTimedRepetition);
         return d->mDuration < 0 || !endDt().isValid() || next <= endDt() ? next : QDateTime();
     }
 
     if (d->mDuration > 0) {
-        if (!d->mCached) {
-            d->buildCache();
-        }
+        d->ensureCache();
         int i = d->mCachedDates.findGT(fromDate);
         if (i >= 0) {
             return d->mCachedDates[i];
@@ -1726,9 +1739,150 @@ QDateTime RecurrenceRule::getNextDate(const QDateTime &preDate) const
     return QDateTime();
 }
 
+//@cond PRIVATE
+class Q_DECL_HIDDEN RecurrenceRule::Cursor::Private
+{
+public:
+    Private(const RecurrenceRule *rule, const QDateTime &from, bool forward)
+        : mRule(rule),
+          mForward(forward),
+          mLast(from)
+    {
+    }
+
+    QDateTime next();
+
+private:
+    QDateTime first();
+    QDateTime finish()
+    {
+        mLast = QDateTime();
+        return mLast;
+    }
+
+    const RecurrenceRule *const mRule;
+    const bool mForward;
+    QDateTime mLast;                 // last occurrence returned, or the start
+    bool mStarted = false;           // whether mInterval and mDates are set up
+    Constraint mInterval;            // interval of the current occurrences
+    SortableList<QDateTime> mDates;  // occurrences in mInterval
+    int mIndex = 0;                  // position of mLast in mDates
+};
+
+// The same as getNextDate() or getPreviousDate(), but keeping the interval
+QDateTime RecurrenceRule::Cursor::Private::first()
+{
+    const RecurrenceRule::Private *d = mRule->d;
+    const PeriodType type = mRule->recurrenceType();
+    const QDateTime end = mRule->endDt();
+    if (mForward) {
+        QDateTime fromDate(mLast.toTimeZone(d->mDateStart.timeZone()));
+        if (d->mDuration >= 0 && end.isValid() && fromDate >= end) {
+            return finish();
+        }
+        if (fromDate < d->mDateStart) {
+            fromDate = d->mDateStart.addSecs(-1);
+        }
+        mInterval = d->getNextValidDateInterval(fromDate, type);
+        mDates = d->datesForInterval(mInterval, type);
+        mIndex = mDates.findGT(fromDate);
+        if (mIndex >= 0) {
+            mLast = mDates[mIndex];
+            return d->mDuration < 0 || mLast <= end ? mLast : finish();
+        }
+        // Continue with the next interval
+        mIndex = mDates.count() - 1;
+        return next();
+    }
+
+    const QDateTime toDate(mLast.toTimeZone(d->mDateStart.timeZone()));
+    if (!toDate.isValid() || toDate < d->mDateStart) {
+        return finish();
+    }
+    QDateTime prev = toDate;
+    if (d->mDuration >= 0 && end.isValid() && toDate > end) {
+        prev = end.addSecs(1).toTimeZone(d->mDateStart.timeZone());
+    }
+    mInterval = d->getPreviousValidDateInterval(prev, type);
+    mDates = d->datesForInterval(mInterval, type);
+    mIndex = mDates.findLT(prev);
+    if (mIndex >= 0) {
+        mLast = mDates[mIndex];
+        return mLast >= d->mDateStart ? mLast : finish();
+    }
+    // Continue with the previous interval
+    mIndex = 0;
+    return next();
+}
+
+QDateTime RecurrenceRule::Cursor::Private::next()
+{
+    if (!mLast.isValid()) {
+        return mLast;
+    }
+    const RecurrenceRule::Private *d = mRule->d;
+    if (d->mTimedRepetition || d->mDuration > 0) {
+        // These steps take constant time, or a lookup in the cache of all occurrences
+        mLast = mForward ? mRule->getNextDate(mLast) : mRule->getPreviousDate(mLast);
+        return mLast;
+    }
+    if (!mStarted) {
+        mStarted = true;
+        return first();
+    }
+
+    const PeriodType type = mRule->recurrenceType();
+    if (mForward) {
+        const QDateTime end = mRule->endDt();
+        for (int loop = 0; loop < LOOP_LIMIT; ++loop) {
+            if (++mIndex < mDates.count()) {
+                mLast = mDates[mIndex];
+                return d->mDuration < 0 || mLast <= end ? mLast : finish();
+            }
+            mInterval.increase(type, mRule->frequency());
+            if (d->mDuration >= 0 && mInterval.intervalDateTime(type) > end) {
+                return finish();
+            }
+            mDates = d->datesForInterval(mInterval, type);
+            mIndex = -1;
+        }
+        return finish();
+    }
+
+    for (;;) {
+        if (--mIndex >= 0) {
+            mLast = mDates[mIndex];
+            return mLast >= d->mDateStart ? mLast : finish();
+        }
+        if (mInterval.intervalDateTime(type) <= d->mDateStart) {
+            return finish();
+        }
+        mInterval.increase(type, -int(mRule->frequency()));
+        mDates = d->datesForInterval(mInterval, type);
+        mIndex = mDates.count();
+    }
+}
+//@endcond
+
+RecurrenceRule::Cursor::Cursor(const RecurrenceRule *rule, const QDateTime &from, Direction direction)
+    : d(new Private(rule, from, direction == Forward))
+{
+}
+
+RecurrenceRule::Cursor::~Cursor()
+{
+    delete d;
+}
+
+QDateTime RecurrenceRule::Cursor::next()
+{
+    return d->next();
+}
+
 SortableList<QDateTime> RecurrenceRule::timesInInterval(const QDateTime &dtStart,
                                                         const QDateTime &dtEnd) const
 {
+    KCALCORE_TIME(TimesInIntervalTimer);
     const QDateTime start = dtStart.toTimeZone(d->mDateStart.timeZone());
     const QDateTime end = dtEnd.toTimeZone(d->mDateStart.timeZone());
     SortableList<QDateTime> result;
@@ -1777,9 +1931,7 @@ SortableList<QDateTime> RecurrenceRule::timesInInterval(const QDateTime &dtStart
     QDateTime st = start;
     bool done = false;
     if (d->mDuration > 0) {
-        if (!d->mCached) {
-            d->buildCache();
-        }
+        d->ensureCache();
         if (d->mCachedDateEnd.isValid() && start > d->mCachedDateEnd) {
             return result;    // beyond end of recurrence
         }
@@ -1989,6 +2141,7 @@ SortableList<QDateTime> RecurrenceRule::Private::datesForInterval(const Constrai
        -) if complete => add that one date to the date list
        -) Loop through all missing fields => For each add the resulting
     */
+    KCALCORE_COUNT(RecurrenceExpansions);
     SortableList<QDateTime> lst;
     for (int i = 0, iend = mConstraints.count(); i < iend; ++i) {
         Constraint merged(interval);
@@ -2324,3 +2477,21 @@ KCALCORE_EXPORT QDataStream &KCalCore::operator>>(QDataStream &in, const KCalCor
 
     return in;
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addRecurrenceRule(const RecurrenceRule &rule)
+{
+    const RecurrenceRule::Private *d = rule.d;
+    add(MemoryUsage::RecurrenceRules, sizeof(RecurrenceRule) + sizeof(RecurrenceRule::Private));
+    addString(d->mRRule, MemoryUsage::RecurrenceRules);
+    for (const QList<int> *list : { &d->mBySeconds, &d->mByMinutes, &d->mByHours,
+                                    &d->mByMonthDays, &d->mByYearDays, &d->mByWeekNumbers,
+                                    &d->mByMonths, &d->mBySetPos }) {
+        addList(*list, MemoryUsage::RecurrenceRules);
+    }
+    addList(d->mByDays, MemoryUsage::RecurrenceRules);
+    addVector(d->mConstraints, MemoryUsage::RecurrenceRules);
+    addList(d->mObservers, MemoryUsage::RecurrenceRules);
+    addList(d->mCachedDates, MemoryUsage::RecurrenceCaches);
+}
+//@endcond
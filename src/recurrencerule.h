@@ -89,6 +89,66 @@ public:
         friend KCALCORE_EXPORT QDataStream &operator>>(QDataStream &in, KCalCore::RecurrenceRule::WDayPos &);
     };
 
+    /**
+      Steps through the occurrences of a recurrence rule, forwards or
+      backwards from a date/time, without computing a list of them.
+
+      The cursor keeps its position within the rule between steps, so
+      taking n occurrences costs much less than n calls of getNextDate().
+      The rule must not be changed or deleted while the cursor is used.
+
+      @code
+      // The next 20 occurrences
+      RecurrenceRule::Cursor cursor(rule, QDateTime::currentDateTime());
+      for (int i = 0; i < 20; ++i) {
+          const QDateTime dt = cursor.next();
+          if (!dt.isValid()) {
+              break;
+          }
+          ...
+      }
+      @endcode
+      @since 5.8
+    */
+    class KCALCORE_EXPORT Cursor
+    {
+    public:
+        /** The direction in which a cursor steps. */
+        enum Direction {
+            Forward,  /**< Occurrences after the start, earliest first */
+            Backward  /**< Occurrences before the start, latest first */
+        };
+
+        /**
+          Constructs a cursor on the occurrences of @p rule before or after
+          @p from, which itself is never returned.
+          @param rule the recurrence rule.
+          @param from the date/time to start from.
+          @param direction the direction in which to step.
+        */
+        Cursor(const RecurrenceRule *rule, const QDateTime &from, Direction direction = Forward);
+
+        /**
+          Destroys the cursor.
+        */
+        ~Cursor();
+
+        /**
+          Returns the next occurrence in the direction of the cursor, the
+          same as getNextDate() or getPreviousDate() of the previous one.
+          @return date/time of the occurrence, or invalid date if there are
+          no more occurrences.
+        */
+        QDateTime next();
+
+    private:
+        //@cond PRIVATE
+        Q_DISABLE_COPY(Cursor)
+        class Private;
+        Private *const d;
+        //@endcond
+    };
+
     RecurrenceRule();
     RecurrenceRule(const RecurrenceRule &r);
     ~RecurrenceRule();
@@ -323,6 +383,7 @@ public:
 
 private:
     //@cond PRIVATE
+    friend class MemoryAccounting;
     class Private;
     Private *const d;
     //@endcond
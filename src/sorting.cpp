@@ -20,11 +20,15 @@
   Boston, MA 02110-1301, USA.
 */
 #include "sorting.h"
+#include "sorting_p.h"
 #include "event.h"
 #include "journal.h"
 #include "todo.h"
 #include "utils.h"
 
+#include <algorithm>
+#include <limits>
+
 // PENDING(kdab) Review
 // The QString::compare() need to be replace by a DUI string comparisons.
 // See http://qt.gitorious.org/maemo-6-ui-framework/libdui
@@ -432,3 +436,308 @@ bool KCalCore::Persons::countMoreThan(const Person::Ptr &p1, const Person::Ptr &
 {
     return p1->count() > p2->count();
 }
+
+//@cond PRIVATE
+namespace
+{
+
+/**
+  An incidence of the list being sorted, decorated with its sort keys.
+*/
+struct SortEntry {
+    qint64 first;   // primary key
+    qint64 second;  // secondary key, compared when the primary keys are equal
+    int index;      // position of the incidence in the unsorted list
+};
+
+/**
+  Returns the case folded code points of @p summary, such that comparing two
+  keys gives the same result as QString::compare(s1, s2, Qt::CaseInsensitive).
+*/
+QVector<uint> summaryKey(const QString &summary)
+{
+    QVector<uint> key;
+    key.reserve(summary.size());
+    uint last = 0;
+    for (const QChar c : summary) {
+        uint ucs4 = c.unicode();
+        if (QChar::isLowSurrogate(ucs4) && QChar::isHighSurrogate(last)) {
+            ucs4 = QChar::surrogateToUcs4(ushort(last), ushort(ucs4));
+        }
+        last = c.unicode();
+        key.append(QChar::toCaseFolded(ucs4));
+    }
+    return key;
+}
+
+int compareSummaryKeys(const QVector<uint> &key1, const QVector<uint> &key2)
+{
+    for (int i = 0, end = qMin(key1.size(), key2.size()); i < end; ++i) {
+        if (key1[i] != key2[i]) {
+            return key1[i] < key2[i] ? -1 : 1;
+        }
+    }
+    return key1.size() == key2.size() ? 0 : key1.size() < key2.size() ? -1 : 1;
+}
+
+/**
+  Sets the keys of @p entry for sorting by @p dt.
+
+  This mirrors compare(): an all-day value stands for the period up to the
+  end of its day, so when sorting ascending the start of that period is the
+  primary key, and when sorting descending its end. Invalid values (e.g. a
+  to-do without due date) sort before all valid ones.
+*/
+void setDateTimeKeys(SortEntry &entry, const QDateTime &dt, bool allDay, bool ascending)
+{
+    if (!dt.isValid()) {
+        entry.first = entry.second = std::numeric_limits<qint64>::min();
+        return;
+    }
+    const qint64 start = dt.toMSecsSinceEpoch();
+    qint64 end = start;
+    if (allDay) {
+        QDateTime endOfDay(dt);
+        endOfDay.setTime(QTime(23, 59, 59, 999));
+        end = endOfDay.toMSecsSinceEpoch();
+    }
+    entry.first = ascending ? start : end;
+    entry.second = ascending ? end : start;
+}
+
+void setValueKeys(SortEntry &entry, int value)
+{
+    entry.first = value;
+    entry.second = 0;
+}
+
+/**
+  Orders entries by their keys, in the given direction.
+*/
+struct KeyOrder {
+    bool ascending;
+
+    bool operator()(const SortEntry &e1, const SortEntry &e2) const
+    {
+        if (e1.first != e2.first) {
+            return ascending ? e1.first < e2.first : e1.first > e2.first;
+        }
+        return ascending ? e1.second < e2.second : e1.second > e2.second;
+    }
+
+    static bool equal(const SortEntry &e1, const SortEntry &e2)
+    {
+        return e1.first == e2.first && e1.second == e2.second;
+    }
+};
+
+/**
+  Sorts the entries in [from, to) by the summaries of their incidences,
+  such that the entries in [from, needed) are the first ones in order.
+  The summary keys are only built for the entries in that range.
+*/
+template<typename List>
+void sortBySummary(QVector<SortEntry> &entries, int from, int to, int needed,
+                   const List &list, bool ascending)
+{
+    struct SummaryEntry {
+        QVector<uint> key;
+        SortEntry entry;
+    };
+    QVector<SummaryEntry> run;
+    run.reserve(to - from);
+    for (int i = from; i < to; ++i) {
+        run.append({summaryKey(list.at(entries[i].index)->summary()), entries[i]});
+    }
+    const auto lessThan = [ascending](const SummaryEntry &e1, const SummaryEntry &e2) {
+        const int res = compareSummaryKeys(e1.key, e2.key);
+        return ascending ? res < 0 : res > 0;
+    };
+    if (needed < to) {
+        std::partial_sort(run.begin(), run.begin() + (needed - from), run.end(), lessThan);
+    } else {
+        std::sort(run.begin(), run.end(), lessThan);
+    }
+    for (int i = from; i < to; ++i) {
+        entries[i] = run[i - from].entry;
+    }
+}
+
+/**
+  Sorts @p entries by their keys. If @p summaryTies is true, entries with
+  equal keys are then ordered by summary, like the comparators in sorting.h do.
+
+  Only the first @p count entries are guaranteed to be in order: they are
+  selected with a partial sort, which costs O(N log count) instead of
+  O(N log N), and the remaining ones are dropped.
+*/
+template<typename List>
+void sortEntries(QVector<SortEntry> &entries, const List &list,
+                 bool ascending, bool summaryTies, int count)
+{
+    const KeyOrder order = { ascending };
+    int end = entries.size();
+    if (count < end) {
+        std::partial_sort(entries.begin(), entries.begin() + count, entries.end(), order);
+        if (summaryTies && count > 0) {
+            // The summary decides among the entries whose keys are equal to
+            // the last selected one, so these all take part in the run.
+            const SortEntry boundary = entries[count - 1];
+            end = std::partition(entries.begin() + count, entries.end(),
+                                 [&boundary](const SortEntry &entry) {
+                                     return KeyOrder::equal(entry, boundary);
+                                 }) - entries.begin();
+        }
+    } else {
+        std::sort(entries.begin(), entries.end(), order);
+    }
+
+    if (summaryTies) {
+        for (int i = 0; i < count && i < end;) {
+            int j = i + 1;
+            while (j < end && KeyOrder::equal(entries[j], entries[i])) {
+                ++j;
+            }
+            if (j - i > 1) {
+                sortBySummary(entries, i, j, qMin(j, count), list, ascending);
+            }
+            i = j;
+        }
+    }
+
+    if (count < entries.size()) {
+        entries.resize(count);
+    }
+}
+
+/**
+  Returns the number of entries sortEntries() needs to order, so that the
+  page defined by @p offset and @p limit can be taken from the result.
+*/
+int neededCount(int size, int offset, int limit)
+{
+    if (limit < 0 || qint64(offset) + limit >= size) {
+        return size;
+    }
+    return offset + limit;
+}
+
+template<typename List>
+List undecorate(const List &list, const QVector<SortEntry> &entries, int offset)
+{
+    List sorted;
+    sorted.reserve(qMax(entries.size() - offset, 0));
+    for (int i = offset; i < entries.size(); ++i) {
+        sorted.append(list.at(entries[i].index));
+    }
+    return sorted;
+}
+
+}
+
+Event::List SortHelpers::sortEvents(const Event::List &eventList,
+                                    EventSortField sortField,
+                                    SortDirection sortDirection,
+                                    int offset, int limit)
+{
+    offset = qMax(offset, 0);
+    if (sortField == EventSortUnsorted) {
+        return eventList.mid(offset, limit);
+    }
+
+    const bool ascending = (sortDirection == SortDirectionAscending);
+    QVector<SortEntry> entries(eventList.size());
+    for (int i = 0, end = eventList.size(); i < end; ++i) {
+        const Event::Ptr &event = eventList.at(i);
+        SortEntry &entry = entries[i];
+        entry.index = i;
+        switch (sortField) {
+        case EventSortStartDate:
+            setDateTimeKeys(entry, event->dtStart(), event->allDay(), ascending);
+            break;
+        case EventSortEndDate:
+            setDateTimeKeys(entry, event->dtEnd(), event->allDay(), ascending);
+            break;
+        case EventSortSummary:
+        case EventSortUnsorted:
+            setValueKeys(entry, 0);
+            break;
+        }
+    }
+
+    sortEntries(entries, eventList, ascending, true,
+                neededCount(entries.size(), offset, limit));
+    return undecorate(eventList, entries, offset);
+}
+
+Todo::List SortHelpers::sortTodos(const Todo::List &todoList,
+                                  TodoSortField sortField,
+                                  SortDirection sortDirection,
+                                  int offset, int limit)
+{
+    offset = qMax(offset, 0);
+    if (sortField == TodoSortUnsorted) {
+        return todoList.mid(offset, limit);
+    }
+
+    const bool ascending = (sortDirection == SortDirectionAscending);
+    QVector<SortEntry> entries(todoList.size());
+    for (int i = 0, end = todoList.size(); i < end; ++i) {
+        const Todo::Ptr &todo = todoList.at(i);
+        SortEntry &entry = entries[i];
+        entry.index = i;
+        switch (sortField) {
+        case TodoSortStartDate:
+            setDateTimeKeys(entry, todo->dtStart(), todo->allDay(), ascending);
+            break;
+        case TodoSortDueDate:
+            setDateTimeKeys(entry, todo->dtDue(), todo->allDay(), ascending);
+            break;
+        case TodoSortCreated:
+            setDateTimeKeys(entry, todo->created(), todo->allDay(), ascending);
+            break;
+        case TodoSortPriority:
+            setValueKeys(entry, todo->priority());
+            break;
+        case TodoSortPercentComplete:
+            setValueKeys(entry, todo->percentComplete());
+            break;
+        case TodoSortSummary:
+        case TodoSortUnsorted:
+            setValueKeys(entry, 0);
+            break;
+        }
+    }
+
+    sortEntries(entries, todoList, ascending, true,
+                neededCount(entries.size(), offset, limit));
+    return undecorate(todoList, entries, offset);
+}
+
+Journal::List SortHelpers::sortJournals(const Journal::List &journalList,
+                                        JournalSortField sortField,
+                                        SortDirection sortDirection)
+{
+    if (sortField == JournalSortUnsorted) {
+        return journalList;
+    }
+
+    const bool ascending = (sortDirection == SortDirectionAscending);
+    QVector<SortEntry> entries(journalList.size());
+    for (int i = 0, end = journalList.size(); i < end; ++i) {
+        const Journal::Ptr &journal = journalList.at(i);
+        SortEntry &entry = entries[i];
+        entry.index = i;
+        if (sortField == JournalSortDate) {
+            setDateTimeKeys(entry, journal->dtStart(), journal->allDay(), ascending);
+        } else {
+            setValueKeys(entry, 0);
+        }
+    }
+
+    // Journals::dateLessThan() does not fall back to the summary for equal dates
+    sortEntries(entries, journalList, ascending, sortField == JournalSortSummary,
+                entries.size());
+    return undecorate(journalList, entries, 0);
+}
+//@endcond
@@ -0,0 +1,65 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+#ifndef KCALCORE_SORTING_PRIVATE_H
+#define KCALCORE_SORTING_PRIVATE_H
+
+#include "calendar.h"
+
+namespace KCalCore
+{
+
+//@cond PRIVATE
+/**
+  Key based sorting used by Calendar::sortEvents(), Calendar::sortTodos()
+  and Calendar::sortJournals().
+
+  Rather than calling the comparators from sorting.h for every comparison,
+  the sort keys (UTC instants and all-day span, priority, case folded
+  summary) are extracted once per incidence and the list is sorted on them.
+  The resulting order is the one defined by the comparators; where those
+  are ambiguous (e.g. an all-day and a timed incidence starting at the same
+  instant) a fixed order is used.
+
+  sortEvents() and sortTodos() return the page of @p limit items starting at
+  @p offset of the sorted list; a negative @p limit stands for all items.
+  Only the items up to the end of the page are sorted.
+*/
+namespace SortHelpers
+{
+
+Event::List sortEvents(const Event::List &eventList,
+                       EventSortField sortField,
+                       SortDirection sortDirection,
+                       int offset = 0, int limit = -1);
+
+Todo::List sortTodos(const Todo::List &todoList,
+                     TodoSortField sortField,
+                     SortDirection sortDirection,
+                     int offset = 0, int limit = -1);
+
+Journal::List sortJournals(const Journal::List &journalList,
+                           JournalSortField sortField,
+                           SortDirection sortDirection);
+
+}
+//@endcond
+
+}
+
+#endif
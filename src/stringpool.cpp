@@ -0,0 +1,86 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and
+  defines the StringPool class.
+*/
+
+#include "stringpool.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSet>
+
+using namespace KCalCore;
+
+//@cond PRIVATE
+class Q_DECL_HIDDEN KCalCore::StringPool::Private
+{
+public:
+    QString intern(const QString &string)
+    {
+        if (string.isEmpty()) {
+            return string;
+        }
+
+        QMutexLocker locker(&mMutex);
+        const auto it = mStrings.constFind(string);
+        if (it != mStrings.constEnd()) {
+            return *it;
+        }
+        // Don't keep a larger buffer alive than needed, e.g. the one of the
+        // string it was cut from
+        QString copy = string;
+        copy.squeeze();
+        mStrings.insert(copy);
+        return copy;
+    }
+
+    mutable QMutex mMutex;
+    QSet<QString> mStrings;
+};
+//@endcond
+
+StringPool::StringPool()
+    : d(new KCalCore::StringPool::Private)
+{
+}
+
+StringPool::~StringPool()
+{
+    delete d;
+}
+
+QString StringPool::intern(const QString &string)
+{
+    return d->intern(string);
+}
+
+int StringPool::count() const
+{
+    QMutexLocker locker(&d->mMutex);
+    return d->mStrings.count();
+}
+
+void StringPool::clear()
+{
+    QMutexLocker locker(&d->mMutex);
+    d->mStrings.clear();
+}
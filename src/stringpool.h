@@ -0,0 +1,100 @@
+/*
+  This file is part of the kcalcore library.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Library General Public
+  License as published by the Free Software Foundation; either
+  version 2 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Library General Public License for more details.
+
+  You should have received a copy of the GNU Library General Public License
+  along with this library; see the file COPYING.LIB.  If not, write to
+  the Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+  Boston, MA 02110-1301, USA.
+*/
+/**
+  @file
+  This file is part of the API for handling calendar data and
+  defines the StringPool class.
+*/
+
+#ifndef KCALCORE_STRINGPOOL_H
+#define KCALCORE_STRINGPOOL_H
+
+#include "kcalcore_export.h"
+
+#include <QSharedPointer>
+#include <QString>
+
+namespace KCalCore
+{
+
+/**
+  @brief
+  A pool of interned strings.
+
+  Calendars tend to contain the same strings over and over again: category
+  names, email addresses and names of organizers and attendees, and so on.
+  When a calendar is parsed, each of them ends up in a separate copy.
+
+  intern() returns a string sharing its data with the first equal string
+  passed to the pool, so equal strings are stored only once. Set a pool on
+  a CalFormat with CalFormat::setStringPool() to intern the strings read
+  by it; a pool can be shared between several formats, also from
+  different threads.
+
+  Strings in the pool are never removed before clear() is called.
+
+  @since 5.8
+*/
+class KCALCORE_EXPORT StringPool
+{
+public:
+    /**
+      A shared pointer to a StringPool.
+    */
+    typedef QSharedPointer<StringPool> Ptr;
+
+    /**
+      Constructs an empty pool.
+    */
+    StringPool();
+
+    /**
+      Destructor.
+    */
+    ~StringPool();
+
+    /**
+      Returns a string equal to @p string, sharing its data with the equal
+      strings returned before. @p string is added to the pool if it isn't
+      in it yet.
+    */
+    QString intern(const QString &string);
+
+    /**
+      Returns the number of distinct strings in the pool.
+    */
+    int count() const;
+
+    /**
+      Removes all strings from the pool. Strings returned by intern()
+      keep their data.
+    */
+    void clear();
+
+private:
+    //@cond PRIVATE
+    Q_DISABLE_COPY(StringPool)
+    class Private;
+    Private *const d;
+    //@endcond
+};
+
+}
+
+#endif
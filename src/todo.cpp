@@ -32,6 +32,8 @@
 */
 
 #include "todo.h"
+#include "arena_p.h"
+#include "memoryaccounting_p.h"
 #include "visitor.h"
 #include "recurrence.h"
 #include "utils.h"
@@ -47,7 +49,7 @@ using namespace KCalCore;
   @internal
 */
 //@cond PRIVATE
-class Q_DECL_HIDDEN KCalCore::Todo::Private
+class Q_DECL_HIDDEN KCalCore::Todo::Private : public ArenaAllocated
 {
 public:
     Private()
@@ -585,3 +587,11 @@ bool Todo::supportsGroupwareCommunication() const
 {
     return true;
 }
+
+//@cond PRIVATE
+void MemoryAccounting::addTodoData(const Todo &todo)
+{
+    add(MemoryUsage::IncidenceObjects, sizeof(Todo) + sizeof(Todo::Private));
+    addIncidenceData(todo);
+}
+//@endcond
@@ -75,6 +75,22 @@ void removeAllVCal(QVector< QSharedPointer<K> > &c, const QSharedPointer<K> &x)
     c.remove(c.indexOf(x));
 }
 
+// Returns @p string interned in @p pool, if any
+static QString internString(const StringPool::Ptr &pool, const QString &string)
+{
+    return pool ? pool->intern(string) : string;
+}
+
+static QStringList internStrings(const StringPool::Ptr &pool, QStringList strings)
+{
+    if (pool) {
+        for (QString &string : strings) {
+            string = pool->intern(string);
+        }
+    }
+    return strings;
+}
+
 class Q_DECL_HIDDEN KCalCore::VCalFormat::Private
 {
 public:
@@ -247,6 +263,9 @@ Todo::Ptr VCalFormat::VTodoToEvent(VObject *vtodo)
                 a = Attendee::Ptr(new Attendee(tmpStr, email));
             }
 
+            a->setName(internString(stringPool(), a->name()));
+            a->setEmail(internString(stringPool(), a->email()));
+
             // is there an RSVP property?
             if ((vp = isAPropertyOf(vo, VCRSVPProp)) != nullptr) {
                 a->setRSVP(vObjectStringZValue(vp));
@@ -632,7 +651,7 @@ Todo::Ptr VCalFormat::VTodoToEvent(VObject *vtodo)
         QString categories = QString::fromUtf8(s);
         deleteStr(s);
         QStringList tmpStrList = categories.split(QLatin1Char(';'));
-        anEvent->setCategories(tmpStrList);
+        anEvent->setCategories(internStrings(stringPool(), tmpStrList));
     }
 
     return anEvent;
@@ -719,6 +738,9 @@ Event::Ptr VCalFormat::VEventToEvent(VObject *vevent)
                 a = Attendee::Ptr(new Attendee(tmpStr, email));
             }
 
+            a->setName(internString(stringPool(), a->name()));
+            a->setEmail(internString(stringPool(), a->email()));
+
             // is there an RSVP property?
             if ((vp = isAPropertyOf(vo, VCRSVPProp)) != nullptr) {
                 a->setRSVP(vObjectStringZValue(vp));
@@ -1044,7 +1066,7 @@ Event::Ptr VCalFormat::VEventToEvent(VObject *vevent)
         QString categories = QString::fromUtf8(s);
         deleteStr(s);
         QStringList tmpStrList = categories.split(QLatin1Char(','));
-        anEvent->setCategories(tmpStrList);
+        anEvent->setCategories(internStrings(stringPool(), tmpStrList));
     }
 
     // attachments
@@ -1063,7 +1085,7 @@ Event::Ptr VCalFormat::VEventToEvent(VObject *vevent)
         QString resources = (QString::fromUtf8(s = fakeCString(vObjectUStringZValue(vo))));
         deleteStr(s);
         QStringList tmpStrList = resources.split(QLatin1Char(';'));
-        anEvent->setResources(tmpStrList);
+        anEvent->setResources(internStrings(stringPool(), tmpStrList));
     }
 
     // alarm stuff